@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <catalog.h>
+#include <parallel.h>
+
+// loads small catalogs in every format loadCatalog reads, blanks and line
+// breaks of other systems included, and checks the bodies that come out.
+// then times loading growing generated catalogs.
+//
+//   solar-sim-catalog-bench [maxBodies]
+
+static const char *const checkPath = "solar-sim-catalog-check.txt";
+
+static bool writeFile(const char *path, const std::string &text) {
+  std::FILE *file = std::fopen(path, "wb");
+  if (!file)
+    return false;
+  bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  return std::fclose(file) == 0 && written;
+}
+
+int main(int argc, char **argv) {
+  std::size_t maxBodies =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20;
+
+  // each catalog holds two bodies of mass 1 and 2 at x 3 and 4
+  struct Case {
+    const char *name;
+    const char *text;
+  };
+  const Case cases[] = {
+      {"no header", "1,0,3,0,0,0,0,0\n2,0,4,0,0,0,0,0\n"},
+      {"commas", "mass,x,y,z\n1,3,0,0\n2,4,0,0\n"},
+      {"blanks", "mass x y z\n1 3 0 0\n2 4 0 0\n"},
+      {"trailing blank", "mass x y z \n1 3 0 0 \n2 4 0 0\n"},
+      {"trailing cr", "mass x y z\r\n1 3 0 0\r\n2 4 0 0\r\n"},
+      {"blank and cr", "mass\tx y z \t\r\n1 3 0 0 \r\n2 4 0 0\r\n"},
+      {"quoted names", "\"name\",\"mass\",\"x\",\"y\",\"z\"\n"
+                       "\"a b\",1,3,0,0\n\"c\",2,4,0,0\n"},
+      {"comments", "# bodies\n\nmass x y z\n# first\n1 3 0 0\n\n2 4 0 0"},
+  };
+
+  std::printf("%-16s %6s %6s\n", "catalog", "bodies", "check");
+  bool allMatch = true;
+  for (const Case &c : cases) {
+    BodyStore bodies;
+    std::string error;
+    bool match = writeFile(checkPath, c.text) &&
+                 loadCatalog(checkPath, bodies, error) && bodies.size() == 2 &&
+                 bodies.mass[0] == 1 && bodies.mass[1] == 2 &&
+                 bodies.x[0] == 3 && bodies.x[1] == 4;
+    allMatch = allMatch && match;
+    std::printf("%-16s %6zu %6s%s%s\n", c.name, bodies.size(),
+                match ? "ok" : "FAIL", error.empty() ? "" : "  ",
+                error.c_str());
+  }
+
+  std::printf("\n%u threads\n", getThreadCount());
+  std::printf("%9s %10s %10s %9s\n", "bodies", "MB", "ms", "MB/s");
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  for (std::size_t count = 1024; count <= maxBodies; count *= 4) {
+    std::string text = "mass,radius,x,y,z,vx,vy,vz\n";
+    char line[256];
+    for (std::size_t i = 0; i < count; ++i) {
+      std::snprintf(line, sizeof(line),
+                    "%.9g,%.9g,%.17g,%.17g,%.17g,%.9g,%.9g,%.9g\n",
+                    1e-3 * (unit(rng) + 2.0), 0.5 * (unit(rng) + 2.0),
+                    1e3 * unit(rng), 1e3 * unit(rng), 1e3 * unit(rng),
+                    unit(rng), unit(rng), unit(rng));
+      text += line;
+    }
+    if (!writeFile(checkPath, text)) {
+      std::fprintf(stderr, "could not write %s\n", checkPath);
+      return 1;
+    }
+
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+      BodyStore bodies;
+      std::string error;
+      auto start = std::chrono::steady_clock::now();
+      bool loaded = loadCatalog(checkPath, bodies, error);
+      auto stop = std::chrono::steady_clock::now();
+      if (!loaded || bodies.size() != count) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        allMatch = false;
+        break;
+      }
+      best = std::min(
+          best,
+          std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    const double megabytes = text.size() / 1e6;
+    std::printf("%9zu %10.1f %10.2f %9.0f\n", count, megabytes, best,
+                megabytes / best * 1e3);
+    std::fflush(stdout);
+  }
+  std::remove(checkPath);
+  return allMatch ? 0 : 1;
+}
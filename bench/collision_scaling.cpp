@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <accretion.h>
+#include <body_store.h>
+#include <broadphase.h>
+#include <continuous_collision.h>
+#include <parallel.h>
+
+// times the collision broadphase on growing planetesimal discs around a sun
+// and checks its pairs against testing every pair, then times merging all
+// touching bodies of the disc with an Accretion and checks that every body
+// left keeps its id and every absorbed one is gone. a second table times swept
+// spheres over one step in which every body moves about its own size and
+// one in a thousand a hundred times that.
+//
+//   solar-sim-collision-bench [maxBodies]
+
+// every pair is tested up to this many bodies
+static const std::size_t bruteLimit = 1 << 14;
+// disc area per body, so the crowding stays the same as the disc grows
+static const float areaPerBody = 200.0f;
+
+// a thin disc of planetesimals with a power law of radii, a few of them
+// overlapping, and a sun whose edge reaches into the inner disc
+static BodyStore makeDisc(std::size_t count, unsigned int seed) {
+  std::mt19937 rng(seed);
+  const float outer = std::sqrt(count * areaPerBody / 3.14159265f);
+  const float inner = 0.05f * outer;
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::normal_distribution<float> thickness(0.0f, 2.0f);
+
+  BodyStore bodies;
+  bodies.reserve(count);
+  bodies.add(CelestialBody(inner * 1.05f, 1000.0f, glm::vec3(0.0f),
+                           glm::vec3(0.0f)));
+  for (std::size_t i = 1; i < count; ++i) {
+    float distance =
+        std::sqrt(inner * inner + unit(rng) * (outer * outer - inner * inner));
+    float angle = 6.2831853f * unit(rng);
+    glm::vec3 position(distance * std::cos(angle), distance * std::sin(angle),
+                       thickness(rng));
+    // radii from 0.5 to 4, mostly small
+    float radius = 0.5f / std::pow(1.0f - 0.99f * unit(rng), 0.45f);
+    bodies.add(CelestialBody(std::min(radius, 4.0f), 1e-3f, position,
+                             glm::vec3(0.0f)));
+  }
+  return bodies;
+}
+
+// moves every body as it would in one step, some of them fast
+static void moveDisc(BodyStore &bodies, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> step(0.0f, 1.0f);
+  std::uniform_int_distribution<int> fast(0, 999);
+  for (std::size_t i = 1; i < bodies.size(); ++i) {
+    float scale = bodies.radius[i] * (fast(rng) == 0 ? 100.0f : 1.0f);
+    bodies.x[i] += scale * step(rng);
+    bodies.y[i] += scale * step(rng);
+    bodies.z[i] += scale * step(rng);
+  }
+}
+
+static std::vector<BodyPair> bruteForce(const BodyStore &bodies) {
+  std::vector<BodyPair> pairs;
+  for (std::uint32_t i = 0; i < bodies.size(); ++i)
+    for (std::uint32_t j = i + 1; j < bodies.size(); ++j) {
+      double dx = double(bodies.x[j]) - bodies.x[i];
+      double dy = double(bodies.y[j]) - bodies.y[i];
+      double dz = double(bodies.z[j]) - bodies.z[i];
+      double reach = double(bodies.radius[i]) + bodies.radius[j];
+      if (dx * dx + dy * dy + dz * dz < reach * reach)
+        pairs.push_back(BodyPair{i, j});
+    }
+  return pairs;
+}
+
+static bool samePairs(std::vector<BodyPair> a, std::vector<BodyPair> b) {
+  auto less = [](const BodyPair &p, const BodyPair &q) {
+    return p.first != q.first ? p.first < q.first : p.second < q.second;
+  };
+  std::sort(a.begin(), a.end(), less);
+  std::sort(b.begin(), b.end(), less);
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(),
+                    [](const BodyPair &p, const BodyPair &q) {
+                      return p.first == q.first && p.second == q.second;
+                    });
+}
+
+int main(int argc, char **argv) {
+  std::size_t maxBodies =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20;
+
+  std::printf("%u threads\n", getThreadCount());
+  std::printf("%9s %9s %6s %11s %9s %10s %9s %6s %8s %9s %5s\n", "bodies",
+              "cells", "large", "tests", "pairs", "ms", "ns/body", "check",
+              "merged", "merge ms", "ids");
+
+  Broadphase broadphase;
+  std::vector<BodyPair> pairs;
+  bool allMatch = true;
+  for (std::size_t count = 1024; count <= maxBodies; count *= 2) {
+    BodyStore bodies = makeDisc(count, 1);
+    broadphase.findOverlaps(bodies, pairs);
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+      auto start = std::chrono::steady_clock::now();
+      broadphase.findOverlaps(bodies, pairs);
+      auto stop = std::chrono::steady_clock::now();
+      best = std::min(
+          best,
+          std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+
+    const char *check = "-";
+    if (count <= bruteLimit) {
+      bool match = samePairs(pairs, bruteForce(bodies));
+      allMatch = allMatch && match;
+      check = match ? "ok" : "FAIL";
+    }
+
+    // merging changes the disc, so it runs once
+    Accretion accretion;
+    auto start = std::chrono::steady_clock::now();
+    std::size_t merged = accretion.merge(bodies);
+    double mergeTime = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+    // the disc was made in one go, so ids started out as indices
+    const std::vector<std::uint32_t> &remap = accretion.getRemap();
+    std::vector<char> absorbed(count, 0);
+    for (const AccretionMerge &merge : accretion.getMerges())
+      absorbed[merge.absorbed] = 1;
+    bool idsMatch = accretion.getMerges().size() == merged &&
+                    bodies.size() == count - merged;
+    for (std::size_t i = 0; idsMatch && i < count; ++i)
+      idsMatch = absorbed[i] || bodies.id[remap.empty() ? i : remap[i]] == i;
+    allMatch = allMatch && idsMatch;
+
+    std::printf(
+        "%9zu %9zu %6zu %11zu %9zu %10.2f %9.1f %6s %8zu %9.2f %5s\n", count,
+        broadphase.getCellCount(), broadphase.getLargeCount(),
+        broadphase.getTestCount(), pairs.size(), best, best * 1e6 / count,
+        check, merged, mergeTime, idsMatch ? "ok" : "FAIL");
+    std::fflush(stdout);
+  }
+
+  std::printf("\n%9s %11s %9s %9s %10s %9s\n", "bodies", "candidates",
+              "impacts", "at end", "ms", "ns/body");
+  ContinuousCollision sweep;
+  std::vector<BodyImpact> impacts;
+  for (std::size_t count = 1024; count <= maxBodies; count *= 2) {
+    BodyStore bodies = makeDisc(count, 1);
+    sweep.begin(bodies);
+    moveDisc(bodies, 2);
+    broadphase.findOverlaps(bodies, pairs);
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+      auto start = std::chrono::steady_clock::now();
+      sweep.findImpacts(bodies, impacts);
+      auto stop = std::chrono::steady_clock::now();
+      best = std::min(
+          best,
+          std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    std::printf("%9zu %11zu %9zu %9zu %10.2f %9.1f\n", count,
+                sweep.getCandidateCount(), impacts.size(), pairs.size(),
+                best, best * 1e6 / count);
+    std::fflush(stdout);
+  }
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include <barnes_hut.h>
+#include <body_store.h>
+#include <cpu_features.h>
+#include <fast_multipole.h>
+#include <gravity_solver.h>
+#include <pair_force.h>
+#include <parallel.h>
+
+// times every gravity solver on growing discs of bodies and reports where the
+// tree methods overtake direct summation.
+//
+//   solar-sim-bench [maxBodies] [expansionOrder] [openingAngle]
+
+// direct summation is skipped above this many bodies
+static const std::size_t directLimit = 1 << 17;
+// bodies the error is measured on
+static const std::size_t sampleCount = 256;
+
+// a thick disc of bodies, the layout a planetary system tends towards
+static BodyStore makeDisc(std::size_t count, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> spread(0.0f, 1000.0f);
+  std::uniform_real_distribution<float> mass(0.1f, 100.0f);
+  std::uniform_real_distribution<float> radius(0.1f, 5.0f);
+
+  BodyStore bodies;
+  bodies.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    glm::vec3 position(spread(rng), spread(rng), 0.1f * spread(rng));
+    bodies.add(
+        CelestialBody(radius(rng), mass(rng), position, glm::vec3(0.0f)));
+  }
+  return bodies;
+}
+
+// exact accelerations of a few bodies spread through the store
+static std::vector<glm::vec3> referenceSample(const BodyStore &bodies,
+                                              std::size_t stride) {
+  std::vector<glm::vec3> reference;
+  for (std::size_t i = 0; i < bodies.size(); i += stride) {
+    double ax = 0.0, ay = 0.0, az = 0.0;
+    for (std::size_t j = 0; j < bodies.size(); ++j)
+      accumulatePairAcceleration<double>(
+          bodies.x[j] - bodies.x[i], bodies.y[j] - bodies.y[i],
+          bodies.z[j] - bodies.z[i], bodies.radius[i], bodies.radius[j],
+          bodies.mass[j], ax, ay, az);
+    reference.push_back(glm::vec3(ax, ay, az));
+  }
+  return reference;
+}
+
+static double meanRelativeError(const BodyStore &bodies,
+                                const std::vector<glm::vec3> &reference,
+                                std::size_t stride) {
+  double total = 0.0;
+  for (std::size_t k = 0; k < reference.size(); ++k) {
+    std::size_t i = k * stride;
+    glm::vec3 error =
+        glm::vec3(bodies.ax[i], bodies.ay[i], bodies.az[i]) - reference[k];
+    float magnitude = glm::length(reference[k]);
+    if (magnitude > 0.0f)
+      total += glm::length(error) / magnitude;
+  }
+  return reference.empty() ? 0.0 : total / reference.size();
+}
+
+// best of a few runs, after one warm up run that sizes the buffers
+static double timeSolver(GravitySolver &solver, BodyStore &bodies,
+                         int repeats) {
+  solver.computeAccelerations(bodies);
+  double best = 1e30;
+  for (int r = 0; r < repeats; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    solver.computeAccelerations(bodies);
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(
+        best, std::chrono::duration<double, std::milli>(stop - start).count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  std::size_t maxBodies =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 18;
+  int order = argc > 2 ? std::atoi(argv[2]) : 4;
+  float angle = argc > 3 ? static_cast<float>(std::atof(argv[3])) : 0.5f;
+
+  std::vector<std::unique_ptr<GravitySolver>> solvers;
+  solvers.push_back(std::make_unique<DirectGravity>());
+  solvers.push_back(std::make_unique<BarnesHutGravity>(angle, false));
+  solvers.push_back(std::make_unique<BarnesHutGravity>(angle, true));
+  solvers.push_back(std::make_unique<FastMultipoleGravity>(order, angle));
+  const char *labels[] = {"direct", "bh", "bh+quad", "fmm"};
+  const std::size_t solverCount = solvers.size();
+
+  std::printf("simd %s, %u threads, opening angle %.2f, fmm order %d\n",
+              getSimdLevelName(detectSimdLevel()), getThreadCount(), angle,
+              order);
+  std::printf("%9s", "bodies");
+  for (std::size_t s = 0; s < solverCount; ++s)
+    std::printf(" %11s ms %8s", labels[s], "error");
+  std::printf("\n");
+
+  // first body count each tree method beat direct summation at
+  std::vector<std::size_t> crossover(solverCount, 0);
+
+  for (std::size_t count = 1024; count <= maxBodies; count *= 2) {
+    BodyStore bodies = makeDisc(count, 1);
+    std::size_t stride = std::max<std::size_t>(1, count / sampleCount);
+    std::vector<glm::vec3> reference = referenceSample(bodies, stride);
+    int repeats = count <= 16384 ? 5 : 2;
+
+    std::printf("%9zu", count);
+    double directTime = 0.0;
+    for (std::size_t s = 0; s < solverCount; ++s) {
+      if (s == 0 && count > directLimit) {
+        // a body sees every other body, so the cost grows with count^2
+        std::printf(" %14s %8s", "-", "-");
+        continue;
+      }
+      double time = timeSolver(*solvers[s], bodies, repeats);
+      double error = meanRelativeError(bodies, reference, stride);
+      std::printf(" %14.2f %8.1e", time, error);
+      if (s == 0)
+        directTime = time;
+      else if (crossover[s] == 0 && directTime > 0.0 && time < directTime)
+        crossover[s] = count;
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+
+  for (std::size_t s = 1; s < solverCount; ++s) {
+    if (crossover[s])
+      std::printf("%s beats direct from %zu bodies\n", labels[s], crossover[s]);
+    else
+      std::printf("%s did not beat direct up to %zu bodies\n", labels[s],
+                  std::min(maxBodies, directLimit));
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <physics_thread.h>
+#include <snapshot_interpolator.h>
+
+// runs a PhysicsThread whose steps cost nothing, and ones whose steps take
+// longer than their period so it keeps falling behind and dropping ticks,
+// while a render loop at 144 Hz picks up snapshots. the check is that the
+// newest snapshot never gets further behind PhysicsThread::getTime than two
+// rounds of catch up steps plus two periods: the state is stamped with the
+// tick it belongs to, and the next one follows a round later. stamping by
+// steps taken instead would fall further behind with every dropped tick.
+//
+//   solar-sim-physics-bench [seconds]
+
+static const double frameRate = 144.0;
+static const int maxCatchUpSteps = 3;
+
+int main(int argc, char **argv) {
+  const double seconds = argc > 1 ? std::atof(argv[1]) : 1.5;
+  struct Case {
+    double rate;
+    double stepMs;
+  };
+  const Case cases[] = {{60.0, 0.0}, {60.0, 5.0}, {60.0, 25.0}, {30.0, 70.0}};
+
+  std::printf("%6s %8s %7s %8s %12s %11s %6s\n", "rate", "step ms", "steps",
+              "dropped", "worst lag ms", "blended %", "check");
+  bool allMatch = true;
+  for (const Case &c : cases) {
+    BodyStore bodies;
+    bodies.add(CelestialBody(1.0f, 1.0f, glm::vec3(0.0f), glm::vec3(0.0f)));
+    const auto cost = std::chrono::duration<double, std::milli>(c.stepMs);
+    PhysicsThread physics;
+    PhysicsSettings settings;
+    settings.rate = c.rate;
+    settings.maxCatchUpSteps = maxCatchUpSteps;
+    physics.start(
+        settings,
+        [&](float deltaTime) {
+          bodies.x[0] += deltaTime;
+          std::this_thread::sleep_for(cost);
+        },
+        [&](PhysicsSnapshot &snapshot) { snapshot.capture(bodies); });
+
+    SnapshotInterpolator interpolator;
+    double worstLag = 0.0;
+    int frames = 0, blended = 0;
+    while (physics.getTime() < seconds) {
+      if (physics.update())
+        interpolator.push(physics.latest());
+      const double now = physics.getTime();
+      worstLag = std::max(worstLag, now - physics.latest().time);
+      const float alpha = interpolator.getAlpha(now - 1.0 / c.rate);
+      blended += alpha > 0.0f && alpha < 1.0f;
+      ++frames;
+      std::this_thread::sleep_for(
+          std::chrono::duration<double>(1.0 / frameRate));
+    }
+    physics.stop();
+
+    const double bound =
+        (2.0 * maxCatchUpSteps * c.stepMs + 2000.0 / c.rate) * 1e-3 + 0.02;
+    const bool match = worstLag <= bound;
+    allMatch = allMatch && match;
+    std::printf("%6.0f %8.1f %7llu %8llu %12.1f %11.1f %6s\n", c.rate,
+                c.stepMs,
+                static_cast<unsigned long long>(physics.getStepCount()),
+                static_cast<unsigned long long>(physics.getDroppedCount()),
+                worstLag * 1e3, frames ? 100.0 * blended / frames : 0.0,
+                match ? "ok" : "FAIL");
+    std::fflush(stdout);
+  }
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+#include <body_bvh.h>
+#include <body_store.h>
+#include <cpu_features.h>
+#include <parallel.h>
+#include <ray_kernels.h>
+
+// times ray picking through a BodyBvh on growing clouds of bodies: the
+// build, a refit after every body moved, and closest and any hit queries
+// from a camera outside the cloud. the hits are checked against testing
+// every body. a second table casts the same rays as one packet against every
+// body with each vector kernel this CPU runs, checked against the scalar one.
+//
+//   solar-sim-picking-bench [maxBodies]
+
+static const int rayCount = 1000;
+// rays checked against every body
+static const int checkedRays = 100;
+
+// bodies per tile, as castRays uses
+static const std::size_t bodyTile = 4096;
+
+// the packet through one kernel, spread over threads like castRays
+static double timePacket(RayKernel kernel, const BodyStore &bodies,
+                         const RayPacket &packet, std::vector<float> &distances,
+                         std::vector<std::uint32_t> &hits) {
+  const BodyArrays arrays = bodies.arrays();
+  const RayArrays rays = packet.arrays();
+  distances.assign(rays.count, std::numeric_limits<float>::infinity());
+  hits.assign(rays.count, noBodyHit);
+  auto start = std::chrono::steady_clock::now();
+  parallelFor(0, rays.count, 64, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t j = 0; j < arrays.count; j += bodyTile)
+      kernel(arrays, j, j + bodyTile, rays, begin, end, distances.data(),
+             hits.data());
+  });
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static glm::vec3 cameraFor(std::size_t count) {
+  const float side = std::cbrt(1000.0f * count);
+  return glm::vec3(0.0f, 0.3f * side, -1.5f * side);
+}
+
+static std::vector<glm::vec3> aimRays(std::size_t count, std::mt19937 &rng) {
+  const float side = std::cbrt(1000.0f * count);
+  std::uniform_real_distribution<float> unit(-0.5f, 0.5f);
+  std::vector<glm::vec3> directions(rayCount);
+  for (glm::vec3 &direction : directions)
+    direction =
+        side * glm::vec3(unit(rng), unit(rng), unit(rng)) - cameraFor(count);
+  return directions;
+}
+
+static BodyStore makeCloud(std::size_t count, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> size(0.2f, 1.0f);
+  // about 1000 volume per body keeps the crowding the same
+  const float side = std::cbrt(1000.0f * count);
+  BodyStore bodies;
+  bodies.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+    bodies.add(CelestialBody(size(rng), 1.0f,
+                             0.5f * side *
+                                 glm::vec3(unit(rng), unit(rng), unit(rng)),
+                             glm::vec3(0.0f)));
+  return bodies;
+}
+
+static bool bruteForce(const BodyStore &bodies, const glm::vec3 &origin,
+                       const glm::vec3 &direction, BodyHit &hit) {
+  const glm::dvec3 unit = glm::normalize(glm::dvec3(direction));
+  bool found = false;
+  for (std::uint32_t i = 0; i < bodies.size(); ++i) {
+    glm::dvec3 offset =
+        glm::dvec3(bodies.x[i], bodies.y[i], bodies.z[i]) -
+        glm::dvec3(origin);
+    double b = glm::dot(offset, unit);
+    double c = glm::dot(offset, offset) -
+               double(bodies.radius[i]) * bodies.radius[i];
+    double discriminant = b * b - c;
+    if (discriminant < 0.0)
+      continue;
+    double distance = b - std::sqrt(discriminant);
+    if (distance < 0.0)
+      distance = b + std::sqrt(discriminant);
+    if (distance >= 0.0 && (!found || distance < hit.distance)) {
+      hit = {i, static_cast<float>(distance)};
+      found = true;
+    }
+  }
+  return found;
+}
+
+int main(int argc, char **argv) {
+  std::size_t maxBodies =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20;
+
+  std::printf("%u threads\n", getThreadCount());
+  std::printf("%9s %9s %10s %10s %11s %11s %6s\n", "bodies", "nodes",
+              "build ms", "refit ms", "closest us", "any us", "check");
+
+  bool allMatch = true;
+  for (std::size_t count = 1024; count <= maxBodies; count *= 4) {
+    BodyStore bodies = makeCloud(count, 1);
+    BodyBvh bvh;
+    auto start = std::chrono::steady_clock::now();
+    bvh.build(bodies);
+    double buildTime = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+    // every body drifts a little, as over one step
+    std::mt19937 rng(2);
+    std::normal_distribution<float> drift(0.0f, 0.5f);
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+      bodies.x[i] += drift(rng);
+      bodies.y[i] += drift(rng);
+      bodies.z[i] += drift(rng);
+    }
+    start = std::chrono::steady_clock::now();
+    bvh.refit(bodies);
+    double refitTime = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+    // rays from a camera outside the cloud towards random points in it
+    const glm::vec3 camera = cameraFor(count);
+    const std::vector<glm::vec3> directions = aimRays(count, rng);
+
+    std::vector<BodyHit> hits(rayCount);
+    std::vector<char> found(rayCount);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rayCount; ++r)
+      found[r] = bvh.closestHit(bodies, camera, directions[r],
+                                std::numeric_limits<float>::infinity(),
+                                hits[r]);
+    double closestTime = std::chrono::duration<double, std::micro>(
+                             std::chrono::steady_clock::now() - start)
+                             .count() /
+                         rayCount;
+
+    std::vector<char> anyFound(rayCount);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rayCount; ++r)
+      anyFound[r] = bvh.anyHit(bodies, camera, directions[r],
+                               std::numeric_limits<float>::infinity());
+    double anyTime = std::chrono::duration<double, std::micro>(
+                         std::chrono::steady_clock::now() - start)
+                         .count() /
+                     rayCount;
+
+    bool match = true;
+    for (int r = 0; r < rayCount; ++r)
+      match = match && anyFound[r] == found[r];
+    for (int r = 0; r < checkedRays; ++r) {
+      BodyHit expected;
+      bool hit = bruteForce(bodies, camera, directions[r], expected);
+      match = match && hit == bool(found[r]) &&
+              (!hit || expected.body == hits[r].body ||
+               std::fabs(expected.distance - hits[r].distance) <=
+                   1e-4f * expected.distance);
+    }
+    allMatch = allMatch && match;
+    std::printf("%9zu %9zu %10.2f %10.2f %11.2f %11.2f %6s\n", count,
+                bvh.getNodeCount(), buildTime, refitTime, closestTime,
+                anyTime, match ? "ok" : "FAIL");
+    std::fflush(stdout);
+  }
+
+  std::printf("\n%9s %8s %10s %12s %6s\n", "bodies", "kernel", "packet ms",
+              "Mtests/s", "check");
+  const SimdLevel widest = detectSimdLevel();
+  for (std::size_t count = 1024; count <= maxBodies; count *= 4) {
+    const BodyStore bodies = makeCloud(count, 1);
+    std::mt19937 rng(3);
+    RayPacket packet;
+    for (const glm::vec3 &direction : aimRays(count, rng))
+      packet.add(cameraFor(count), direction);
+
+    std::vector<float> expected;
+    std::vector<std::uint32_t> expectedHits;
+    for (int l = int(SimdLevel::Scalar); l <= int(widest); ++l) {
+      const SimdLevel level = static_cast<SimdLevel>(l);
+      std::vector<float> distances;
+      std::vector<std::uint32_t> hits;
+      const double time =
+          timePacket(getRayKernel(level), bodies, packet, distances, hits);
+      if (level == SimdLevel::Scalar) {
+        expected = distances;
+        expectedHits = hits;
+      }
+      bool match = true;
+      for (int r = 0; r < rayCount; ++r)
+        match = match && (hits[r] == noBodyHit) ==
+                             (expectedHits[r] == noBodyHit) &&
+                (hits[r] == expectedHits[r] ||
+                 std::fabs(distances[r] - expected[r]) <=
+                     1e-4f * expected[r]);
+      allMatch = allMatch && match;
+      std::printf("%9zu %8s %10.2f %12.1f %6s\n", count,
+                  getSimdLevelName(level), time,
+                  double(count) * rayCount / time * 1e-3,
+                  match ? "ok" : "FAIL");
+      std::fflush(stdout);
+    }
+  }
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <accretion.h>
+#include <block_integrator.h>
+#include <checkpoint.h>
+#include <continuous_collision.h>
+#include <cpu_features.h>
+#include <ensemble.h>
+#include <pair_force.h>
+#include <parallel.h>
+#include <precision.h>
+#include <scene.h>
+#include <trajectory_reader.h>
+#include <trajectory_writer.h>
+
+// runs a scene without window or GL context and reports throughput.
+//
+//   solar-sim-headless <scene> [--steps N | --time T] [--timestep DT]
+//                      [--energy] [--merge] [--ccd] [--restore FILE]
+//                      [--save FILE]
+//                      [--trajectory FILE [--every K] [--slots N] [--wait]
+//                                         [--compress [--bits B]]]
+//                      [--ensemble N [--spread S] [--eject D]]
+//   solar-sim-headless --replay FILE
+//
+// --time runs whole steps until T of simulated time has passed; without
+// either limit 1000 steps are taken. --energy measures the relative energy
+// error over the run, an O(n^2) sum at both ends. --restore continues from a
+// checkpoint instead of the bodies of the scene, which still supplies the
+// gravity solver and the integrator, and --save writes one after the run.
+// --merge merges touching bodies after every step through an Accretion.
+// --ccd counts the pairs that touched at any time during a step, with swept
+// spheres through a ContinuousCollision, and with --merge merges those
+// instead of the ones touching at its end.
+//
+// --trajectory streams every Kth step (every step by default) to FILE through
+// a TrajectoryWriter with N slots (64 by default). frames that find the ring
+// full are dropped unless --wait makes the simulation wait for the writer.
+// --compress stores the positions only, quantized to B bits (20 by default)
+// and entropy coded by TrajectoryEncoder.
+//
+// --replay decodes every frame of a trajectory file and reports how fast.
+//
+// --ensemble runs N copies of the scene side by side in an Ensemble, with
+// every velocity scaled by a random factor within 1 +- S (0.01 by default),
+// and reports how many systems survived. systems retire once a body gets
+// farther than D from their centre of mass, or once their energy drifted by
+// more than 1%. the scene's gravity solver and integrator are not used there,
+// and --merge, --ccd, --restore, --save and --trajectory are refused.
+
+static void usage() {
+  std::fprintf(stderr, "usage: solar-sim-headless <scene> [--steps N | "
+                       "--time T] [--timestep DT] [--energy] [--merge] "
+                       "[--ccd] [--restore FILE] [--save FILE] "
+                       "[--trajectory FILE [--every K] [--slots N] [--wait] "
+                       "[--compress [--bits B]]] "
+                       "[--ensemble N [--spread S] [--eject D]]\n"
+                       "       solar-sim-headless --replay FILE\n");
+}
+
+// kinetic plus potential energy, with the potential of the clamped force
+static double totalEnergy(const BodyStore &bodies) {
+  const std::size_t n = bodies.size();
+  std::vector<double> partial(n, 0.0);
+  parallelFor(0, n, 64, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      double mass = bodies.mass[i];
+      double energy = 0.5 * mass *
+                      (double(bodies.vx[i]) * bodies.vx[i] +
+                       double(bodies.vy[i]) * bodies.vy[i] +
+                       double(bodies.vz[i]) * bodies.vz[i]);
+      for (std::size_t j = i + 1; j < n; ++j) {
+        double dx = double(bodies.x[j]) - bodies.x[i];
+        double dy = double(bodies.y[j]) - bodies.y[i];
+        double dz = double(bodies.z[j]) - bodies.z[i];
+        energy += mass * bodies.mass[j] *
+                  pairPotential<double>(dx * dx + dy * dy + dz * dz,
+                                        bodies.radius[i], bodies.radius[j]);
+      }
+      partial[i] = energy;
+    }
+  });
+
+  double total = 0.0;
+  for (double energy : partial)
+    total += energy;
+  return total;
+}
+
+static int runEnsemble(const Scene &scene, long long steps,
+                       std::size_t systemCount, float spread,
+                       double ejectionDistance) {
+  Ensemble ensemble(scene.bodies.size());
+  ensemble.setEjectionDistance(ejectionDistance);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> factor(1.0f - spread, 1.0f + spread);
+  BodyStore system = scene.bodies;
+  std::string error;
+  for (std::size_t s = 0; s < systemCount; ++s) {
+    for (std::size_t i = 0; i < system.size(); ++i) {
+      float scale = factor(random);
+      system.vx[i] = scene.bodies.vx[i] * scale;
+      system.vy[i] = scene.bodies.vy[i] * scale;
+      system.vz[i] = scene.bodies.vz[i] * scale;
+    }
+    if (!ensemble.addSystem(system, error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+  }
+
+  std::printf("systems           %zu\n", systemCount);
+  std::printf("bodies/system     %zu\n", scene.bodies.size());
+  std::printf("integrator        leapfrog\n");
+  std::printf("precision         %s\n", Precision::name);
+  std::printf("simd              %s\n", getSimdLevelName(detectSimdLevel()));
+  std::printf("threads           %u\n", getThreadCount());
+  std::fflush(stdout);
+
+  auto start = std::chrono::steady_clock::now();
+  ensemble.run(static_cast<std::size_t>(steps), scene.timeStep);
+  auto stop = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(stop - start).count();
+
+  std::size_t ejected = 0, diverged = 0;
+  double systemSteps = 0.0, worstError = 0.0;
+  for (std::size_t s = 0; s < systemCount; ++s) {
+    SystemState state = ensemble.getState(s);
+    ejected += state == SystemState::Ejected;
+    diverged += state == SystemState::Diverged;
+    systemSteps += static_cast<double>(ensemble.getStepCount(s));
+    if (state == SystemState::Running)
+      worstError = std::max(worstError, std::fabs(ensemble.getEnergyError(s)));
+  }
+
+  std::printf("steps             %lld\n", steps);
+  std::printf("simulated time    %g\n", steps * double(scene.timeStep));
+  std::printf("wall time         %.3f s\n", seconds);
+  std::printf("running           %zu\n", ensemble.getRunningCount());
+  std::printf("ejected           %zu\n", ejected);
+  std::printf("diverged          %zu\n", diverged);
+  if (seconds > 0.0) {
+    std::printf("system steps/s    %.4g\n", systemSteps / seconds);
+    std::printf("body steps/s      %.4g\n",
+                systemSteps * scene.bodies.size() / seconds);
+  }
+  std::printf("worst energy err  %.3e\n", worstError);
+  return 0;
+}
+
+// plays a trajectory back as fast as it decodes
+static int replayTrajectory(const char *path) {
+  TrajectoryReader reader;
+  std::string error;
+  if (!reader.open(path, error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  std::printf("trajectory        %s\n", path);
+  std::printf("format            %s\n",
+              reader.isCompressed() ? "compressed" : "raw");
+  std::printf("frames            %zu\n", reader.getFrameCount());
+  std::printf("threads           %u\n", getThreadCount());
+  std::fflush(stdout);
+
+  BodyStore bodies;
+  double bodyFrames = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t frame = 0; frame < reader.getFrameCount(); ++frame) {
+    if (!reader.readFrame(frame, bodies, error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    bodyFrames += static_cast<double>(bodies.size());
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::printf("bytes per body    %.2f\n",
+              bodyFrames > 0.0 ? reader.getFileSize() / bodyFrames : 0.0);
+  std::printf("wall time         %.3f s\n", seconds);
+  if (seconds > 0.0) {
+    std::printf("frames/s          %.1f\n", reader.getFrameCount() / seconds);
+    std::printf("bodies/s          %.4g\n", bodyFrames / seconds);
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 1;
+  }
+  if (!std::strcmp(argv[1], "--replay")) {
+    if (argc != 3) {
+      usage();
+      return 1;
+    }
+    return replayTrajectory(argv[2]);
+  }
+
+  long long steps = -1;
+  double duration = -1.0;
+  float timeStep = 0.0f;
+  bool measureEnergy = false;
+  bool mergeBodies = false;
+  bool sweepBodies = false;
+  long long systemCount = 0;
+  float spread = 0.01f;
+  double ejectionDistance = std::numeric_limits<double>::infinity();
+  const char *restorePath = nullptr;
+  const char *savePath = nullptr;
+  const char *trajectoryPath = nullptr;
+  long long trajectoryEvery = 1;
+  TrajectorySettings trajectorySettings;
+  for (int i = 2; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--steps") && hasValue) {
+      steps = std::atoll(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--time") && hasValue) {
+      duration = std::atof(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--timestep") && hasValue) {
+      timeStep = static_cast<float>(std::atof(argv[++i]));
+    } else if (!std::strcmp(argv[i], "--energy")) {
+      measureEnergy = true;
+    } else if (!std::strcmp(argv[i], "--merge")) {
+      mergeBodies = true;
+    } else if (!std::strcmp(argv[i], "--ccd")) {
+      sweepBodies = true;
+    } else if (!std::strcmp(argv[i], "--ensemble") && hasValue) {
+      systemCount = std::atoll(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--spread") && hasValue) {
+      spread = static_cast<float>(std::atof(argv[++i]));
+    } else if (!std::strcmp(argv[i], "--eject") && hasValue) {
+      ejectionDistance = std::atof(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--restore") && hasValue) {
+      restorePath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--save") && hasValue) {
+      savePath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--trajectory") && hasValue) {
+      trajectoryPath = argv[++i];
+    } else if (!std::strcmp(argv[i], "--every") && hasValue) {
+      trajectoryEvery = std::max(1LL, std::atoll(argv[++i]));
+    } else if (!std::strcmp(argv[i], "--slots") && hasValue) {
+      trajectorySettings.slotCount = static_cast<std::size_t>(
+          std::max(1LL, std::atoll(argv[++i])));
+    } else if (!std::strcmp(argv[i], "--wait")) {
+      trajectorySettings.backpressure = TrajectoryBackpressure::Wait;
+    } else if (!std::strcmp(argv[i], "--compress")) {
+      trajectorySettings.compress = true;
+    } else if (!std::strcmp(argv[i], "--bits") && hasValue) {
+      trajectorySettings.codec.bits =
+          static_cast<unsigned>(std::atoi(argv[++i]));
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  // an ensemble steps its own copies of the scene, none of which merge,
+  // stream or checkpoint
+  if (systemCount > 0 && (mergeBodies || sweepBodies || restorePath ||
+                          savePath || trajectoryPath)) {
+    usage();
+    return 1;
+  }
+
+  Scene scene;
+  std::string error;
+  if (!loadScene(argv[1], scene, error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  if (timeStep > 0.0f)
+    scene.timeStep = timeStep;
+  if (steps < 0)
+    steps = duration >= 0.0
+                ? static_cast<long long>(std::ceil(duration / scene.timeStep))
+                : 1000;
+  if (systemCount > 0)
+    return runEnsemble(scene, steps, static_cast<std::size_t>(systemCount),
+                       spread, ejectionDistance);
+
+  BodyStore &bodies = scene.bodies;
+  std::unique_ptr<GravitySolver> gravity = createGravitySolver(scene.gravity);
+  std::unique_ptr<Integrator> integrator = createIntegrator(scene.integrator);
+
+  double startTime = 0.0;
+  std::uint64_t startSteps = 0;
+  if (restorePath) {
+    auto restoreStart = std::chrono::steady_clock::now();
+    Checkpoint checkpoint;
+    if (!checkpoint.open(restorePath, error) ||
+        !checkpoint.restore(bodies, *integrator, error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    startTime = checkpoint.getTime();
+    startSteps = checkpoint.getSteps();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - restoreStart)
+                         .count();
+    std::printf("restored          %s, time %g (%.3f s)\n", restorePath,
+                startTime, seconds);
+  }
+
+  std::printf("scene             %s\n", argv[1]);
+  std::printf("bodies            %zu\n", bodies.size());
+  std::printf("gravity           %s\n", gravity->getName());
+  std::printf("integrator        %s\n", integrator->getName());
+  std::printf("precision         %s\n", Precision::name);
+  std::printf("simd              %s\n", getSimdLevelName(detectSimdLevel()));
+  std::printf("threads           %u\n", getThreadCount());
+  std::fflush(stdout);
+
+  TrajectoryWriter trajectory;
+  if (trajectoryPath &&
+      !trajectory.open(trajectoryPath, bodies.size(), trajectorySettings,
+                       error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  double startEnergy = measureEnergy ? totalEnergy(bodies) : 0.0;
+
+  // per body and step, summed as it goes since merges shrink the store. the
+  // block integrators step only some bodies per step and count per force
+  // evaluation instead, from where a restored run left off.
+  auto *block = dynamic_cast<BlockTimestepIntegrator *>(integrator.get());
+  const std::uint64_t startEvaluations =
+      block ? block->getForceEvaluations() : 0;
+  double bodySteps = 0.0;
+  Accretion accretion;
+  ContinuousCollision sweep;
+  std::vector<BodyImpact> impacts;
+  std::vector<BodyPair> touching;
+  unsigned long long impactCount = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long long step = 0; step < steps; ++step) {
+    if (!block)
+      bodySteps += static_cast<double>(bodies.size());
+    if (sweepBodies)
+      sweep.begin(bodies);
+    integrator->step(bodies, *gravity, scene.timeStep);
+    std::size_t merged = 0;
+    if (sweepBodies) {
+      sweep.findImpacts(bodies, impacts);
+      impactCount += impacts.size();
+      if (mergeBodies) {
+        touching.clear();
+        for (const BodyImpact &impact : impacts)
+          touching.push_back(BodyPair{impact.first, impact.second});
+        merged = accretion.merge(bodies, touching);
+      }
+    } else if (mergeBodies) {
+      merged = accretion.merge(bodies);
+    }
+    if (merged > 0)
+      integrator->reset();
+    if (trajectoryPath && (step + 1) % trajectoryEvery == 0)
+      trajectory.submit(bodies, startTime + (step + 1) * double(scene.timeStep),
+                        startSteps + step + 1);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(stop - start).count();
+  if (block)
+    bodySteps =
+        static_cast<double>(block->getForceEvaluations() - startEvaluations);
+
+  std::printf("steps             %lld\n", steps);
+  std::printf("simulated time    %g\n", steps * double(scene.timeStep));
+  std::printf("wall time         %.3f s\n", seconds);
+  if (seconds > 0.0) {
+    std::printf("steps/s           %.1f\n", steps / seconds);
+    std::printf("body steps/s      %.4g\n", bodySteps / seconds);
+  }
+  if (sweepBodies)
+    std::printf("impacts           %llu\n", impactCount);
+  if (mergeBodies)
+    std::printf("merged            %llu, %zu bodies left\n",
+                static_cast<unsigned long long>(accretion.getRemovedCount()),
+                bodies.size());
+  if (block) {
+    std::printf("force evaluations %.0f\n", bodySteps);
+    if (seconds > 0.0)
+      std::printf("evaluations/s     %.4g\n", bodySteps / seconds);
+  }
+  if (measureEnergy) {
+    double endEnergy = totalEnergy(bodies);
+    std::printf("energy error      %.3e\n",
+                startEnergy != 0.0
+                    ? (endEnergy - startEnergy) / std::fabs(startEnergy)
+                    : endEnergy - startEnergy);
+  }
+  if (trajectoryPath) {
+    // waits for the writer to drain the ring
+    const char *backend = trajectory.getBackendName();
+    trajectory.close();
+    TrajectoryStats stats = trajectory.getStats();
+    std::printf("trajectory        %s (%s)\n", trajectoryPath,
+                backend);
+    std::printf("frames written    %llu of %llu, %llu dropped\n",
+                static_cast<unsigned long long>(stats.framesWritten),
+                static_cast<unsigned long long>(stats.framesSubmitted),
+                static_cast<unsigned long long>(stats.framesDropped));
+    std::printf("writer stalls     %llu (%.3f s)\n",
+                static_cast<unsigned long long>(stats.stalls),
+                stats.stallSeconds);
+    std::printf("bytes written     %.1f MB in %llu writes, peak queue %zu\n",
+                stats.bytesWritten / 1e6,
+                static_cast<unsigned long long>(stats.writes),
+                stats.peakQueued);
+    if (trajectory.hasFailed()) {
+      std::fprintf(stderr, "trajectory: write to %s failed\n",
+                   trajectoryPath);
+      return 1;
+    }
+  }
+  if (savePath) {
+    auto saveStart = std::chrono::steady_clock::now();
+    if (!saveCheckpoint(savePath, bodies, *integrator,
+                        startTime + steps * double(scene.timeStep),
+                        startSteps + steps, error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - saveStart)
+                         .count();
+    std::printf("saved             %s (%.3f s)\n", savePath, seconds);
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef ACCRETION_H
+#define ACCRETION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <body_store.h>
+#include <broadphase.h>
+
+// one body swallowed by another, by id
+struct AccretionMerge {
+  std::uint32_t survivor, absorbed;
+};
+
+// perfectly inelastic collisions: touching bodies merge into one that keeps
+// their total mass, momentum and volume and sits at their centre of mass.
+// bodies that touch in a chain, a touching b touching c, merge as one group.
+// the most massive body of a group survives, the lowest index on a tie.
+//
+// call merge once per step. the broadphase finds every touching pair, the
+// groups are merged, and all absorbed bodies leave the store in one
+// compaction pass, so a step costs the same whether it removes one body or
+// a hundred thousand.
+//
+// merges name bodies by BodyStore::id, which stays with a body as the store
+// shrinks, so outputs can follow bodies across merges.
+class Accretion {
+public:
+  // merges touching bodies and compacts the store, returns the number of
+  // bodies removed. integrators that cache anything per body need a reset
+  // afterwards if this is not 0.
+  std::size_t merge(BodyStore &bodies);
+  // the same for the given touching pairs, from a ContinuousCollision say,
+  // instead of the overlaps at the current positions
+  std::size_t merge(BodyStore &bodies, const std::vector<BodyPair> &touching);
+
+  // index in the store after the last merge of every body before it; the
+  // absorbed bodies map to their survivor. empty if nothing merged.
+  const std::vector<std::uint32_t> &getRemap() const { return remap; }
+  // merges of the last call, group by group
+  const std::vector<AccretionMerge> &getMerges() const { return merges; }
+  // bodies removed since construction
+  std::uint64_t getRemovedCount() const { return removedCount; }
+
+  const Broadphase &getBroadphase() const { return broadphase; }
+
+private:
+  Broadphase broadphase;
+  std::vector<BodyPair> pairs;
+  std::vector<std::uint32_t> remap;
+  std::vector<AccretionMerge> merges;
+  // union find over the bodies in a pair, parent of each of them; absorbed
+  // bodies point at their survivor once merged
+  std::vector<std::uint32_t> parent;
+  // group << 32 | body for every body in a pair, sorted
+  std::vector<std::uint64_t> members;
+  std::vector<std::uint32_t> removed;
+  std::uint64_t removedCount = 0;
+
+  std::uint32_t findGroup(std::uint32_t body);
+  void mergeGroup(BodyStore &bodies, const std::uint64_t *begin,
+                  const std::uint64_t *end);
+};
+
+#endif
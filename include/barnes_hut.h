@@ -0,0 +1,55 @@
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <gravity_solver.h>
+#include <octree.h>
+
+// O(n log n) tree gravity. a cell whose bodies are far enough away is
+// replaced by its monopole, optionally with the quadrupole correction. a cell
+// is accepted when bmax / distance < openingAngle, where bmax is the distance
+// from its centre of mass to the farthest corner, so a body is never inside
+// an accepted cell. angles above 1 are clamped to 1 for the same reason.
+class BarnesHutGravity : public GravitySolver {
+public:
+  explicit BarnesHutGravity(float openingAngle = 0.5f,
+                            bool useQuadrupole = false,
+                            std::uint32_t leafCapacity = 16);
+
+  void computeAccelerations(BodyStore &bodies) override;
+  void
+  computeActiveAccelerations(BodyStore &bodies,
+                             const std::vector<std::uint32_t> &active) override;
+  const char *getName() const override { return "barnes-hut"; }
+
+  void setOpeningAngle(float angle);
+  float getOpeningAngle() const { return openingAngle; }
+  void setQuadrupole(bool enabled) { useQuadrupole = enabled; }
+  bool getQuadrupole() const { return useQuadrupole; }
+  void setLeafCapacity(std::uint32_t capacity);
+
+  const Octree &getTree() const { return tree; }
+
+private:
+  struct CellMoments {
+    glm::vec3 centerOfMass;
+    float mass;
+    float bmaxSquared;
+    // traceless quadrupole about the centre of mass: xx, yy, zz, xy, xz, yz
+    float quadrupole[6];
+  };
+
+  Octree tree;
+  std::vector<CellMoments> moments;
+  float openingAngle;
+  bool useQuadrupole;
+  std::uint32_t leafCapacity;
+
+  void buildTree(const BodyStore &bodies);
+  void computeMoments(const BodyStore &bodies, std::uint32_t index);
+  glm::vec3 accelerationOn(const BodyStore &bodies, std::uint32_t body) const;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef BLOCK_INTEGRATOR_H
+#define BLOCK_INTEGRATOR_H
+
+#include <cstdint>
+#include <vector>
+#include <integrator.h>
+
+// hierarchical block timesteps. body i steps with deltaTime / 2^level[i], and
+// a step of deltaTime runs 2^(levelCount - 1) ticks of the finest level; at
+// each tick only the bodies whose step ends there are active. all bodies are
+// predicted to the tick, forces are computed for the active ones only, and
+// those are corrected with a second order predictor-corrector:
+//
+//   x1 = x0 + v0 h + a0 h^2 / 2 + j h^3 / 6, v1 = v0 + (a0 + a1) h / 2
+//
+// with the jerk j = (a1 - a0) / h. a body then takes the largest level step
+// that meets both
+//
+//   h < accuracy * |a| / |j|              (acceleration changes slowly)
+//   h < sqrt(accuracy * (r + 1) / |a|)     (does not cross its own clamp
+//                                           distance within a step)
+//
+// a step only grows at ticks the longer step is aligned to, so steps always
+// nest. every body is back in sync at the end of step, which leaves the
+// store ready for rendering or output. subclasses swap in their own force
+// evaluation, corrector and step criterion through the protected hooks.
+class BlockTimestepIntegrator : public Integrator {
+public:
+  static constexpr int maxLevelCount = 24;
+
+  explicit BlockTimestepIntegrator(int levelCount = 8,
+                                   float accuracy = 0.02f);
+
+  void step(BodyStore &bodies, GravitySolver &gravity,
+            float deltaTime) override;
+  void reset() override { stepSize = 0.0f; }
+  const char *getName() const override { return "block"; }
+  void visitState(IntegratorStateVisitor &visitor) override;
+
+  void setLevelCount(int count);
+  int getLevelCount() const { return levelCount; }
+  void setAccuracy(float value) { accuracy = value; }
+  float getAccuracy() const { return accuracy; }
+
+  // step level of every body, 0 takes the whole deltaTime
+  const std::vector<std::uint8_t> &getLevels() const { return levels; }
+  // bodies whose acceleration was computed, summed over all ticks so far
+  std::uint64_t getForceEvaluations() const { return forceEvaluations; }
+  // what a shared step at the finest level any body used would have needed
+  std::uint64_t getSharedEvaluations() const { return sharedEvaluations; }
+
+protected:
+  int levelCount;
+  float accuracy;
+  // deltaTime the state below was set up for, 0 before the first step
+  float stepSize = 0.0f;
+
+  // state of every body at the end of its last step
+  AlignedVector<BodyStore::Position> x0, y0, z0;
+  AlignedVector<BodyStore::Position> vx0, vy0, vz0;
+  AlignedVector<BodyStore::Accumulator> ax0, ay0, az0;
+  AlignedVector<BodyStore::Accumulator> jx, jy, jz;
+  std::vector<std::uint8_t> levels;
+  // tick the last step ended at, counted from the start of step
+  std::vector<std::uint32_t> lastTick;
+  std::vector<std::uint32_t> active;
+
+  std::uint64_t forceEvaluations = 0;
+  std::uint64_t sharedEvaluations = 0;
+
+  // accelerations of the active bodies, or of all of them, into bodies.ax
+  virtual void evaluate(BodyStore &bodies, GravitySolver &gravity, bool all);
+  // takes the state of body i after the first evaluate
+  virtual void initializeBody(const BodyStore &bodies, std::size_t i);
+  // ends the step of body i, h long, with the new accelerations in the
+  // store, and leaves its new state in x0 ... jz
+  virtual void correctBody(const BodyStore &bodies, std::size_t i,
+                           BodyStore::Position h);
+  // longest step body i should take next
+  virtual float wantedStep(std::size_t i, float radius) const;
+
+private:
+  void initialize(BodyStore &bodies, GravitySolver &gravity);
+  std::uint32_t ticksPerStep(int level) const {
+    return 1u << (levelCount - 1 - level);
+  }
+  int chooseLevel(std::size_t i, float radius, std::uint32_t tick) const;
+  void predict(BodyStore &bodies, std::uint32_t tick, double tickSize);
+  void correct(BodyStore &bodies, std::uint32_t tick, double tickSize);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef BODY_ARRAYS_H
+#define BODY_ARRAYS_H
+
+#include <cstddef>
+#include <precision.h>
+
+// raw pointers into a BodyStore for the vector kernels. the kernels for each
+// instruction set are compiled with their own target flags and only see this
+// struct, so no inline library code gets built with instructions that the
+// rest of the program cannot run.
+template <typename Policy> struct BasicBodyArrays {
+  const typename Policy::Position *x;
+  const typename Policy::Position *y;
+  const typename Policy::Position *z;
+  const typename Policy::Pair *mass;
+  const typename Policy::Pair *radius;
+  std::size_t count;
+};
+
+using BodyArrays = BasicBodyArrays<Precision>;
+// what the hand written vector kernels work on
+using FloatBodyArrays = BasicBodyArrays<FloatPrecision>;
+
+// raw pointers into an Ensemble for the ensemble kernels. systems sit side by
+// side, one per lane of a block: body b of the system in lane l of block k is
+// element (k * bodiesPerSystem + b) * lanes + l of every array.
+template <typename Policy> struct BasicEnsembleArrays {
+  static constexpr std::size_t lanes = 16;
+
+  const typename Policy::Position *x;
+  const typename Policy::Position *y;
+  const typename Policy::Position *z;
+  const typename Policy::Pair *mass;
+  const typename Policy::Pair *radius;
+  std::size_t bodiesPerSystem;
+};
+
+using EnsembleArrays = BasicEnsembleArrays<Precision>;
+using FloatEnsembleArrays = BasicEnsembleArrays<FloatPrecision>;
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef BODY_BVH_H
+#define BODY_BVH_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <body_store.h>
+
+// a body hit by a ray and how far along the ray
+struct BodyHit {
+  std::uint32_t body;
+  float distance;
+};
+
+struct BvhNode {
+  glm::vec3 low, high;
+};
+
+// bounding volume hierarchy over the spheres of all bodies, for picking and
+// hover queries that would otherwise test every body. bodies are sorted
+// along a morton curve and cut into leaves of leafSize neighbours; the tree
+// above them is complete and implicit, node i having children 2i + 1 and
+// 2i + 2, so it needs no pointers and never changes shape.
+//
+// bodies move every step but mostly stay near their morton neighbours, so
+// the boxes are refit bottom up, one level at a time on all threads, instead
+// of sorting again. update rebuilds only once the body count changed or the
+// boxes have grown too loose.
+class BodyBvh {
+public:
+  static constexpr std::uint32_t leafSize = 4;
+  // update rebuilds once the summed box area grew this many times over its
+  // value at the last build
+  static constexpr double rebuildGrowth = 2.0;
+
+  // sorts the bodies and fits every box
+  void build(const BodyStore &bodies);
+  // fits every box to the bodies where they are now; the bodies have to be
+  // the ones of the last build
+  void refit(const BodyStore &bodies);
+  // refit, or build if that would leave the tree out of date or too loose
+  void update(const BodyStore &bodies);
+
+  // nearest body the ray from origin along direction enters within
+  // maxDistance, or leaves if origin is inside it. direction need not be
+  // normalized; distances are in scene units.
+  bool closestHit(const BodyStore &bodies, const glm::vec3 &origin,
+                  const glm::vec3 &direction, float maxDistance,
+                  BodyHit &hit) const;
+  // whether the ray meets any body within maxDistance, stopping at the
+  // first one found
+  bool anyHit(const BodyStore &bodies, const glm::vec3 &origin,
+              const glm::vec3 &direction, float maxDistance) const;
+
+  std::size_t getBodyCount() const { return order.size(); }
+  std::size_t getNodeCount() const { return nodes.size(); }
+  // builds since construction, refits excluded
+  std::size_t getBuildCount() const { return buildCount; }
+
+private:
+  std::vector<BvhNode> nodes;
+  // body indices in morton order, leaf k holds order[k * leafSize, ...)
+  std::vector<std::uint32_t> order;
+  // position of every body in order, and the box of each in that order
+  std::vector<std::uint32_t> slots;
+  std::vector<BvhNode> bodyBoxes;
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> keys;
+  // first node of the leaf level
+  std::size_t firstLeaf = 0;
+  double builtArea = 0.0;
+  std::size_t buildCount = 0;
+
+  double totalArea() const;
+  template <bool Any>
+  bool traverse(const BodyStore &bodies, const glm::vec3 &origin,
+                const glm::vec3 &direction, float maxDistance,
+                BodyHit &hit) const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef BODY_RENDERER_H
+#define BODY_RENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <model_loader.h>
+#include <physics_thread.h>
+#include <shader_loader.h>
+
+// per instance attributes, streamed to the instance buffer every frame
+struct BodyInstance {
+  // centre in xyz, radius in w
+  glm::vec4 positionRadius;
+  // rgba, normalized by the vertex fetch
+  std::uint8_t colour[4];
+};
+
+// draws bodies instanced: every model gets an instance buffer that is
+// refilled each frame, and each of its meshes is drawn for all of its bodies
+// with one glDrawElementsInstanced. draw calls grow with the number of
+// meshes, not of bodies. the shader reads the mesh vertex at location 0 and
+// its normal at 1, and the instance at 3 and 4, see bodies.vert.
+class BodyRenderer {
+public:
+  BodyRenderer() = default;
+  ~BodyRenderer();
+  BodyRenderer(const BodyRenderer &) = delete;
+  BodyRenderer &operator=(const BodyRenderer &) = delete;
+
+  // adds a model to draw bodies with and returns its index. the meshes keep
+  // their own vertex arrays; the renderer binds their buffers into vertex
+  // arrays of its own next to the instance buffer.
+  std::size_t addModel(const std::vector<Mesh> &meshes);
+
+  // this frame's bodies of model, one colour per body index
+  void setInstances(std::size_t model, const PhysicsSnapshot &state);
+  // the same list, for callers that fill in instances of their own
+  std::vector<BodyInstance> &getInstances(std::size_t model) {
+    return models[model].instances;
+  }
+
+  // uploads every model's instances and draws them, with projection and
+  // view from the Frame uniform block
+  void render(Shader &shader);
+
+  // draw calls issued by the last render
+  std::size_t getDrawCount() const { return drawCount; }
+
+private:
+  struct Part {
+    GLuint vertexArray;
+    GLsizei indexCount;
+  };
+  struct Model {
+    GLuint instanceBuffer = 0;
+    // instances the buffer has room for
+    std::size_t capacity = 0;
+    std::vector<Part> parts;
+    std::vector<BodyInstance> instances;
+  };
+
+  std::vector<Model> models;
+  std::size_t drawCount = 0;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef BODY_STORE_H
+#define BODY_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <aligned_allocator.h>
+#include <body_arrays.h>
+#include <celestial_body.h>
+#include <precision.h>
+
+template <typename Policy> class BasicBodyStore;
+
+// reference to one body inside a BodyStore that offers the same operations as
+// CelestialBody, so code written against the old struct keeps working
+template <typename Policy> class BasicBodyView {
+public:
+  BasicBodyView(BasicBodyStore<Policy> &store, std::size_t index);
+
+  glm::vec3 getPosition() const;
+  glm::vec3 getVelocity() const;
+  float getMass() const;
+  float getRadius() const;
+  void setPosition(const glm::vec3 &position);
+  void setVelocity(const glm::vec3 &velocity);
+
+  void updateBody(float deltaTime, const glm::vec3 &force);
+  glm::vec3 calculateGravitationalForce(const CelestialBody &other) const;
+  float getDistanceTo(const CelestialBody &other) const;
+
+  CelestialBody toBody() const;
+  operator CelestialBody() const { return toBody(); }
+  BasicBodyView &operator=(const CelestialBody &body);
+
+  std::size_t index() const { return bodyIndex; }
+
+private:
+  BasicBodyStore<Policy> *store;
+  std::size_t bodyIndex;
+};
+
+// structure-of-arrays storage for all simulated bodies. every field lives in
+// its own 64-byte aligned array padded to a multiple of laneWidth, so loops
+// only stream the fields they touch and vector kernels can process whole
+// lanes past the last body. padding slots hold massless bodies at the origin.
+// the field types come from the precision policy.
+template <typename Policy> class BasicBodyStore {
+public:
+  using Position = typename Policy::Position;
+  using Pair = typename Policy::Pair;
+  using Accumulator = typename Policy::Accumulator;
+
+  static constexpr std::size_t laneWidth = 16;
+
+  AlignedVector<Position> x, y, z;
+  AlignedVector<Position> vx, vy, vz;
+  AlignedVector<Pair> mass;
+  AlignedVector<Pair> radius;
+  // acceleration written by the gravity kernels
+  AlignedVector<Accumulator> ax, ay, az;
+  // handed out in order as bodies are added and kept as the store shrinks,
+  // so outputs can follow bodies across merges; padding slots hold 0
+  AlignedVector<std::uint32_t> id;
+
+  BasicBodyStore() = default;
+  explicit BasicBodyStore(const std::vector<CelestialBody> &bodies);
+
+  std::size_t size() const { return count; }
+  std::size_t paddedSize() const { return x.size(); }
+  bool empty() const { return count == 0; }
+
+  void reserve(std::size_t capacity);
+  // bodies added by growing start zeroed, each with a fresh id
+  void resize(std::size_t newCount);
+  void clear();
+  // removes the bodies at indices, which are sorted and unique, in a single
+  // pass over every field; the remaining bodies keep their order
+  void remove(const std::vector<std::uint32_t> &indices);
+
+  std::size_t add(const CelestialBody &body);
+  CelestialBody get(std::size_t index) const;
+  void set(std::size_t index, const CelestialBody &body);
+
+  BasicBodyView<Policy> operator[](std::size_t index) {
+    return BasicBodyView<Policy>(*this, index);
+  }
+  CelestialBody operator[](std::size_t index) const { return get(index); }
+
+  // id the next body added gets, saved with a store so a restored one goes
+  // on handing out the same ids
+  std::uint32_t getNextId() const { return nextId; }
+  void setNextId(std::uint32_t next) { nextId = next; }
+
+  std::vector<CelestialBody> toBodies() const;
+  BasicBodyArrays<Policy> arrays() const;
+
+  // semi-implicit euler over all bodies on all threads, same update as
+  // CelestialBody::updateBody; forces are per-body arrays of size()
+  void updateBodies(float deltaTime, const Accumulator *forceX,
+                    const Accumulator *forceY, const Accumulator *forceZ);
+
+private:
+  std::size_t count = 0;
+  std::uint32_t nextId = 0;
+
+  static std::size_t paddedCount(std::size_t n);
+  // calls visit on every field array
+  template <typename Visit> void forEachField(Visit visit);
+};
+
+// the store and view of this build, see precision.h
+using BodyStore = BasicBodyStore<Precision>;
+using BodyView = BasicBodyView<Precision>;
+
+// all policies are instantiated in body_store.cpp, so tools can compare them
+extern template class BasicBodyView<FloatPrecision>;
+extern template class BasicBodyView<DoublePrecision>;
+extern template class BasicBodyView<MixedPrecision>;
+extern template class BasicBodyStore<FloatPrecision>;
+extern template class BasicBodyStore<DoublePrecision>;
+extern template class BasicBodyStore<MixedPrecision>;
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <body_arrays.h>
+#include <body_store.h>
+
+// two bodies by index, first < second
+struct BodyPair {
+  std::uint32_t first, second;
+};
+
+// finds touching bodies without testing every pair. bodies go into cells of
+// a uniform grid as wide as the largest ordinary body, so two bodies can only
+// touch if their cells are neighbours. the cells are sorted along a morton
+// curve with a radix sort and found again through a hash table, and every
+// cell is tested against itself and the 13 neighbours after it, on all
+// threads. the cost grows with the bodies plus the pairs close enough to be
+// tested, which for a disc of planetesimals stays close to linear.
+//
+// the few bodies far larger than the rest, a sun among planetesimals, would
+// blow up the cells. they stay out of the grid and look up the cells their
+// sphere reaches instead.
+class Broadphase {
+public:
+  // bodies more than this many times the radius of the 99th percentile
+  // count as large
+  static constexpr float largeRadius = 4.0f;
+
+  // fills pairs with every pair of bodies closer than the sum of their
+  // radii, in a deterministic order
+  void findOverlaps(const BodyArrays &bodies, std::vector<BodyPair> &pairs);
+  void findOverlaps(const BodyStore &bodies, std::vector<BodyPair> &pairs) {
+    findOverlaps(bodies.arrays(), pairs);
+  }
+
+  // about the last call
+  std::size_t getCellCount() const { return cells.size(); }
+  std::size_t getLargeCount() const { return large.size(); }
+  // pairs that went through the sphere test
+  std::size_t getTestCount() const { return testCount; }
+  double getCellSize() const { return cellSize; }
+
+private:
+  struct Entry {
+    std::uint64_t key;
+    std::uint32_t body;
+  };
+  struct Sphere {
+    double x, y, z, radius;
+  };
+  struct Cell {
+    std::uint32_t x, y, z;
+    // bodies of the cell are entries[begin, end)
+    std::uint32_t begin, end;
+  };
+
+  std::vector<Entry> entries, scratch;
+  // the bodies of entries, in the same order
+  std::vector<Sphere> spheres;
+  std::vector<Cell> cells;
+  // open addressing from morton key to cell, empty slots hold key ~0
+  struct Slot {
+    std::uint64_t key;
+    std::uint64_t cell;
+  };
+  std::vector<Slot> slots;
+  std::vector<std::uint32_t> large;
+  std::vector<std::vector<BodyPair>> found;
+  double origin[3] = {0.0, 0.0, 0.0};
+  double cellSize = 0.0;
+  std::size_t testCount = 0;
+
+  void sortEntries();
+  void buildCells();
+  std::int64_t findCell(std::uint64_t key) const;
+  void findNeighbours(std::size_t first, std::size_t last,
+                      std::int64_t *neighbours) const;
+  void testCell(const Cell &cell, const std::int64_t *neighbours,
+                std::vector<BodyPair> &out, std::size_t &tests) const;
+  void testLarge(const BodyArrays &bodies, std::size_t index,
+                 std::vector<BodyPair> &out, std::size_t &tests) const;
+};
+
+#endif
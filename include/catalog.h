@@ -0,0 +1,26 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <string>
+#include <body_store.h>
+
+// appends the bodies of a catalog file, one body per line, to bodies. fields
+// are separated by commas, or by blanks if the first line has no comma.
+// without a header the fields of every line are
+//
+//   mass, radius, x, y, z, vx, vy, vz
+//
+// a first line that starts with a name instead of a number is a header and
+// names the columns: mass (or m), radius (or r), x, y, z, vx, vy and vz in
+// any order, and any other column, an ephemeris' body names say, is skipped.
+// mass, x, y and z are required, the rest default to zero. blank lines and
+// lines starting with # are ignored.
+//
+// the file is mapped and cut at line boundaries into chunks, which are
+// parsed on all threads with std::from_chars straight into the arrays of
+// bodies. on failure returns false with "path:line: reason" in error and
+// leaves bodies as it was.
+bool loadCatalog(const std::string &path, BodyStore &bodies,
+                 std::string &error);
+
+#endif
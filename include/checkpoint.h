@@ -0,0 +1,70 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <body_store.h>
+#include <integrator.h>
+#include <mapped_file.h>
+
+struct CheckpointHeader;
+struct CheckpointSection;
+
+// binary snapshot of a run: every body array, the state the integrator keeps
+// between steps, the simulated time and the step count. the first page is a
+// header with a table of named sections, and every array section starts on
+// its own page in the layout of BodyStore, padding included. nothing needs
+// parsing, so a checkpoint is mapped and either used in place or copied out
+// with memcpy on all threads. the header records the format version, the
+// byte order and the precision, and files that do not match are refused.
+//
+// the file is written next to path, synced to disk and renamed over it, and
+// the rename is synced too, so a crash or a power loss while saving leaves
+// either the previous checkpoint or the new one intact.
+bool saveCheckpoint(const std::string &path, const BodyStore &bodies,
+                    Integrator &integrator, double time, std::uint64_t steps,
+                    std::string &error);
+
+// a checkpoint file mapped read only into memory
+class Checkpoint {
+public:
+  static constexpr std::uint32_t version = 2;
+  // alignment of every section in the file
+  static constexpr std::size_t pageSize = 4096;
+
+  Checkpoint() = default;
+  ~Checkpoint() { close(); }
+  Checkpoint(const Checkpoint &) = delete;
+  Checkpoint &operator=(const Checkpoint &) = delete;
+
+  bool open(const std::string &path, std::string &error);
+  void close();
+  bool isOpen() const { return header != nullptr; }
+
+  std::size_t getBodyCount() const;
+  double getTime() const;
+  std::uint64_t getSteps() const;
+  // name of the integrator that saved it
+  std::string getIntegratorName() const;
+
+  // the bodies straight from the mapping, valid until close
+  BodyArrays arrays() const;
+
+  // copies the bodies into bodies and hands the integrator its state back.
+  // fails without touching either if integrator is not of the kind that was
+  // saved or its state does not fit.
+  bool restore(BodyStore &bodies, Integrator &integrator,
+               std::string &error) const;
+
+private:
+  const unsigned char *data = nullptr;
+  std::size_t size = 0;
+  const CheckpointHeader *header = nullptr;
+  MappedFile file;
+
+  const CheckpointSection *findSection(const std::string &name) const;
+  const void *sectionData(const std::string &name) const;
+};
+
+#endif
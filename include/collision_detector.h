@@ -3,8 +3,7 @@
 
 #include <glm/glm.hpp>
 #include <raycaster.h>
-#include <celestial_body.h>
-#include <vector>
+#include <body_store.h>
 
 class CollisionDetector {
 public:
@@ -14,10 +13,9 @@ public:
   bool checkCollisionWithTerrain(float mouseX, float mouseY,
                                  const glm::mat4 &projection,
                                  const glm::mat4 &view,
-                                 const std::vector<CelestialBody> &bodies);
+                                 const BodyStore &bodies);
 
-  void resolveCameraCollisions(Camera &camera,
-                               std::vector<CelestialBody> &bodies);
+  void resolveCameraCollisions(Camera &camera, BodyStore &bodies);
 
 private:
   RayCaster *rayCaster;
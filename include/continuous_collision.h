@@ -0,0 +1,55 @@
+#ifndef CONTINUOUS_COLLISION_H
+#define CONTINUOUS_COLLISION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <aligned_allocator.h>
+#include <body_store.h>
+#include <broadphase.h>
+
+// two bodies by index, first < second, that touch during a step
+struct BodyImpact {
+  std::uint32_t first, second;
+  // fraction of the step at first contact, 0 if they touched at its start
+  double time;
+};
+
+// swept-sphere collision detection between steps. overlaps checked at the
+// end of a step miss small fast bodies that pass through each other, or
+// through a planet, within one step. here every body moves in a straight
+// line from its position at the start of the step to the one at the end,
+// and every pair whose spheres touch anywhere along the way is reported
+// with the time of first contact.
+//
+// the broadphase gets one sphere per body that holds its whole path,
+// centred halfway and grown by half the distance moved, so slow bodies cost
+// the same as in the discrete test. the candidate pairs are then solved
+// exactly for the earliest time their distance equals the sum of radii.
+class ContinuousCollision {
+public:
+  // remembers the positions at the start of the step
+  void begin(const BodyStore &bodies);
+  // fills impacts with every pair that touched between the positions given
+  // to begin and the current ones, earliest first. finds nothing if the
+  // body count changed since begin.
+  void findImpacts(const BodyStore &bodies, std::vector<BodyImpact> &impacts);
+
+  // candidates of the last call that went through the exact test
+  std::size_t getCandidateCount() const { return candidates.size(); }
+  const Broadphase &getBroadphase() const { return broadphase; }
+
+private:
+  using Position = BodyStore::Position;
+  using Pair = BodyStore::Pair;
+
+  Broadphase broadphase;
+  AlignedVector<Position> startX, startY, startZ;
+  // spheres around the paths of the step
+  AlignedVector<Position> sweptX, sweptY, sweptZ;
+  AlignedVector<Pair> sweptRadius;
+  std::vector<BodyPair> candidates;
+  std::vector<double> times;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define SOLAR_SIM_X86 1
+#endif
+
+// widest instruction set the vector kernels may use on this machine
+enum class SimdLevel { Scalar, Sse2, Avx2, Avx512 };
+
+struct CpuFeatures {
+  bool sse2 = false;
+  bool avx2 = false;
+  bool fma = false;
+  bool avx512f = false;
+};
+
+// queried once through cpuid/xgetbv, so features the OS does not save on a
+// context switch are reported as missing
+const CpuFeatures &getCpuFeatures();
+SimdLevel detectSimdLevel();
+const char *getSimdLevelName(SimdLevel level);
+
+#endif
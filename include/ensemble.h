@@ -0,0 +1,118 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include <aligned_allocator.h>
+#include <body_arrays.h>
+#include <body_store.h>
+
+enum class SystemState : std::uint8_t { Running, Ejected, Diverged };
+
+const char *getSystemStateName(SystemState state);
+
+// many small independent systems stepped together, for parameter sweeps over
+// systems too small to spread over threads on their own. systems sit side by
+// side, one per lane of a block of laneWidth systems, and the ensemble kernel
+// steps the same body pair of every system in a block with one instruction.
+// blocks are spread over the threads, and each runs checkInterval
+// kick-drift-kick leapfrog steps in one go while its data stays in cache.
+//
+// after every checkInterval steps the running systems are checked. a system
+// diverged when a position or velocity is no longer finite or its energy
+// drifted by more than energyTolerance of its start value, and it was
+// ejected when a massive body got farther than ejectionDistance from the
+// centre of mass. such systems retire with their state at the check, and the
+// last running system moves into their lane, so work only goes to blocks with
+// running systems. massless bodies are ignored by the checks.
+class Ensemble {
+public:
+  using Position = BodyStore::Position;
+  using Pair = BodyStore::Pair;
+  using Accumulator = BodyStore::Accumulator;
+
+  static constexpr std::size_t laneWidth = EnsembleArrays::lanes;
+
+  explicit Ensemble(std::size_t bodiesPerSystem);
+
+  // adds a copy of system, padded with massless bodies at the origin. fails
+  // with the reason in error if it has more than bodiesPerSystem bodies.
+  bool addSystem(const BodyStore &system, std::string &error);
+  // steps every running system steps times by deltaTime
+  void run(std::size_t steps, float deltaTime);
+
+  std::size_t getBodiesPerSystem() const { return bodiesPerSystem; }
+  std::size_t getSystemCount() const { return systems.size(); }
+  std::size_t getRunningCount() const { return runningCount; }
+  SystemState getState(std::size_t system) const {
+    return systems[system].state;
+  }
+  // steps the system took before it retired, or so far
+  std::uint64_t getStepCount(std::size_t system) const;
+  // relative energy error of the system, at retirement or now
+  double getEnergyError(std::size_t system) const;
+  // current or final bodies of the system
+  void getSystem(std::size_t system, BodyStore &out) const;
+
+  void setCheckInterval(std::size_t steps) {
+    checkInterval = steps > 0 ? steps : 1;
+  }
+  void setEnergyTolerance(double tolerance) { energyTolerance = tolerance; }
+  void setEjectionDistance(double distance) { ejectionDistance = distance; }
+
+private:
+  struct System {
+    std::size_t bodyCount;
+    SystemState state = SystemState::Running;
+    // lane while running, offset into retired afterwards
+    std::size_t slot;
+    // step count of the ensemble when the system was added and retired
+    std::uint64_t addedAt;
+    std::uint64_t retiredAt = 0;
+    double startEnergy;
+    double energy;
+  };
+
+  std::size_t bodiesPerSystem;
+  std::size_t checkInterval = 16;
+  double energyTolerance = 1e-2;
+  double ejectionDistance = std::numeric_limits<double>::infinity();
+
+  // lanes of all blocks, body b of slot s at element index(s, b)
+  AlignedVector<Position> x, y, z;
+  AlignedVector<Position> vx, vy, vz;
+  AlignedVector<Pair> mass, radius;
+  AlignedVector<Accumulator> ax, ay, az;
+
+  std::vector<System> systems;
+  // system in each running slot; slots [0, runningCount) are in use
+  std::vector<std::uint32_t> slotSystem;
+  std::size_t runningCount = 0;
+  std::uint64_t stepCount = 0;
+  // whether ax/ay/az hold the accelerations of the current positions
+  bool accelerationsValid = false;
+  // final bodies of retired systems, one after the other
+  BodyStore retired;
+
+  std::size_t index(std::size_t slot, std::size_t body) const {
+    return ((slot / laneWidth) * bodiesPerSystem + body) * laneWidth +
+           slot % laneWidth;
+  }
+  std::size_t blockCount() const {
+    return (runningCount + laneWidth - 1) / laneWidth;
+  }
+  EnsembleArrays arrays() const;
+  // copies position, velocity, mass and radius of body i of from to body j
+  // of to; both are an Ensemble or a BodyStore
+  template <typename From, typename To>
+  static void copyBody(const From &from, std::size_t i, To &to, std::size_t j);
+  double slotEnergy(std::size_t slot) const;
+  SystemState checkSlot(std::size_t slot);
+  void stepBlock(std::size_t block, std::size_t steps, Position deltaTime);
+  void retire(std::size_t slot, SystemState state);
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef FAST_MULTIPOLE_H
+#define FAST_MULTIPOLE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <gravity_solver.h>
+#include <octree.h>
+
+struct ExpansionTables;
+
+// O(n) gravity with cartesian multipole and local (taylor) expansions of
+// 1/r up to expansionOrder on the adaptive octree. a dual tree walk pairs
+// cells: well separated ones, (rA + rB) < openingAngle * distance, are joined
+// by an M2L translation (rX is the distance from a cell centre to its farthest
+// body), touching leaves by direct pair sums with the usual
+// clamp. M2L and the leaf work run on all threads. expansions are kept in
+// double; raising the order or lowering the angle trades speed for accuracy.
+class FastMultipoleGravity : public GravitySolver {
+public:
+  static constexpr int maxExpansionOrder = 10;
+
+  explicit FastMultipoleGravity(int expansionOrder = 4,
+                                float openingAngle = 0.5f,
+                                std::uint32_t leafCapacity = 128);
+  ~FastMultipoleGravity() override;
+
+  void computeAccelerations(BodyStore &bodies) override;
+  const char *getName() const override { return "fmm"; }
+
+  void setExpansionOrder(int order);
+  int getExpansionOrder() const { return expansionOrder; }
+  void setOpeningAngle(float angle);
+  float getOpeningAngle() const { return openingAngle; }
+  void setLeafCapacity(std::uint32_t capacity);
+
+  const Octree &getTree() const { return tree; }
+
+private:
+  Octree tree;
+  std::unique_ptr<ExpansionTables> tables;
+  int expansionOrder;
+  float openingAngle;
+  std::uint32_t leafCapacity;
+
+  // termCount coefficients per node
+  std::vector<double> multipoles;
+  std::vector<double> locals;
+  // distance from a cell centre to its farthest body
+  std::vector<float> radii;
+  // per target node: source cells for M2L, and for leaves the source leaves
+  // summed directly
+  std::vector<std::vector<std::uint32_t>> farLists;
+  std::vector<std::vector<std::uint32_t>> nearLists;
+
+  void upwardPass(const BodyStore &bodies);
+  void buildInteractionLists();
+  void interact(std::uint32_t target, std::uint32_t source);
+  void translateFarField();
+  void downwardPass();
+  void evaluateLeaves(BodyStore &bodies);
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define GLOBALS
 
 const float gravitationalConstant = 10.1f;
+// scale applied to m1 * m2 / r^2 by the pair force
+const float gravityScale = 0.1f;
 const unsigned int SCR_WIDTH = 1378;
 const unsigned int SCR_HEIGHT = 786;
 
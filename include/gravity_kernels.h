@@ -0,0 +1,205 @@
+#ifndef GRAVITY_KERNELS_H
+#define GRAVITY_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <body_arrays.h>
+#include <cpu_features.h>
+
+template <typename Policy> class BasicBodyStore;
+using BodyStore = BasicBodyStore<Precision>;
+
+// writes the acceleration of targets [begin, end) due to every body into
+// ax/ay/az. this is CelestialBody::calculateGravitationalForce summed over all
+// partners and divided by the target mass, including the clamp of the
+// distance to radius + other.radius + 1.
+//
+// begin has to be a multiple of BodyStore::laneWidth and end is rounded up to
+// one, so the vector kernels may write into the padding after size().
+//
+// the vector kernels replace sqrt and divide with rsqrt plus one newton step.
+// per component they agree with the scalar kernel to within 1e-5 * |a| of the
+// target, the remaining difference being float summation order.
+template <typename Policy>
+using BasicAccelerationKernel =
+    void (*)(const BasicBodyArrays<Policy> &bodies, std::size_t begin,
+             std::size_t end, typename Policy::Accumulator *ax,
+             typename Policy::Accumulator *ay,
+             typename Policy::Accumulator *az);
+
+// adds the accelerations that bodies [iBegin, iEnd) and [jBegin, jEnd) exert
+// on each other into ax/ay/az. every pair is evaluated once and applied to
+// both bodies with opposite signs, which halves the work of the all-pairs
+// sum. when both ranges start at the same body only pairs with j > i count.
+//
+// jBegin and jEnd have to be multiples of BodyStore::laneWidth; iEnd is
+// clamped to bodies.count. writes may land in the padding after count.
+template <typename Policy>
+using BasicSymmetricKernel =
+    void (*)(const BasicBodyArrays<Policy> &bodies, std::size_t iBegin,
+             std::size_t iEnd, std::size_t jBegin, std::size_t jEnd,
+             typename Policy::Accumulator *ax,
+             typename Policy::Accumulator *ay,
+             typename Policy::Accumulator *az);
+
+// writes the acceleration of the listed targets due to every body into
+// ax/ay/az at the target indices, for stepping only part of the bodies. the
+// vector kernels run over the partners, one target at a time.
+template <typename Policy>
+using BasicTargetKernel =
+    void (*)(const BasicBodyArrays<Policy> &bodies,
+             const std::uint32_t *targets, std::size_t count,
+             typename Policy::Accumulator *ax,
+             typename Policy::Accumulator *ay,
+             typename Policy::Accumulator *az);
+
+// acceleration and jerk of the listed targets in one pass over the partners,
+// for the hermite integrator. vx/vy/vz are the velocities of all bodies, zero
+// in the padding like every other field. results go to the target indices of
+// ax/ay/az and jx/jy/jz.
+template <typename Policy>
+using BasicJerkKernel = void (*)(
+    const BasicBodyArrays<Policy> &bodies, const typename Policy::Position *vx,
+    const typename Policy::Position *vy, const typename Policy::Position *vz,
+    const std::uint32_t *targets, std::size_t count,
+    typename Policy::Accumulator *ax, typename Policy::Accumulator *ay,
+    typename Policy::Accumulator *az, typename Policy::Accumulator *jx,
+    typename Policy::Accumulator *jy, typename Policy::Accumulator *jz);
+
+// accelerations every body of the systems in blocks [begin, end) of an
+// ensemble feels from the other bodies of its own system, written to ax/ay/az
+// in the layout of the positions. the same body pair is evaluated in all
+// lanes at once, so the systems of a block advance in lockstep, and every pair
+// is applied to both of its bodies.
+template <typename Policy>
+using BasicEnsembleKernel =
+    void (*)(const BasicEnsembleArrays<Policy> &systems, std::size_t begin,
+             std::size_t end, typename Policy::Accumulator *ax,
+             typename Policy::Accumulator *ay,
+             typename Policy::Accumulator *az);
+
+// kernels of the precision this build was configured with. the hand written
+// vector kernels are float only; the other precisions always get the portable
+// scalar kernels, picked at compile time.
+using AccelerationKernel = BasicAccelerationKernel<Precision>;
+using SymmetricKernel = BasicSymmetricKernel<Precision>;
+using TargetKernel = BasicTargetKernel<Precision>;
+using JerkKernel = BasicJerkKernel<Precision>;
+using EnsembleKernel = BasicEnsembleKernel<Precision>;
+
+// kernel for an explicit instruction set; builds for other architectures only
+// have the scalar one
+AccelerationKernel getAccelerationKernel(SimdLevel level);
+SymmetricKernel getSymmetricKernel(SimdLevel level);
+TargetKernel getTargetKernel(SimdLevel level);
+JerkKernel getJerkKernel(SimdLevel level);
+EnsembleKernel getEnsembleKernel(SimdLevel level);
+
+// kernel for the widest instruction set of this CPU, picked on first use
+AccelerationKernel getAccelerationKernel();
+SymmetricKernel getSymmetricKernel();
+TargetKernel getTargetKernel();
+JerkKernel getJerkKernel();
+EnsembleKernel getEnsembleKernel();
+
+// all-pairs accelerations of every body into bodies.ax/ay/az
+void computeAccelerations(BodyStore &bodies);
+
+// portable kernels for any precision policy, instantiated for the three in
+// precision.h. the pair math runs in Policy::Pair and the sums in
+// Policy::Accumulator.
+template <typename Policy>
+void accelerationsScalar(const BasicBodyArrays<Policy> &bodies,
+                         std::size_t begin, std::size_t end,
+                         typename Policy::Accumulator *ax,
+                         typename Policy::Accumulator *ay,
+                         typename Policy::Accumulator *az);
+template <typename Policy>
+void symmetricAccelerationsScalar(const BasicBodyArrays<Policy> &bodies,
+                                  std::size_t iBegin, std::size_t iEnd,
+                                  std::size_t jBegin, std::size_t jEnd,
+                                  typename Policy::Accumulator *ax,
+                                  typename Policy::Accumulator *ay,
+                                  typename Policy::Accumulator *az);
+template <typename Policy>
+void targetAccelerationsScalar(const BasicBodyArrays<Policy> &bodies,
+                               const std::uint32_t *targets, std::size_t count,
+                               typename Policy::Accumulator *ax,
+                               typename Policy::Accumulator *ay,
+                               typename Policy::Accumulator *az);
+template <typename Policy>
+void jerksScalar(const BasicBodyArrays<Policy> &bodies,
+                 const typename Policy::Position *vx,
+                 const typename Policy::Position *vy,
+                 const typename Policy::Position *vz,
+                 const std::uint32_t *targets, std::size_t count,
+                 typename Policy::Accumulator *ax,
+                 typename Policy::Accumulator *ay,
+                 typename Policy::Accumulator *az,
+                 typename Policy::Accumulator *jx,
+                 typename Policy::Accumulator *jy,
+                 typename Policy::Accumulator *jz);
+template <typename Policy>
+void ensembleAccelerationsScalar(const BasicEnsembleArrays<Policy> &systems,
+                                 std::size_t begin, std::size_t end,
+                                 typename Policy::Accumulator *ax,
+                                 typename Policy::Accumulator *ay,
+                                 typename Policy::Accumulator *az);
+
+// per instruction set entry points, float only; only call after checking the
+// CPU
+#if defined(SOLAR_SIM_X86)
+void accelerationsSse2(const FloatBodyArrays &bodies, std::size_t begin,
+                       std::size_t end, float *ax, float *ay, float *az);
+void accelerationsAvx2(const FloatBodyArrays &bodies, std::size_t begin,
+                       std::size_t end, float *ax, float *ay, float *az);
+void accelerationsAvx512(const FloatBodyArrays &bodies, std::size_t begin,
+                         std::size_t end, float *ax, float *ay, float *az);
+void symmetricAccelerationsSse2(const FloatBodyArrays &bodies,
+                                std::size_t iBegin, std::size_t iEnd,
+                                std::size_t jBegin, std::size_t jEnd,
+                                float *ax, float *ay, float *az);
+void symmetricAccelerationsAvx2(const FloatBodyArrays &bodies,
+                                std::size_t iBegin, std::size_t iEnd,
+                                std::size_t jBegin, std::size_t jEnd,
+                                float *ax, float *ay, float *az);
+void symmetricAccelerationsAvx512(const FloatBodyArrays &bodies,
+                                  std::size_t iBegin, std::size_t iEnd,
+                                  std::size_t jBegin, std::size_t jEnd,
+                                  float *ax, float *ay, float *az);
+void targetAccelerationsSse2(const FloatBodyArrays &bodies,
+                             const std::uint32_t *targets, std::size_t count,
+                             float *ax, float *ay, float *az);
+void targetAccelerationsAvx2(const FloatBodyArrays &bodies,
+                             const std::uint32_t *targets, std::size_t count,
+                             float *ax, float *ay, float *az);
+void targetAccelerationsAvx512(const FloatBodyArrays &bodies,
+                               const std::uint32_t *targets, std::size_t count,
+                               float *ax, float *ay, float *az);
+void jerksSse2(const FloatBodyArrays &bodies, const float *vx,
+               const float *vy, const float *vz,
+               const std::uint32_t *targets, std::size_t count,
+               float *ax, float *ay, float *az, float *jx, float *jy,
+               float *jz);
+void jerksAvx2(const FloatBodyArrays &bodies, const float *vx,
+               const float *vy, const float *vz,
+               const std::uint32_t *targets, std::size_t count,
+               float *ax, float *ay, float *az, float *jx, float *jy,
+               float *jz);
+void jerksAvx512(const FloatBodyArrays &bodies, const float *vx,
+                 const float *vy, const float *vz,
+                 const std::uint32_t *targets, std::size_t count,
+                 float *ax, float *ay, float *az, float *jx, float *jy,
+                 float *jz);
+void ensembleAccelerationsSse2(const FloatEnsembleArrays &systems,
+                               std::size_t begin, std::size_t end, float *ax,
+                               float *ay, float *az);
+void ensembleAccelerationsAvx2(const FloatEnsembleArrays &systems,
+                               std::size_t begin, std::size_t end, float *ax,
+                               float *ay, float *az);
+void ensembleAccelerationsAvx512(const FloatEnsembleArrays &systems,
+                                 std::size_t begin, std::size_t end,
+                                 float *ax, float *ay, float *az);
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef GRAVITY_SOLVER_H
+#define GRAVITY_SOLVER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <body_store.h>
+
+enum class GravityMethod { Direct, BarnesHut, FastMultipole };
+
+struct GravitySettings {
+  GravityMethod method = GravityMethod::Direct;
+  // tree methods open a cell while its size over the distance exceeds this
+  float openingAngle = 0.5f;
+  // barnes-hut adds the cell quadrupole to the monopole
+  bool quadrupole = false;
+  // highest multipole degree the fast multipole method keeps
+  int expansionOrder = 4;
+  // direct summation evaluates each pair once and applies it to both bodies
+  bool symmetric = true;
+};
+
+// computes the gravitational acceleration of every body into
+// bodies.ax/ay/az
+class GravitySolver {
+public:
+  virtual ~GravitySolver() = default;
+  virtual void computeAccelerations(BodyStore &bodies) = 0;
+  // accelerations of the listed bodies, for integrators that only step part
+  // of them. entries of other bodies may be overwritten as well; solvers
+  // without a cheaper path compute everything.
+  virtual void
+  computeActiveAccelerations(BodyStore &bodies,
+                             const std::vector<std::uint32_t> &) {
+    computeAccelerations(bodies);
+  }
+  virtual const char *getName() const = 0;
+};
+
+// exact O(n^2) summation with the vector kernel for this CPU. the symmetric
+// mode walks the upper triangle of tileSize x tileSize body tiles, every
+// thread adding into its own accumulator that is summed at the end; the plain
+// mode gives each thread its own targets and sums every pair twice.
+class DirectGravity : public GravitySolver {
+public:
+  static constexpr std::size_t tileSize = 512;
+
+  explicit DirectGravity(bool symmetric = true) : symmetric(symmetric) {}
+
+  void computeAccelerations(BodyStore &bodies) override;
+  void
+  computeActiveAccelerations(BodyStore &bodies,
+                             const std::vector<std::uint32_t> &active) override;
+  const char *getName() const override { return "direct"; }
+
+  void setSymmetric(bool enabled) { symmetric = enabled; }
+  bool isSymmetric() const { return symmetric; }
+
+private:
+  bool symmetric;
+  // accumulators of every thread but the first, which writes into the store
+  std::vector<AlignedVector<BodyStore::Accumulator>> accumulators;
+
+  void computeSymmetric(BodyStore &bodies);
+};
+
+std::unique_ptr<GravitySolver>
+createGravitySolver(const GravitySettings &settings);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef HERMITE_INTEGRATOR_H
+#define HERMITE_INTEGRATOR_H
+
+#include <block_integrator.h>
+
+// fourth order hermite predictor-corrector on block timesteps. the fused
+// kernel gives the acceleration a and its time derivative, the jerk j, of
+// every active body at the predicted state, and the step of length h ends
+// with
+//
+//   v1 = v0 + (a0 + a1) h / 2 + (j0 - j1) h^2 / 12
+//   x1 = x0 + (v0 + v1) h / 2 + (a0 - a1) h^2 / 12
+//
+// the snap and crackle of the interpolating polynomial pick the next step by
+// the aarseth criterion
+//
+//   h = sqrt(accuracy * (|a| |snap| + |j|^2) / (|j| |crackle| + |snap|^2))
+//
+// the errors fall off as h^4 against h for euler, which allows steps that
+// are orders of magnitude longer at the same accuracy. a level count of 1
+// gives a shared step for all bodies.
+//
+// the jerk only comes out of direct summation, so the gravity solver passed
+// to step is not used.
+class HermiteIntegrator : public BlockTimestepIntegrator {
+public:
+  explicit HermiteIntegrator(int levelCount = 8, float accuracy = 0.02f)
+      : BlockTimestepIntegrator(levelCount, accuracy) {}
+
+  const char *getName() const override { return "hermite"; }
+  void visitState(IntegratorStateVisitor &visitor) override;
+
+protected:
+  void evaluate(BodyStore &bodies, GravitySolver &gravity, bool all) override;
+  void initializeBody(const BodyStore &bodies, std::size_t i) override;
+  void correctBody(const BodyStore &bodies, std::size_t i,
+                   BodyStore::Position h) override;
+  float wantedStep(std::size_t i, float radius) const override;
+
+private:
+  // jerk at the predicted state, written by evaluate
+  AlignedVector<BodyStore::Accumulator> newJerkX, newJerkY, newJerkZ;
+  // magnitudes of the second and third derivative of the acceleration at
+  // the end of the last step, 0 before the first one
+  AlignedVector<float> snap, crackle;
+  // every body, the targets of the first evaluate
+  std::vector<std::uint32_t> everyone;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <body_store.h>
+#include <gravity_solver.h>
+
+enum class IntegratorMethod {
+  Euler,
+  Leapfrog,
+  VelocityVerlet,
+  BlockTimestep,
+  Hermite
+};
+
+struct IntegratorSettings {
+  IntegratorMethod method = IntegratorMethod::Euler;
+  // the block and hermite integrators step down to deltaTime /
+  // 2^(levelCount - 1)
+  int levelCount = 8;
+  // step size criterion of the block and hermite integrators
+  float accuracy = 0.02f;
+};
+
+// walks over the state an integrator carries from one step to the next, so
+// checkpoints can save and restore it without knowing the integrator
+class IntegratorStateVisitor {
+public:
+  virtual ~IntegratorStateVisitor() = default;
+
+  // a value of size bytes
+  virtual void value(const char *name, void *data, std::size_t size) = 0;
+  // count elements of elementSize bytes; resize changes the element count
+  // and returns the new data
+  virtual void array(const char *name, void *data, std::size_t elementSize,
+                     std::size_t count,
+                     const std::function<void *(std::size_t)> &resize) = 0;
+
+  template <typename T> void visit(const char *name, T &data) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "state has to be plain data");
+    value(name, &data, sizeof(T));
+  }
+  template <typename T, typename Allocator>
+  void visit(const char *name, std::vector<T, Allocator> &data) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "state has to be plain data");
+    array(name, data.data(), sizeof(T), data.size(), [&](std::size_t count) {
+      data.resize(count);
+      return static_cast<void *>(data.data());
+    });
+  }
+};
+
+// advances every body of a store by one step, asking a gravity solver for
+// the accelerations
+class Integrator {
+public:
+  virtual ~Integrator() = default;
+  virtual void step(BodyStore &bodies, GravitySolver &gravity,
+                    float deltaTime) = 0;
+  // drops anything cached from earlier steps; call after bodies were added,
+  // removed or moved outside of step
+  virtual void reset() {}
+  virtual const char *getName() const = 0;
+  // hands everything kept between steps to visitor; restoring it continues
+  // the run exactly where it was saved
+  virtual void visitState(IntegratorStateVisitor &) {}
+};
+
+// semi-implicit euler, the update of CelestialBody::updateBody. first order,
+// one force evaluation per step
+class EulerIntegrator : public Integrator {
+public:
+  void step(BodyStore &bodies, GravitySolver &gravity,
+            float deltaTime) override;
+  const char *getName() const override { return "euler"; }
+};
+
+// kick-drift-kick leapfrog. second order and symplectic, so energy errors
+// stay bounded instead of drifting. the accelerations of the closing half
+// kick are kept in bodies.ax/ay/az and open the next step, which leaves one
+// force evaluation per step.
+class LeapfrogIntegrator : public Integrator {
+public:
+  void step(BodyStore &bodies, GravitySolver &gravity,
+            float deltaTime) override;
+  void reset() override { cachedCount = 0; }
+  const char *getName() const override { return "leapfrog"; }
+  void visitState(IntegratorStateVisitor &visitor) override {
+    visitor.visit("cachedCount", cachedCount);
+  }
+
+private:
+  // body count the accelerations in the store belong to, 0 if stale
+  std::size_t cachedCount = 0;
+};
+
+// velocity verlet: x += v dt + a dt^2 / 2, then v += (a + a') dt / 2 with
+// the new accelerations a'. the same trajectory as leapfrog in exact
+// arithmetic, with positions and velocities in sync after every step. like
+// leapfrog it reuses the accelerations of the previous step.
+class VelocityVerletIntegrator : public Integrator {
+public:
+  void step(BodyStore &bodies, GravitySolver &gravity,
+            float deltaTime) override;
+  void reset() override { cachedCount = 0; }
+  const char *getName() const override { return "verlet"; }
+  void visitState(IntegratorStateVisitor &visitor) override {
+    visitor.visit("cachedCount", cachedCount);
+  }
+
+private:
+  std::size_t cachedCount = 0;
+  // accelerations at the start of the step while the new ones are computed
+  AlignedVector<BodyStore::Accumulator> previousX, previousY, previousZ;
+};
+
+std::unique_ptr<Integrator> createIntegrator(IntegratorMethod method);
+std::unique_ptr<Integrator>
+createIntegrator(const IntegratorSettings &settings);
+
+#endif
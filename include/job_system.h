@@ -0,0 +1,94 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobState;
+
+// handle to a submitted job, usable as a dependency of later jobs or waited
+// on. a default constructed handle counts as finished.
+class JobHandle {
+public:
+  JobHandle() = default;
+  bool isDone() const;
+
+private:
+  friend class JobSystem;
+  explicit JobHandle(std::shared_ptr<JobState> state)
+      : state(std::move(state)) {}
+  std::shared_ptr<JobState> state;
+};
+
+// work stealing thread pool. every worker owns a deque: it pushes and pops
+// its own jobs at the back and, when that runs dry, steals from the front of
+// the others. jobs submitted from outside the pool go to a shared queue.
+// threads that wait on a job keep running other jobs meanwhile, so jobs may
+// submit and wait on further jobs without deadlocking the pool.
+class JobSystem {
+public:
+  using Job = std::function<void()>;
+
+  // workerCount background threads; the thread that waits is one more
+  explicit JobSystem(unsigned int workerCount);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // pool shared by the whole program, with one worker less than the number
+  // of hardware threads
+  static JobSystem &instance();
+
+  // runs job once every dependency has finished
+  JobHandle submit(Job job, std::initializer_list<JobHandle> dependencies = {});
+  JobHandle submit(Job job, const std::vector<JobHandle> &dependencies);
+
+  // returns once the job has finished, running other jobs until then
+  void wait(const JobHandle &handle);
+  void wait(const std::vector<JobHandle> &handles);
+
+  // calls body(chunkBegin, chunkEnd) for chunks of grain indices covering
+  // [begin, end), spread over the pool and the calling thread
+  void parallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                   const std::function<void(std::size_t, std::size_t)> &body);
+
+  // background workers plus the calling thread
+  unsigned int getThreadCount() const {
+    return static_cast<unsigned int>(queues.size()) + 1;
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<JobState>> jobs;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+  Queue injected;
+  std::atomic<bool> stopping{false};
+  // jobs sitting in any queue or about to be pushed to one, so sleeping
+  // workers know when to wake
+  std::atomic<std::size_t> queued{0};
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+
+  void workerLoop(std::size_t index);
+  void schedule(std::shared_ptr<JobState> job);
+  std::shared_ptr<JobState> take();
+  bool runOne();
+  void run(const std::shared_ptr<JobState> &job);
+  JobHandle submit(Job job, const JobHandle *dependencies,
+                   std::size_t dependencyCount);
+};
+
+#endif
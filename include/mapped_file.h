@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// how a mapping is going to be read, passed on to the kernel as a hint
+enum class MappedFileAccess {
+  // front to back, read ahead and drop pages behind
+  Sequential,
+  // all of it soon, start reading everything in
+  WillNeed
+};
+
+// a whole file mapped read only into memory
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // fails for missing files. an empty file has nothing to map and opens
+  // with size 0 and no data.
+  bool open(const std::string &path, MappedFileAccess access,
+            std::string &error);
+  void close();
+  bool isOpen() const { return opened; }
+
+  const unsigned char *data() const { return bytes; }
+  std::size_t size() const { return length; }
+
+private:
+  const unsigned char *bytes = nullptr;
+  std::size_t length = 0;
+  bool opened = false;
+#if defined(_WIN32)
+  void *file = nullptr;
+  void *mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+#include <cstdint>
+
+// spreads the low 21 bits of v so two zero bits sit between each of them
+inline std::uint64_t spreadBits(std::uint64_t v) {
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffffull;
+  v = (v | v << 16) & 0x1f0000ff0000ffull;
+  v = (v | v << 8) & 0x100f00f00f00f00full;
+  v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+  v = (v | v << 2) & 0x1249249249249249ull;
+  return v;
+}
+
+// position along the morton curve of a cell with 21 bit coordinates
+inline std::uint64_t mortonKey(std::uint64_t x, std::uint64_t y,
+                               std::uint64_t z) {
+  return spreadBits(x) << 2 | spreadBits(y) << 1 | spreadBits(z);
+}
+
+#endif
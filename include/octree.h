@@ -0,0 +1,62 @@
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <body_store.h>
+
+struct OctreeNode {
+  glm::vec3 center;
+  float halfSize;
+  // bodies of this cell are order[begin, end)
+  std::uint32_t begin, end;
+  // children are stored next to each other, only non-empty octants exist
+  std::int32_t firstChild;
+  std::uint32_t childCount;
+  std::uint32_t depth;
+
+  bool isLeaf() const { return firstChild < 0; }
+  std::uint32_t bodyCount() const { return end - begin; }
+};
+
+// adaptive octree over the bodies of a BodyStore. bodies are sorted along a
+// morton curve so every cell owns a contiguous run of them; cells split until
+// they hold at most leafCapacity bodies. the top levels are split serially
+// and the subtrees below them are built in parallel.
+class Octree {
+public:
+  static constexpr std::uint32_t maxDepth = 21;
+
+  // nodes[0] is the root and every parent comes before its children
+  std::vector<OctreeNode> nodes;
+  // body indices in morton order
+  std::vector<std::uint32_t> order;
+
+  void build(const BodyStore &bodies, std::uint32_t leafCapacity);
+
+  // visits every node after all of its children, running independent
+  // subtrees in parallel
+  void visitBottomUp(const std::function<void(std::uint32_t)> &visit) const;
+  // visits every node before any of its children
+  void visitTopDown(const std::function<void(std::uint32_t)> &visit) const;
+
+private:
+  struct Subtree {
+    std::uint32_t root;
+    std::uint32_t begin, end;
+  };
+
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> keys;
+  std::vector<Subtree> subtrees;
+  std::uint32_t topNodeCount = 0;
+
+  void sortKeys();
+  void splitNode(std::vector<OctreeNode> &out, std::uint32_t index) const;
+  void buildSubtree(std::vector<OctreeNode> &out,
+                    std::uint32_t leafCapacity) const;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef PAIR_FORCE_H
+#define PAIR_FORCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <globals.h>
+
+// gravityScale / (clamped distance^2 * distance) for a pair, the factor that
+// turns the offset between two bodies times a partner mass into an
+// acceleration. the distance is clamped to the sum of both radii plus one, and
+// coincident bodies give zero. T is the type of the pair math.
+template <typename T>
+inline T pairScale(T distanceSquared, T radius, T otherRadius) {
+  if (distanceSquared == T(0))
+    return T(0);
+  T minDistance = radius + otherRadius + T(1);
+  T clamped = std::max(distanceSquared, minDistance * minDistance);
+  return T(gravityScale) / (clamped * std::sqrt(distanceSquared));
+}
+
+// adds the acceleration a body feels from a partner of mass otherMass at
+// offset (dx, dy, dz). matches CelestialBody::calculateGravitationalForce
+// divided by the target mass. the pair math runs in T and the sum in A.
+template <typename T, typename A>
+inline void accumulatePairAcceleration(T dx, T dy, T dz, T radius,
+                                       T otherRadius, T otherMass, A &ax,
+                                       A &ay, A &az) {
+  T scale =
+      otherMass * pairScale(dx * dx + dy * dy + dz * dz, radius, otherRadius);
+  ax += A(dx * scale);
+  ay += A(dy * scale);
+  az += A(dz * scale);
+}
+
+// adds the acceleration and its time derivative, the jerk, that a partner at
+// offset (dx, dy, dz) moving with relative velocity (dvx, dvy, dvz) causes.
+// with a = s(d) dr the jerk is s (dv - k (dr . dv) / d^2 dr), where k = 3
+// while s falls off as 1 / d^3 and k = 1 inside the clamp distance, where it
+// only falls off as 1 / d.
+template <typename T, typename A>
+inline void accumulatePairJerk(T dx, T dy, T dz, T dvx, T dvy, T dvz,
+                               T radius, T otherRadius, T otherMass, A &ax,
+                               A &ay, A &az, A &jx, A &jy, A &jz) {
+  T distanceSquared = dx * dx + dy * dy + dz * dz;
+  if (distanceSquared == T(0))
+    return;
+  T minDistance = radius + otherRadius + T(1);
+  T clamped = std::max(distanceSquared, minDistance * minDistance);
+  T scale = otherMass * T(gravityScale) /
+            (clamped * std::sqrt(distanceSquared));
+  T falloff = distanceSquared >= minDistance * minDistance ? T(3) : T(1);
+  T radial = falloff * (dx * dvx + dy * dvy + dz * dvz) / distanceSquared;
+  ax += A(dx * scale);
+  ay += A(dy * scale);
+  az += A(dz * scale);
+  jx += A((dvx - radial * dx) * scale);
+  jy += A((dvy - radial * dy) * scale);
+  jz += A((dvz - radial * dz) * scale);
+}
+
+// potential energy per unit mass product that belongs to the clamped force:
+// -g / d outside the clamp distance, and inside it the linear potential of
+// the constant force there. zero for coincident bodies, like pairScale.
+template <typename T>
+inline T pairPotential(T distanceSquared, T radius, T otherRadius) {
+  if (distanceSquared == T(0))
+    return T(0);
+  T distance = std::sqrt(distanceSquared);
+  T minDistance = radius + otherRadius + T(1);
+  if (distance >= minDistance)
+    return -T(gravityScale) / distance;
+  return -T(gravityScale) * (T(2) - distance / minDistance) / minDistance;
+}
+
+#endif
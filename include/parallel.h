@@ -0,0 +1,17 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// number of threads parallelFor spreads work over
+unsigned int getThreadCount();
+
+// calls body(chunkBegin, chunkEnd) for consecutive chunks covering
+// [begin, end) on the shared JobSystem. chunk boundaries fall on
+// begin + k * grain, so callers can keep chunks aligned to vector lanes.
+// returns once every chunk is done; may be called from inside a chunk.
+void parallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                 const std::function<void(std::size_t, std::size_t)> &body);
+
+#endif
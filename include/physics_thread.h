@@ -0,0 +1,93 @@
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <glm/glm.hpp>
+#include <aligned_allocator.h>
+#include <body_store.h>
+#include <triple_buffer.h>
+
+// state of the simulation as the renderer sees it. positions and radii are
+// kept in float whatever the precision of the store, padded like a BodyStore
+// so passes over them can run whole lanes.
+struct PhysicsSnapshot {
+  AlignedVector<float> x, y, z, radius;
+  std::size_t bodyCount = 0;
+  glm::vec3 cameraPosition{0.0f};
+  // wall time of the last tick of the fixed clock this state belongs to,
+  // counting ticks dropped while behind, and the steps actually taken
+  double time = 0.0;
+  std::uint64_t step = 0;
+
+  // copies positions and radii of every body, on all threads
+  void capture(const BodyStore &bodies);
+};
+
+struct PhysicsSettings {
+  // fixed steps per second of wall time
+  double rate = 60.0;
+  // steps taken back to back to catch up after a slow one; time lost beyond
+  // that is dropped, as the simulation cannot keep up anyway
+  int maxCatchUpSteps = 10;
+};
+
+// steps a simulation at a fixed rate on a thread of its own, so slow frames
+// do not slow the simulation down and slow steps do not hold frames back.
+// after every round of steps the thread captures the state into the back
+// slot of a TripleBuffer and publishes it; the render loop picks up the
+// newest snapshot without ever waiting.
+class PhysicsThread {
+public:
+  // advances the simulation by deltaTime seconds
+  using StepFunction = std::function<void(float deltaTime)>;
+  // writes the current state into snapshot; time and step are set by the
+  // thread
+  using CaptureFunction = std::function<void(PhysicsSnapshot &snapshot)>;
+
+  PhysicsThread() = default;
+  ~PhysicsThread() { stop(); }
+  PhysicsThread(const PhysicsThread &) = delete;
+  PhysicsThread &operator=(const PhysicsThread &) = delete;
+
+  // publishes the initial state and starts stepping. the functions run on
+  // the physics thread only, so whatever they touch belongs to it until stop
+  void start(const PhysicsSettings &settings, StepFunction step,
+             CaptureFunction capture);
+  // finishes the current step and joins the thread
+  void stop();
+  bool isRunning() const { return worker.joinable(); }
+
+  // picks up the newest snapshot, false if there is none since the last
+  // call; render thread only
+  bool update() { return snapshots.update(); }
+  // snapshot picked up by the last update, unchanged until the next one
+  const PhysicsSnapshot &latest() const { return snapshots.front(); }
+  // seconds since start on the clock the fixed steps follow, which is what
+  // PhysicsSnapshot::time is measured in
+  double getTime() const;
+
+  std::uint64_t getStepCount() const { return stepCount.load(); }
+  // steps given up on because the thread fell too far behind
+  std::uint64_t getDroppedCount() const { return droppedCount.load(); }
+
+private:
+  PhysicsSettings settings;
+  StepFunction step;
+  CaptureFunction capture;
+  TripleBuffer<PhysicsSnapshot> snapshots;
+  std::atomic<bool> stopping{false};
+  std::atomic<std::uint64_t> stepCount{0};
+  std::atomic<std::uint64_t> droppedCount{0};
+  std::thread worker;
+  std::chrono::steady_clock::time_point startTime;
+
+  void publish(double time, std::uint64_t steps);
+  void run();
+};
+
+#endif
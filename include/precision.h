@@ -0,0 +1,40 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+// precision policies for the simulation core. Position is what positions and
+// velocities are stored and integrated in, Pair the type of the per pair
+// force math (and of masses and radii), Accumulator the type accelerations
+// are summed in.
+struct FloatPrecision {
+  using Position = float;
+  using Pair = float;
+  using Accumulator = float;
+  static constexpr const char *name = "float";
+};
+
+struct DoublePrecision {
+  using Position = double;
+  using Pair = double;
+  using Accumulator = double;
+  static constexpr const char *name = "double";
+};
+
+// double positions keep small steps from rounding away far from the origin,
+// while offsets between bodies are small enough for float pair math
+struct MixedPrecision {
+  using Position = double;
+  using Pair = float;
+  using Accumulator = double;
+  static constexpr const char *name = "mixed";
+};
+
+// policy of this build, picked with the SOLAR_SIM_PRECISION cmake option
+#if defined(SOLAR_SIM_PRECISION_DOUBLE)
+using Precision = DoublePrecision;
+#elif defined(SOLAR_SIM_PRECISION_MIXED)
+using Precision = MixedPrecision;
+#else
+using Precision = FloatPrecision;
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef RAY_KERNELS_H
+#define RAY_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <aligned_allocator.h>
+#include <body_arrays.h>
+#include <cpu_features.h>
+
+template <typename Policy> class BasicBodyStore;
+using BodyStore = BasicBodyStore<Precision>;
+
+// hit of a ray that met no body
+constexpr std::uint32_t noBodyHit = 0xffffffffu;
+
+// raw pointers to rays as structure of arrays, with normalized directions
+struct RayArrays {
+  const float *ox, *oy, *oz;
+  const float *dx, *dy, *dz;
+  std::size_t count;
+};
+
+// rays cast together, for line of sight checks, eclipse sampling or
+// sensors, stored as structure of arrays
+class RayPacket {
+public:
+  AlignedVector<float> ox, oy, oz;
+  AlignedVector<float> dx, dy, dz;
+
+  // adds a ray; the direction is normalized here
+  void add(const glm::vec3 &origin, const glm::vec3 &direction);
+  void clear();
+  std::size_t size() const { return ox.size(); }
+  RayArrays arrays() const;
+};
+
+// tests rays [begin, end) against bodies [jBegin, jEnd) and keeps the
+// nearest hit of each ray, where a ray starting inside a body hits it where
+// it leaves. distances holds the farthest distance still of interest on
+// entry and the distance of the nearest hit on return; hits gets the body
+// of that hit and is left alone for rays that hit nothing closer. on equal
+// distances the lower body index wins, so calls over consecutive ranges of
+// bodies give the same result as one over all of them.
+//
+// jBegin has to be a multiple of BodyStore::laneWidth; jEnd is clamped to
+// bodies.count. the vector kernels test one body per lane, 4, 8 or 16 at a
+// time, against a few rays at once so every body load serves all of them.
+// they work in float and agree with the scalar kernel to within float
+// rounding of the offsets from the ray origin.
+template <typename Policy>
+using BasicRayKernel = void (*)(const BasicBodyArrays<Policy> &bodies,
+                                std::size_t jBegin, std::size_t jEnd,
+                                const RayArrays &rays, std::size_t begin,
+                                std::size_t end, float *distances,
+                                std::uint32_t *hits);
+
+// kernel of the precision this build was configured with; like the gravity
+// kernels only float has vector kernels
+using RayKernel = BasicRayKernel<Precision>;
+
+RayKernel getRayKernel(SimdLevel level);
+// kernel for the widest instruction set of this CPU, picked on first use
+RayKernel getRayKernel();
+
+// nearest body along every ray, with distances as for the kernels and hits
+// set to noBodyHit where there is none. rays are spread over all threads in
+// chunks, and each chunk passes over the bodies in tiles small enough to
+// stay in cache while all of its rays are tested against them.
+void castRays(const BodyStore &bodies, const RayArrays &rays, float *distances,
+              std::uint32_t *hits);
+
+// portable kernel for any precision policy, in double
+template <typename Policy>
+void raySpheresScalar(const BasicBodyArrays<Policy> &bodies,
+                      std::size_t jBegin, std::size_t jEnd,
+                      const RayArrays &rays, std::size_t begin,
+                      std::size_t end, float *distances, std::uint32_t *hits);
+
+// per instruction set entry points, float only; only call after checking the
+// CPU
+#if defined(SOLAR_SIM_X86)
+void raySpheresSse2(const FloatBodyArrays &bodies, std::size_t jBegin,
+                    std::size_t jEnd, const RayArrays &rays,
+                    std::size_t begin, std::size_t end, float *distances,
+                    std::uint32_t *hits);
+void raySpheresAvx2(const FloatBodyArrays &bodies, std::size_t jBegin,
+                    std::size_t jEnd, const RayArrays &rays,
+                    std::size_t begin, std::size_t end, float *distances,
+                    std::uint32_t *hits);
+void raySpheresAvx512(const FloatBodyArrays &bodies, std::size_t jBegin,
+                      std::size_t jEnd, const RayArrays &rays,
+                      std::size_t begin, std::size_t end, float *distances,
+                      std::uint32_t *hits);
+#endif
+
+#endif
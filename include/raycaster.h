@@ -1,9 +1,14 @@
 #ifndef RAYCASTER
 #define RAYCASTER
 
+#include <limits>
+#include <vector>
 #include <glm/glm.hpp>
+#include <body_bvh.h>
+#include <body_store.h>
 #include <camera.h>
 #include <celestial_body.h>
+#include <ray_kernels.h>
 
 class Ray {
 public:
@@ -24,6 +29,25 @@ public:
                                                  const glm::mat4 &view);
   bool checkRayIntersection(const Ray &ray, const CelestialBody &body);
 
+  // nearest body on the ray, through a BodyBvh kept up to date with bodies,
+  // so picking over a million bodies does not test every one of them
+  bool pickClosest(const Ray &ray, const BodyStore &bodies, const BodyBvh &bvh,
+                   BodyHit &hit,
+                   float maxDistance =
+                       std::numeric_limits<float>::infinity()) const;
+  // whether any body lies on the ray within maxDistance, for hover tests
+  bool pickAny(const Ray &ray, const BodyStore &bodies, const BodyBvh &bvh,
+               float maxDistance =
+                   std::numeric_limits<float>::infinity()) const;
+  // nearest body along every ray of the packet, tested against all bodies
+  // with the vector kernels; hits is noBodyHit where a ray met nothing
+  // within maxDistance
+  void castRays(const RayPacket &rays, const BodyStore &bodies,
+                std::vector<float> &distances,
+                std::vector<std::uint32_t> &hits,
+                float maxDistance =
+                    std::numeric_limits<float>::infinity()) const;
+
 private:
   Camera *camera;
 };
@@ -0,0 +1,38 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <string>
+#include <body_store.h>
+#include <gravity_solver.h>
+#include <integrator.h>
+
+// bodies plus the settings to simulate them with, as read from a scene file.
+// the file has one directive per line, and # starts a comment:
+//
+//   gravity direct | barnes-hut | fmm
+//   opening-angle 0.5
+//   quadrupole on | off
+//   expansion-order 4
+//   integrator euler | leapfrog | verlet | block | hermite
+//   levels 8
+//   accuracy 0.02
+//   timestep 0.01
+//   body <radius> <mass> <x> <y> <z> <vx> <vy> <vz>
+//   catalog <path>
+//
+// catalog appends the bodies of a CSV catalog, see loadCatalog; a relative
+// path starts from the directory of the scene file. hermite does its own
+// direct summation and refuses any other gravity.
+// anything left out keeps the defaults below.
+struct Scene {
+  BodyStore bodies;
+  GravitySettings gravity;
+  IntegratorSettings integrator{IntegratorMethod::Leapfrog};
+  float timeStep = 0.01f;
+};
+
+// replaces scene with the contents of the file at path. on failure returns
+// false and leaves "path:line: reason" in error.
+bool loadScene(const std::string &path, Scene &scene, std::string &error);
+
+#endif
@@ -2,9 +2,21 @@
 #define SHADER
 
 #include <glad/glad.h>
+#include <functional>
+#include <map>
 #include <string>
+#include <string_view>
 #include <glm/glm.hpp>
 
+// binding point of the Frame uniform block, which holds what every shader
+// needs once per frame:
+//
+//   layout(std140) uniform Frame {
+//       mat4 projection;
+//       mat4 view;
+//   };
+const GLuint frameUniformBinding = 0;
+
 class Shader {
 public:
   unsigned int ID;
@@ -13,22 +25,55 @@ public:
 
   void use();
 
-  void setBool(const std::string &name, bool value) const;
-  void setInt(const std::string &name, int value) const;
-  void setFloat(const std::string &name, float value) const;
-  void setVec2(const std::string &name, const glm::vec2 &value) const;
-  void setVec2(const std::string &name, float x, float y) const;
-  void setVec3(const std::string &name, const glm::vec3 &value) const;
-  void setVec3(const std::string &name, float x, float y, float z) const;
-  void setVec4(const std::string &name, const glm::vec4 &value) const;
-  void setVec4(const std::string &name, float x, float y, float z,
+  // location of an active uniform outside of any block, or -1, which the
+  // setters ignore like GL does
+  GLint getUniformLocation(std::string_view name) const;
+
+  void setBool(std::string_view name, bool value) const;
+  void setInt(std::string_view name, int value) const;
+  void setFloat(std::string_view name, float value) const;
+  void setVec2(std::string_view name, const glm::vec2 &value) const;
+  void setVec2(std::string_view name, float x, float y) const;
+  void setVec3(std::string_view name, const glm::vec3 &value) const;
+  void setVec3(std::string_view name, float x, float y, float z) const;
+  void setVec4(std::string_view name, const glm::vec4 &value) const;
+  void setVec4(std::string_view name, float x, float y, float z,
                float w) const;
-  void setMat2(const std::string &name, const glm::mat2 &mat) const;
-  void setMat3(const std::string &name, const glm::mat3 &mat) const;
-  void setMat4(const std::string &name, const glm::mat4 &mat) const;
+  void setMat2(std::string_view name, const glm::mat2 &mat) const;
+  void setMat3(std::string_view name, const glm::mat3 &mat) const;
+  void setMat4(std::string_view name, const glm::mat4 &mat) const;
 
 private:
+  // locations of the active uniforms, every array element included, read
+  // once after linking so setters never ask GL by name. names spelled
+  // another way are looked up on first use and kept, misses as -1. ordered
+  // with std::less<> so a literal is found without building a std::string;
+  // a shader has few enough uniforms that a search beats hashing the name.
+  mutable std::map<std::string, GLint, std::less<>> uniformLocations;
+
   void checkCompileErrors(unsigned int shader, const std::string &type);
+  void reflectUniforms();
+};
+
+// the Frame block in a uniform buffer bound to frameUniformBinding, shared by
+// every program; one update a frame serves all of them
+class FrameUniforms {
+public:
+  FrameUniforms();
+  ~FrameUniforms();
+  FrameUniforms(const FrameUniforms &) = delete;
+  FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+  void update(const glm::mat4 &projection, const glm::mat4 &view);
+
+private:
+  // std140 layout of the block; two mat4 need no padding
+  struct Block {
+    glm::mat4 projection;
+    glm::mat4 view;
+  };
+
+  GLuint buffer;
 };
 
 #endif
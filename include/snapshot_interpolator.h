@@ -0,0 +1,33 @@
+#ifndef SNAPSHOT_INTERPOLATOR_H
+#define SNAPSHOT_INTERPOLATOR_H
+
+#include <physics_thread.h>
+
+// blends the two newest snapshots of a PhysicsThread for the render loop, so
+// a simulation stepped at 30 to 60 Hz still moves smoothly at the frame rate
+// of the display. asking for a time one step behind the physics thread
+// always finds a newer state to blend towards.
+class SnapshotInterpolator {
+public:
+  // takes snapshot as the newest state, and the one pushed before it as the
+  // state to blend from. snapshot is copied, so the physics thread may reuse
+  // its slot right after.
+  void push(const PhysicsSnapshot &snapshot);
+
+  // how far time lies from the older state towards the newer one, clamped
+  // to [0, 1]; time is on the clock of PhysicsThread::getTime
+  float getAlpha(double time) const;
+  // state at time, with positions, radii and the camera blended on the
+  // calling thread, one vector pass over every array. when bodies were added
+  // or removed between the two states their indices no longer match, and the
+  // newer state is shown as it is. the result is kept until the next call.
+  const PhysicsSnapshot &interpolate(double time);
+
+  bool empty() const { return pushed == 0; }
+
+private:
+  PhysicsSnapshot previous, next, blended;
+  std::size_t pushed = 0;
+};
+
+#endif
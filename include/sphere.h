@@ -11,7 +11,8 @@ public:
   Sphere(float radius, unsigned int latitudeCount, unsigned int longitudeCount,
          Shader *shader = nullptr);
   void generateSphere();
-  void render(glm::mat4 projection, glm::mat4 view, glm::vec3 position);
+  // projection and view come from the Frame uniform block
+  void render(glm::vec3 position);
   void setShader(Shader *shader);
 
 private:
@@ -10,8 +10,8 @@ class Starfield {
 public:
   Starfield(unsigned int numPoints, float distance);
 
-  void render(Shader &shader, const glm::mat4 &projection,
-              const glm::mat4 &viewMatrix);
+  // projection and view come from the Frame uniform block
+  void render(Shader &shader);
   void updateStarPositions();
 
 private:
@@ -0,0 +1,112 @@
+#ifndef TRAJECTORY_CODEC_H
+#define TRAJECTORY_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <body_store.h>
+
+// the 32 bytes at the start of a trajectory file
+struct TrajectoryFileHeader {
+  // "SOLTRAJ1" for raw frames, "SOLTRAJZ" for compressed ones
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t positionSize;
+  char precision[16];
+};
+
+// the 32 bytes in front of every frame. raw frames follow with the x, y, z,
+// vx, vy, vz and BodyStore::id arrays and leave size and flags zero;
+// compressed frames follow with size bytes of encoded positions and ids.
+struct TrajectoryFrameHeader {
+  // bytes per body of a raw frame
+  static constexpr std::size_t rawBodySize =
+      6 * sizeof(BodyStore::Position) + sizeof(std::uint32_t);
+
+  std::uint64_t step;
+  double time;
+  std::uint64_t bodyCount;
+  std::uint32_t size;
+  std::uint32_t flags;
+};
+
+static_assert(sizeof(TrajectoryFileHeader) == 32,
+              "the trajectory header is 32 bytes");
+static_assert(sizeof(TrajectoryFrameHeader) == 32,
+              "the frame header is 32 bytes");
+
+struct TrajectoryCodecSettings {
+  // bits per quantized coordinate, 8 to 24. every coordinate comes back
+  // within half a step of the chunk's bounding box divided into 2^bits - 1
+  unsigned bits = 20;
+  // frames per chunk; a chunk starts with a keyframe, which is where a
+  // reader can start decoding
+  std::size_t keyframeInterval = 32;
+};
+
+// compresses positions frame by frame. every chunk of frames gets a bounding
+// box from its keyframe, grown by a margin, and positions are quantized on
+// that box. the keyframe stores the quantized values, the frame after it the
+// difference to the keyframe, and every later frame the difference to a
+// straight line through the two frames before, which stays small along
+// smooth orbits. each coordinate column is entropy coded on its own: the
+// bit length of a residual with rANS on a table of the column's lengths, the
+// bits below the leading one as they are. columns are cut into segments of
+// segmentBodies bodies with their own coder state, so decoding runs on all
+// threads. a body leaving the box or a change of the bodies starts a new
+// chunk early. keyframes carry the ids of the chunk's bodies as they are.
+//
+// velocities are not stored; non-finite positions come back as the corner
+// of the box.
+class TrajectoryEncoder {
+public:
+  static const std::uint32_t keyframeFlag = 1;
+  static const std::size_t segmentBodies = std::size_t(1) << 16;
+
+  explicit TrajectoryEncoder(const TrajectoryCodecSettings &settings = {});
+
+  // appends the frame header and the encoded frame to out
+  void encode(std::uint64_t step, double time, std::size_t count,
+              const BodyStore::Position *x, const BodyStore::Position *y,
+              const BodyStore::Position *z, const std::uint32_t *id,
+              std::vector<unsigned char> &out);
+  // the next frame becomes a keyframe
+  void reset() { chunkFrames = 0; }
+
+private:
+  TrajectoryCodecSettings settings;
+  std::size_t chunkFrames = 0;
+  std::size_t bodyCount = 0;
+  double origin[3], scale[3];
+  // quantized frames, newest first
+  std::vector<std::int32_t> history[3][3];
+  // ids of the chunk's bodies
+  std::vector<std::uint32_t> ids;
+  std::vector<std::uint32_t> residuals;
+  std::vector<unsigned char> symbols, encoded;
+
+  bool quantize(const BodyStore::Position *values, int axis);
+  void fitBox(std::size_t count, const BodyStore::Position *const *axes);
+  void encodeColumn(int axis, bool keyframe, std::vector<unsigned char> &out);
+};
+
+// the other end: turns the encoded frames of one file back into positions.
+// frames have to come in order from a keyframe on.
+class TrajectoryDecoder {
+public:
+  // decodes a frame. fails on damaged data or a frame that does not follow
+  // the last one decoded in its chunk.
+  bool decode(const TrajectoryFrameHeader &header, const unsigned char *data);
+  // positions and ids of the last decoded frame
+  void positions(BodyStore &bodies) const;
+  bool hasFrame() const { return chunkFrames > 0; }
+
+private:
+  std::size_t chunkFrames = 0;
+  std::size_t bodyCount = 0;
+  double origin[3], scale[3];
+  std::vector<std::int32_t> history[3][3];
+  std::vector<std::uint32_t> ids;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TRAJECTORY_READER_H
+#define TRAJECTORY_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <body_store.h>
+#include <mapped_file.h>
+#include <trajectory_codec.h>
+
+// plays back a file of TrajectoryWriter, raw or compressed. the file is
+// mapped read only and indexed on open, so any frame can be read: raw frames
+// directly, compressed ones by decoding from the keyframe of their chunk,
+// and reading the frames in order decodes every one just once. a frame cut
+// short by a crash of the writer is left out.
+class TrajectoryReader {
+public:
+  TrajectoryReader() = default;
+  ~TrajectoryReader() { close(); }
+  TrajectoryReader(const TrajectoryReader &) = delete;
+  TrajectoryReader &operator=(const TrajectoryReader &) = delete;
+
+  bool open(const std::string &path, std::string &error);
+  void close();
+  bool isOpen() const { return data != nullptr; }
+  bool isCompressed() const { return compressed; }
+  std::size_t getFileSize() const { return size; }
+
+  std::size_t getFrameCount() const { return frames.size(); }
+  std::uint64_t getStep(std::size_t frame) const;
+  double getTime(std::size_t frame) const;
+  std::size_t getBodyCount(std::size_t frame) const;
+  // the last frame at or before time, or the first one
+  std::size_t findFrame(double time) const;
+
+  // fills the positions and ids of frame into bodies, resized to its body
+  // count. raw files fill in the velocities as well, compressed ones leave
+  // them and every other array as they were.
+  bool readFrame(std::size_t frame, BodyStore &bodies, std::string &error);
+
+private:
+  struct Frame {
+    std::size_t offset;
+    // the frame decoding has to start from
+    std::size_t keyframe;
+  };
+
+  const unsigned char *data = nullptr;
+  std::size_t size = 0;
+  MappedFile file;
+  bool compressed = false;
+  std::vector<Frame> frames;
+  TrajectoryDecoder decoder;
+  std::size_t decodedFrame = 0;
+
+  TrajectoryFrameHeader header(std::size_t frame) const;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef TRAJECTORY_WRITER_H
+#define TRAJECTORY_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <aligned_allocator.h>
+#include <body_store.h>
+#include <trajectory_codec.h>
+
+enum class TrajectoryBackpressure {
+  // frames that find the ring full are dropped, the simulation never waits
+  Drop,
+  // the simulation waits for a free slot, no frame is lost
+  Wait
+};
+
+struct TrajectorySettings {
+  // frames the ring holds between the simulation and the writer thread
+  std::size_t slotCount = 64;
+  TrajectoryBackpressure backpressure = TrajectoryBackpressure::Drop;
+  // write through io_uring where the kernel offers it
+  bool useIoUring = true;
+  // store positions and ids only, compressed by TrajectoryEncoder on the
+  // writer thread, instead of raw positions, velocities and ids
+  bool compress = false;
+  TrajectoryCodecSettings codec;
+};
+
+struct TrajectoryStats {
+  std::uint64_t framesSubmitted = 0;
+  std::uint64_t framesWritten = 0;
+  std::uint64_t framesDropped = 0;
+  // submits that found the ring full, and the time they waited for a slot
+  std::uint64_t stalls = 0;
+  double stallSeconds = 0.0;
+  std::uint64_t bytesWritten = 0;
+  // most frames ever waiting in the ring
+  std::size_t peakQueued = 0;
+  // write calls issued by the writer thread, each covering a batch of frames
+  std::uint64_t writes = 0;
+};
+
+// streams sampled positions and velocities to disk off the simulation thread.
+// submit copies the bodies into the next slot of a single producer, single
+// consumer ring and returns; a writer thread drains every filled slot with one
+// gathered sequential write and only then hands the slots back. the ring is
+// lock free, the writer just sleeps on a condition variable while it is empty.
+//
+// the file starts with a TrajectoryFileHeader followed by one frame per
+// sample: a TrajectoryFrameHeader with the step, the time and the body count,
+// then either the x, y, z, vx, vy, vz and id arrays of that many bodies or
+// their compressed positions and ids. TrajectoryReader reads both.
+class TrajectoryWriter {
+public:
+  static constexpr std::uint32_t version = 2;
+
+  TrajectoryWriter() = default;
+  ~TrajectoryWriter() { close(); }
+  TrajectoryWriter(const TrajectoryWriter &) = delete;
+  TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+  // frames hold up to bodyCapacity bodies; larger ones count as dropped
+  bool open(const std::string &path, std::size_t bodyCapacity,
+            const TrajectorySettings &settings, std::string &error);
+  // writes out every frame still in the ring and stops the writer thread
+  void close();
+  bool isOpen() const { return writer.joinable(); }
+
+  // queues a frame, false if it was dropped. only one thread may submit.
+  bool submit(const BodyStore &bodies, double time, std::uint64_t step);
+
+  // call from the submitting thread
+  TrajectoryStats getStats() const;
+  // how the writer thread writes: "io_uring", "writev" or "stdio"
+  const char *getBackendName() const;
+  // set once a write failed; the writer then drops everything
+  bool hasFailed() const { return failed.load(); }
+
+private:
+  struct IoRing;
+
+  TrajectorySettings settings;
+  std::size_t bodyCapacity = 0;
+  std::size_t slotSize = 0;
+  AlignedVector<unsigned char> slots;
+
+  // frames published by submit and released by the writer, counted from
+  // the start; head - tail frames are queued
+  alignas(64) std::atomic<std::uint64_t> head{0};
+  alignas(64) std::atomic<std::uint64_t> tail{0};
+
+  std::atomic<bool> stopping{false};
+  std::atomic<bool> failed{false};
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::thread writer;
+
+  // file and write position, only touched by the writer thread
+#if defined(_WIN32)
+  std::FILE *file = nullptr;
+#else
+  int file = -1;
+#endif
+  std::uint64_t fileOffset = 0;
+  IoRing *ring = nullptr;
+  // pieces of the batch being written
+  struct Piece {
+    const unsigned char *data;
+    std::size_t size;
+  };
+  std::vector<Piece> pieces;
+  TrajectoryEncoder encoder;
+  std::vector<unsigned char> encoded;
+
+  // counters of the submitting thread
+  std::uint64_t framesSubmitted = 0;
+  std::uint64_t framesDropped = 0;
+  std::uint64_t stalls = 0;
+  double stallSeconds = 0.0;
+  std::size_t peakQueued = 0;
+  // counters of the writer thread
+  std::atomic<std::uint64_t> framesWritten{0};
+  std::atomic<std::uint64_t> bytesWritten{0};
+  std::atomic<std::uint64_t> writes{0};
+
+  unsigned char *slot(std::uint64_t frame) {
+    return slots.data() + (frame % settings.slotCount) * slotSize;
+  }
+  void writerLoop();
+  bool writeFrames(std::uint64_t first, std::uint64_t last);
+  bool writePieces();
+};
+
+#endif
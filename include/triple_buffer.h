@@ -0,0 +1,51 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// hands whole values from one writer thread to one reader thread without
+// either ever waiting. the writer fills the back slot and publishes it, the
+// reader picks up the newest published slot whenever it likes; a third slot
+// in between means neither side ever touches the slot the other one holds.
+// values published faster than they are read are skipped, never queued.
+template <typename T> class TripleBuffer {
+public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  // slot the writer fills next; writer thread only
+  T &back() { return slots[backIndex]; }
+  // swaps the filled back slot for the middle one, which the reader either
+  // never picked up or already let go of; writer thread only
+  void publish() {
+    backIndex =
+        middle.exchange(backIndex | freshBit, std::memory_order_acq_rel) &
+        indexMask;
+  }
+
+  // takes the newest published slot as front, false if nothing was
+  // published since the last call; reader thread only
+  bool update() {
+    if (!(middle.load(std::memory_order_relaxed) & freshBit))
+      return false;
+    frontIndex =
+        middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+    return true;
+  }
+  // slot the reader holds, stable until the next update; reader thread only
+  const T &front() const { return slots[frontIndex]; }
+
+private:
+  static constexpr unsigned int indexMask = 3;
+  // set in middle while it holds a slot the reader has not seen
+  static constexpr unsigned int freshBit = 4;
+
+  T slots[3];
+  // each side keeps its index on its own line
+  alignas(64) unsigned int backIndex = 0;
+  alignas(64) std::atomic<unsigned int> middle{1};
+  alignas(64) unsigned int frontIndex = 2;
+};
+
+#endif
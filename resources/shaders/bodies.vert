@@ -0,0 +1,24 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+// per instance: centre and radius, then colour
+layout(location = 3) in vec4 body;
+layout(location = 4) in vec4 bodyColor;
+
+layout(std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+};
+
+out vec3 fragColor;
+
+void main()
+{
+    vec3 world = body.xyz + body.w * position;
+    // lit from the central body at the origin, which lights itself
+    float away = length(body.xyz);
+    vec3 toLight = away > 0.0 ? -body.xyz / away : normalize(normal);
+    float light = 0.25 + 0.75 * max(dot(normalize(normal), toLight), 0.0);
+    fragColor = bodyColor.rgb * light;
+    gl_Position = projection * view * vec4(world, 1.0);
+}
@@ -6,8 +6,10 @@ out vec3 fragPos;
 out vec3 normal;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+};
 
 void main() {
     fragPos = vec3(model * vec4(aPos, 1.0));
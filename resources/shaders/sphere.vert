@@ -2,8 +2,10 @@
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout(std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+};
 uniform mat4 model;
 
 out vec3 fragColor;
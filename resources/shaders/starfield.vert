@@ -4,8 +4,10 @@ layout(location = 1) in vec3 aColor;
 
 out vec3 starsColor;  
 
-uniform mat4 projection;
-uniform mat4 view;
+layout(std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+};
 
 void main() {
     gl_Position = projection * view * vec4(aPos, 1.0);
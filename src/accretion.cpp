@@ -0,0 +1,124 @@
+#include <accretion.h>
+#include <algorithm>
+#include <cmath>
+
+static std::uint32_t memberBody(std::uint64_t member) {
+  return static_cast<std::uint32_t>(member);
+}
+
+std::uint32_t Accretion::findGroup(std::uint32_t body) {
+  while (parent[body] != body) {
+    parent[body] = parent[parent[body]];
+    body = parent[body];
+  }
+  return body;
+}
+
+std::size_t Accretion::merge(BodyStore &bodies) {
+  broadphase.findOverlaps(bodies, pairs);
+  return merge(bodies, pairs);
+}
+
+std::size_t Accretion::merge(BodyStore &bodies,
+                             const std::vector<BodyPair> &touching) {
+  const std::size_t n = bodies.size();
+  remap.clear();
+  merges.clear();
+  if (touching.empty())
+    return 0;
+
+  // only bodies in a pair are ever looked at, so only they need a parent
+  parent.resize(n);
+  for (const BodyPair &pair : touching) {
+    parent[pair.first] = pair.first;
+    parent[pair.second] = pair.second;
+  }
+  for (const BodyPair &pair : touching) {
+    const std::uint32_t a = findGroup(pair.first);
+    const std::uint32_t b = findGroup(pair.second);
+    if (a != b)
+      parent[std::max(a, b)] = std::min(a, b);
+  }
+
+  members.clear();
+  for (const BodyPair &pair : touching)
+    for (std::uint32_t body : {pair.first, pair.second})
+      members.push_back(std::uint64_t(findGroup(body)) << 32 | body);
+  std::sort(members.begin(), members.end());
+  members.erase(std::unique(members.begin(), members.end()), members.end());
+
+  removed.clear();
+  for (std::size_t begin = 0; begin < members.size();) {
+    std::size_t end = begin + 1;
+    while (end < members.size() &&
+           members[end] >> 32 == members[begin] >> 32)
+      ++end;
+    mergeGroup(bodies, members.data() + begin, members.data() + end);
+    begin = end;
+  }
+  std::sort(removed.begin(), removed.end());
+
+  // new indices of the remaining bodies, then of the absorbed ones through
+  // their survivor
+  remap.resize(n);
+  std::size_t next = 0;
+  for (std::size_t i = 0, k = 0; i < n; ++i) {
+    if (k < removed.size() && removed[k] == i) {
+      ++k;
+      continue;
+    }
+    remap[i] = static_cast<std::uint32_t>(next++);
+  }
+  for (std::uint32_t body : removed)
+    remap[body] = remap[parent[body]];
+
+  bodies.remove(removed);
+  removedCount += removed.size();
+  return removed.size();
+}
+
+void Accretion::mergeGroup(BodyStore &bodies, const std::uint64_t *begin,
+                           const std::uint64_t *end) {
+  double mass = 0.0;
+  std::uint32_t survivor = memberBody(*begin);
+  for (const std::uint64_t *member = begin; member != end; ++member) {
+    const std::uint32_t body = memberBody(*member);
+    mass += bodies.mass[body];
+    // members are in index order, so ties go to the lowest index
+    if (bodies.mass[body] > bodies.mass[survivor])
+      survivor = body;
+  }
+
+  // massless groups move to their plain average
+  double volume = 0.0, weights = 0.0;
+  double position[3] = {0.0, 0.0, 0.0}, momentum[3] = {0.0, 0.0, 0.0};
+  for (const std::uint64_t *member = begin; member != end; ++member) {
+    const std::uint32_t body = memberBody(*member);
+    const double weight = mass > 0.0 ? double(bodies.mass[body]) : 1.0;
+    const double radius = bodies.radius[body];
+    volume += radius * radius * radius;
+    weights += weight;
+    position[0] += weight * bodies.x[body];
+    position[1] += weight * bodies.y[body];
+    position[2] += weight * bodies.z[body];
+    momentum[0] += weight * bodies.vx[body];
+    momentum[1] += weight * bodies.vy[body];
+    momentum[2] += weight * bodies.vz[body];
+    if (body != survivor) {
+      parent[body] = survivor;
+      removed.push_back(body);
+      merges.push_back(AccretionMerge{bodies.id[survivor], bodies.id[body]});
+    }
+  }
+
+  using Position = BodyStore::Position;
+  using Pair = BodyStore::Pair;
+  bodies.x[survivor] = static_cast<Position>(position[0] / weights);
+  bodies.y[survivor] = static_cast<Position>(position[1] / weights);
+  bodies.z[survivor] = static_cast<Position>(position[2] / weights);
+  bodies.vx[survivor] = static_cast<Position>(momentum[0] / weights);
+  bodies.vy[survivor] = static_cast<Position>(momentum[1] / weights);
+  bodies.vz[survivor] = static_cast<Position>(momentum[2] / weights);
+  bodies.mass[survivor] = static_cast<Pair>(mass);
+  bodies.radius[survivor] = static_cast<Pair>(std::cbrt(volume));
+}
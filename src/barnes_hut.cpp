@@ -0,0 +1,192 @@
+#include <barnes_hut.h>
+#include <globals.h>
+#include <pair_force.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+
+using Accumulator = BodyStore::Accumulator;
+
+BarnesHutGravity::BarnesHutGravity(float openingAngle, bool useQuadrupole,
+                                   std::uint32_t leafCapacity)
+    : openingAngle(1.0f), useQuadrupole(useQuadrupole),
+      leafCapacity(std::max(1u, leafCapacity)) {
+  setOpeningAngle(openingAngle);
+}
+
+void BarnesHutGravity::setOpeningAngle(float angle) {
+  openingAngle = std::min(std::max(angle, 0.0f), 1.0f);
+}
+
+void BarnesHutGravity::setLeafCapacity(std::uint32_t capacity) {
+  leafCapacity = std::max(1u, capacity);
+}
+
+void BarnesHutGravity::buildTree(const BodyStore &bodies) {
+  tree.build(bodies, leafCapacity);
+  moments.resize(tree.nodes.size());
+  tree.visitBottomUp(
+      [&](std::uint32_t index) { computeMoments(bodies, index); });
+}
+
+void BarnesHutGravity::computeAccelerations(BodyStore &bodies) {
+  buildTree(bodies);
+
+  Accumulator *ax = bodies.ax.data(), *ay = bodies.ay.data(),
+              *az = bodies.az.data();
+  // walking bodies in morton order keeps neighbouring walks on the same cells
+  parallelFor(0, bodies.size(), 256, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      std::uint32_t body = tree.order[k];
+      glm::vec3 acceleration = accelerationOn(bodies, body);
+      ax[body] = acceleration.x;
+      ay[body] = acceleration.y;
+      az[body] = acceleration.z;
+    }
+  });
+}
+
+void BarnesHutGravity::computeActiveAccelerations(
+    BodyStore &bodies, const std::vector<std::uint32_t> &active) {
+  // the tree still holds every body, only the walks are limited
+  buildTree(bodies);
+
+  Accumulator *ax = bodies.ax.data(), *ay = bodies.ay.data(),
+              *az = bodies.az.data();
+  parallelFor(0, active.size(), 64, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      std::uint32_t body = active[k];
+      glm::vec3 acceleration = accelerationOn(bodies, body);
+      ax[body] = acceleration.x;
+      ay[body] = acceleration.y;
+      az[body] = acceleration.z;
+    }
+  });
+}
+
+void BarnesHutGravity::computeMoments(const BodyStore &bodies,
+                                      std::uint32_t index) {
+  const OctreeNode &node = tree.nodes[index];
+  CellMoments &cell = moments[index];
+  double mass = 0.0;
+  glm::dvec3 weighted(0.0);
+  double q[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+  if (node.isLeaf()) {
+    for (std::uint32_t k = node.begin; k < node.end; ++k) {
+      std::uint32_t b = tree.order[k];
+      mass += bodies.mass[b];
+      weighted += glm::dvec3(bodies.x[b], bodies.y[b], bodies.z[b]) *
+                  static_cast<double>(bodies.mass[b]);
+    }
+  } else {
+    for (std::uint32_t c = 0; c < node.childCount; ++c) {
+      const CellMoments &child = moments[node.firstChild + c];
+      mass += child.mass;
+      weighted +=
+          glm::dvec3(child.centerOfMass) * static_cast<double>(child.mass);
+    }
+  }
+
+  glm::dvec3 center = mass > 0.0 ? weighted / mass : glm::dvec3(node.center);
+  cell.centerOfMass = glm::vec3(center);
+  cell.mass = static_cast<float>(mass);
+  glm::vec3 reach =
+      glm::abs(cell.centerOfMass - node.center) + glm::vec3(node.halfSize);
+  cell.bmaxSquared = glm::dot(reach, reach);
+
+  if (!useQuadrupole)
+    return;
+
+  // each point mass (or child about its own centre) adds
+  // m * (3 r r^T - |r|^2 I) with r measured from this cell's centre of mass
+  auto addPoint = [&](const glm::dvec3 &r, double m) {
+    double r2 = glm::dot(r, r);
+    q[0] += m * (3.0 * r.x * r.x - r2);
+    q[1] += m * (3.0 * r.y * r.y - r2);
+    q[2] += m * (3.0 * r.z * r.z - r2);
+    q[3] += m * 3.0 * r.x * r.y;
+    q[4] += m * 3.0 * r.x * r.z;
+    q[5] += m * 3.0 * r.y * r.z;
+  };
+
+  if (node.isLeaf()) {
+    for (std::uint32_t k = node.begin; k < node.end; ++k) {
+      std::uint32_t b = tree.order[k];
+      addPoint(glm::dvec3(bodies.x[b], bodies.y[b], bodies.z[b]) - center,
+               bodies.mass[b]);
+    }
+  } else {
+    for (std::uint32_t c = 0; c < node.childCount; ++c) {
+      const CellMoments &child = moments[node.firstChild + c];
+      addPoint(glm::dvec3(child.centerOfMass) - center, child.mass);
+      for (int i = 0; i < 6; ++i)
+        q[i] += child.quadrupole[i];
+    }
+  }
+  for (int i = 0; i < 6; ++i)
+    cell.quadrupole[i] = static_cast<float>(q[i]);
+}
+
+glm::vec3 BarnesHutGravity::accelerationOn(const BodyStore &bodies,
+                                           std::uint32_t body) const {
+  const BodyStore::Position px = bodies.x[body], py = bodies.y[body],
+                           pz = bodies.z[body];
+  const float radius = bodies.radius[body];
+  const float angleSquared = openingAngle * openingAngle;
+  float ax = 0.0f, ay = 0.0f, az = 0.0f;
+
+  // each visit pushes at most eight children
+  std::uint32_t stack[8 * (Octree::maxDepth + 1)];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    std::uint32_t index = stack[--top];
+    const OctreeNode &node = tree.nodes[index];
+    const CellMoments &cell = moments[index];
+    if (cell.mass == 0.0f)
+      continue;
+
+    glm::vec3 d = cell.centerOfMass - glm::vec3(px, py, pz);
+    float distanceSquared = glm::dot(d, d);
+    if (distanceSquared * angleSquared > cell.bmaxSquared) {
+      float inverse = 1.0f / std::sqrt(distanceSquared);
+      float inverse2 = inverse * inverse;
+      float inverse3 = inverse * inverse2;
+      glm::vec3 acceleration = d * (cell.mass * inverse3);
+
+      if (useQuadrupole) {
+        // a = -Q d / r^5 + 5/2 (d.Q.d) d / r^7 for d pointing at the cell
+        const float *q = cell.quadrupole;
+        glm::vec3 qd(q[0] * d.x + q[3] * d.y + q[4] * d.z,
+                     q[3] * d.x + q[1] * d.y + q[5] * d.z,
+                     q[4] * d.x + q[5] * d.y + q[2] * d.z);
+        float inverse5 = inverse3 * inverse2;
+        float dqd = glm::dot(d, qd);
+        acceleration += -qd * inverse5 + d * (2.5f * dqd * inverse5 * inverse2);
+      }
+
+      acceleration *= gravityScale;
+      ax += acceleration.x;
+      ay += acceleration.y;
+      az += acceleration.z;
+      continue;
+    }
+
+    if (node.isLeaf()) {
+      for (std::uint32_t k = node.begin; k < node.end; ++k) {
+        std::uint32_t other = tree.order[k];
+        accumulatePairAcceleration<float>(
+            bodies.x[other] - px, bodies.y[other] - py, bodies.z[other] - pz,
+            radius, bodies.radius[other], bodies.mass[other], ax, ay, az);
+      }
+      continue;
+    }
+
+    for (std::uint32_t c = 0; c < node.childCount; ++c)
+      stack[top++] = node.firstChild + c;
+  }
+
+  return glm::vec3(ax, ay, az);
+}
@@ -0,0 +1,205 @@
+#include <block_integrator.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using Position = BodyStore::Position;
+
+BlockTimestepIntegrator::BlockTimestepIntegrator(int levelCount,
+                                                 float accuracy)
+    : levelCount(1), accuracy(accuracy) {
+  setLevelCount(levelCount);
+}
+
+void BlockTimestepIntegrator::setLevelCount(int count) {
+  levelCount = std::min(std::max(count, 1), maxLevelCount);
+  reset();
+}
+
+void BlockTimestepIntegrator::visitState(IntegratorStateVisitor &visitor) {
+  visitor.visit("levelCount", levelCount);
+  visitor.visit("accuracy", accuracy);
+  visitor.visit("stepSize", stepSize);
+  visitor.visit("x0", x0);
+  visitor.visit("y0", y0);
+  visitor.visit("z0", z0);
+  visitor.visit("vx0", vx0);
+  visitor.visit("vy0", vy0);
+  visitor.visit("vz0", vz0);
+  visitor.visit("ax0", ax0);
+  visitor.visit("ay0", ay0);
+  visitor.visit("az0", az0);
+  visitor.visit("jx", jx);
+  visitor.visit("jy", jy);
+  visitor.visit("jz", jz);
+  visitor.visit("levels", levels);
+  visitor.visit("lastTick", lastTick);
+  visitor.visit("forceEvaluations", forceEvaluations);
+  visitor.visit("sharedEvaluations", sharedEvaluations);
+}
+
+void BlockTimestepIntegrator::initialize(BodyStore &bodies,
+                                         GravitySolver &gravity) {
+  const std::size_t n = bodies.size();
+  for (AlignedVector<BodyStore::Position> *field :
+       {&x0, &y0, &z0, &vx0, &vy0, &vz0})
+    field->assign(n, 0);
+  for (AlignedVector<BodyStore::Accumulator> *field :
+       {&ax0, &ay0, &az0, &jx, &jy, &jz})
+    field->assign(n, 0);
+  levels.assign(n, 0);
+  lastTick.assign(n, 0);
+
+  evaluate(bodies, gravity, true);
+  forceEvaluations += n;
+  for (std::size_t i = 0; i < n; ++i) {
+    x0[i] = bodies.x[i];
+    y0[i] = bodies.y[i];
+    z0[i] = bodies.z[i];
+    vx0[i] = bodies.vx[i];
+    vy0[i] = bodies.vy[i];
+    vz0[i] = bodies.vz[i];
+    initializeBody(bodies, i);
+    levels[i] =
+        static_cast<std::uint8_t>(chooseLevel(i, bodies.radius[i], 0));
+  }
+}
+
+void BlockTimestepIntegrator::evaluate(BodyStore &bodies,
+                                       GravitySolver &gravity, bool all) {
+  if (all)
+    gravity.computeAccelerations(bodies);
+  else
+    gravity.computeActiveAccelerations(bodies, active);
+}
+
+void BlockTimestepIntegrator::initializeBody(const BodyStore &bodies,
+                                             std::size_t i) {
+  // no jerk is known yet, so only the acceleration criterion applies
+  ax0[i] = bodies.ax[i];
+  ay0[i] = bodies.ay[i];
+  az0[i] = bodies.az[i];
+}
+
+void BlockTimestepIntegrator::correctBody(const BodyStore &bodies,
+                                          std::size_t i, Position h) {
+  const Position h2 = h / 2, h3 = h / 3;
+  jx[i] = (bodies.ax[i] - ax0[i]) / h;
+  jy[i] = (bodies.ay[i] - ay0[i]) / h;
+  jz[i] = (bodies.az[i] - az0[i]) / h;
+  x0[i] += h * (vx0[i] + h2 * (ax0[i] + h3 * jx[i]));
+  y0[i] += h * (vy0[i] + h2 * (ay0[i] + h3 * jy[i]));
+  z0[i] += h * (vz0[i] + h2 * (az0[i] + h3 * jz[i]));
+  vx0[i] += h2 * (ax0[i] + bodies.ax[i]);
+  vy0[i] += h2 * (ay0[i] + bodies.ay[i]);
+  vz0[i] += h2 * (az0[i] + bodies.az[i]);
+  ax0[i] = bodies.ax[i];
+  ay0[i] = bodies.ay[i];
+  az0[i] = bodies.az[i];
+}
+
+float BlockTimestepIntegrator::wantedStep(std::size_t i, float radius) const {
+  float acceleration =
+      std::sqrt(ax0[i] * ax0[i] + ay0[i] * ay0[i] + az0[i] * az0[i]);
+  float jerk = std::sqrt(jx[i] * jx[i] + jy[i] * jy[i] + jz[i] * jz[i]);
+
+  float wanted = std::numeric_limits<float>::max();
+  if (jerk > 0.0f)
+    wanted = accuracy * acceleration / jerk;
+  if (acceleration > 0.0f)
+    wanted = std::min(wanted, std::sqrt(accuracy * (radius + 1.0f) /
+                                        acceleration));
+  return wanted;
+}
+
+int BlockTimestepIntegrator::chooseLevel(std::size_t i, float radius,
+                                         std::uint32_t tick) const {
+  float wanted = wantedStep(i, radius);
+  int level = 0;
+  while (level < levelCount - 1 && stepSize / (1u << level) > wanted)
+    ++level;
+
+  // a longer step has to start at a tick it is aligned to
+  while (level < levels[i] && tick % ticksPerStep(level) != 0)
+    ++level;
+  return level;
+}
+
+void BlockTimestepIntegrator::predict(BodyStore &bodies, std::uint32_t tick,
+                                      double tickSize) {
+  parallelFor(0, bodies.size(), 4096, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      const Position h = static_cast<Position>((tick - lastTick[i]) * tickSize);
+      const Position h2 = h / 2, h3 = h / 3;
+      bodies.x[i] = x0[i] + h * (vx0[i] + h2 * (ax0[i] + h3 * jx[i]));
+      bodies.y[i] = y0[i] + h * (vy0[i] + h2 * (ay0[i] + h3 * jy[i]));
+      bodies.z[i] = z0[i] + h * (vz0[i] + h2 * (az0[i] + h3 * jz[i]));
+      bodies.vx[i] = vx0[i] + h * (ax0[i] + h2 * jx[i]);
+      bodies.vy[i] = vy0[i] + h * (ay0[i] + h2 * jy[i]);
+      bodies.vz[i] = vz0[i] + h * (az0[i] + h2 * jz[i]);
+    }
+  });
+}
+
+void BlockTimestepIntegrator::correct(BodyStore &bodies, std::uint32_t tick,
+                                      double tickSize) {
+  parallelFor(0, active.size(), 256, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      const std::uint32_t i = active[k];
+      const Position h = static_cast<Position>((tick - lastTick[i]) * tickSize);
+      correctBody(bodies, i, h);
+
+      bodies.x[i] = x0[i];
+      bodies.y[i] = y0[i];
+      bodies.z[i] = z0[i];
+      bodies.vx[i] = vx0[i];
+      bodies.vy[i] = vy0[i];
+      bodies.vz[i] = vz0[i];
+      lastTick[i] = tick;
+      levels[i] =
+          static_cast<std::uint8_t>(chooseLevel(i, bodies.radius[i], tick));
+    }
+  });
+}
+
+void BlockTimestepIntegrator::step(BodyStore &bodies, GravitySolver &gravity,
+                                   float deltaTime) {
+  const std::size_t n = bodies.size();
+  if (n == 0)
+    return;
+  if (stepSize != deltaTime || x0.size() != n) {
+    stepSize = deltaTime;
+    initialize(bodies, gravity);
+  }
+
+  const std::uint32_t totalTicks = ticksPerStep(0);
+  const double tickSize = static_cast<double>(deltaTime) / totalTicks;
+  int finestLevel = 0;
+
+  for (;;) {
+    // jump straight to the next tick where any step ends
+    std::uint32_t tick = totalTicks;
+    for (std::size_t i = 0; i < n; ++i)
+      tick = std::min(tick, lastTick[i] + ticksPerStep(levels[i]));
+
+    active.clear();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (lastTick[i] + ticksPerStep(levels[i]) == tick) {
+        active.push_back(static_cast<std::uint32_t>(i));
+        finestLevel = std::max<int>(finestLevel, levels[i]);
+      }
+    }
+
+    predict(bodies, tick, tickSize);
+    evaluate(bodies, gravity, false);
+    correct(bodies, tick, tickSize);
+    forceEvaluations += active.size();
+
+    if (tick == totalTicks)
+      break;
+  }
+
+  std::fill(lastTick.begin(), lastTick.end(), 0);
+  sharedEvaluations += static_cast<std::uint64_t>(n) << finestLevel;
+}
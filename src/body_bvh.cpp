@@ -0,0 +1,263 @@
+#include <body_bvh.h>
+#include <morton.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// bodies per parallel chunk when computing keys
+static const std::size_t keyChunk = 4096;
+// nodes per parallel chunk when refitting
+static const std::size_t refitChunk = 1024;
+// deeper than any tree over 2^32 bodies
+static const int stackSize = 64;
+
+// float bounds that hold the double ones
+static float roundDown(double v) {
+  const float f = static_cast<float>(v);
+  return double(f) > v ? std::nextafter(f, -std::numeric_limits<float>::max())
+                       : f;
+}
+
+static float roundUp(double v) {
+  const float f = static_cast<float>(v);
+  return double(f) < v ? std::nextafter(f, std::numeric_limits<float>::max())
+                       : f;
+}
+
+static BvhNode emptyNode() {
+  const float big = std::numeric_limits<float>::max();
+  return {glm::vec3(big), glm::vec3(-big)};
+}
+
+// distance along the normalized ray to where it enters the sphere, or leaves
+// it when starting inside; negative if it misses
+static double sphereDistance(const double *origin, const double *direction,
+                             double x, double y, double z, double radius) {
+  const double ox = x - origin[0], oy = y - origin[1], oz = z - origin[2];
+  const double b = ox * direction[0] + oy * direction[1] + oz * direction[2];
+  // the miss distance from the offset off the ray, since b^2 - |o|^2 loses
+  // every digit to cancellation far from the origin
+  const double px = ox - b * direction[0], py = oy - b * direction[1],
+               pz = oz - b * direction[2];
+  const double discriminant = radius * radius - (px * px + py * py + pz * pz);
+  if (discriminant < 0.0)
+    return -1.0;
+  const double root = std::sqrt(discriminant);
+  return b - root >= 0.0 ? b - root : b + root;
+}
+
+void BodyBvh::build(const BodyStore &bodies) {
+  const std::size_t n = bodies.size();
+  ++buildCount;
+  order.resize(n);
+  keys.resize(n);
+  nodes.clear();
+  firstLeaf = 0;
+  builtArea = 0.0;
+  if (n == 0)
+    return;
+
+  glm::vec3 low(std::numeric_limits<float>::max());
+  glm::vec3 high(-std::numeric_limits<float>::max());
+  for (std::size_t i = 0; i < n; ++i) {
+    const glm::vec3 p(bodies.x[i], bodies.y[i], bodies.z[i]);
+    if (std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z)) {
+      low = glm::min(low, p);
+      high = glm::max(high, p);
+    }
+  }
+  const glm::vec3 extent = glm::max(high - low, glm::vec3(1e-3f));
+  const float cells = static_cast<float>(1u << 21);
+  const glm::vec3 scale = glm::vec3(cells - 1.0f) / extent;
+  parallelFor(0, n, keyChunk, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      glm::vec3 cell =
+          (glm::vec3(bodies.x[i], bodies.y[i], bodies.z[i]) - low) * scale;
+      // lost bodies go to the far corner
+      if (!(cell.x >= 0.0f && cell.y >= 0.0f && cell.z >= 0.0f))
+        cell = glm::vec3(cells - 1.0f);
+      cell = glm::min(cell, glm::vec3(cells - 1.0f));
+      keys[i] = {mortonKey(static_cast<std::uint64_t>(cell.x),
+                           static_cast<std::uint64_t>(cell.y),
+                           static_cast<std::uint64_t>(cell.z)),
+                 static_cast<std::uint32_t>(i)};
+    }
+  });
+  std::sort(keys.begin(), keys.end());
+  slots.resize(n);
+  bodyBoxes.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    order[i] = keys[i].second;
+    slots[order[i]] = static_cast<std::uint32_t>(i);
+  }
+
+  std::size_t leaves = 1;
+  while (leaves * leafSize < n)
+    leaves *= 2;
+  nodes.resize(2 * leaves - 1);
+  firstLeaf = leaves - 1;
+  refit(bodies);
+  builtArea = totalArea();
+}
+
+void BodyBvh::refit(const BodyStore &bodies) {
+  if (nodes.empty())
+    return;
+  // the bodies are read in store order and their boxes scattered to morton
+  // order, which streams the fields instead of gathering from all of them
+  const std::size_t n = order.size();
+  parallelFor(0, n, keyChunk, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      const double p[3] = {double(bodies.x[i]), double(bodies.y[i]),
+                           double(bodies.z[i])};
+      const double r = bodies.radius[i];
+      BvhNode box = emptyNode();
+      if (std::isfinite(p[0] + p[1] + p[2] + r)) {
+        for (int axis = 0; axis < 3; ++axis) {
+          box.low[axis] = roundDown(p[axis] - r);
+          box.high[axis] = roundUp(p[axis] + r);
+        }
+      }
+      bodyBoxes[slots[i]] = box;
+    }
+  });
+
+  const std::size_t leaves = nodes.size() - firstLeaf;
+  parallelFor(0, leaves, refitChunk, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      BvhNode box = emptyNode();
+      const std::size_t last = std::min(n, (k + 1) * leafSize);
+      for (std::size_t j = k * leafSize; j < last; ++j) {
+        box.low = glm::min(box.low, bodyBoxes[j].low);
+        box.high = glm::max(box.high, bodyBoxes[j].high);
+      }
+      nodes[firstLeaf + k] = box;
+    }
+  });
+
+  // every level of the complete tree starts at 2^d - 1
+  for (std::size_t first = firstLeaf; first > 0;) {
+    const std::size_t parents = (first + 1) / 2;
+    first -= parents;
+    parallelFor(first, first + parents, refitChunk,
+                [&](std::size_t begin, std::size_t end) {
+                  for (std::size_t i = begin; i < end; ++i) {
+                    const BvhNode &a = nodes[2 * i + 1];
+                    const BvhNode &b = nodes[2 * i + 2];
+                    nodes[i] = {glm::min(a.low, b.low),
+                                glm::max(a.high, b.high)};
+                  }
+                });
+  }
+}
+
+void BodyBvh::update(const BodyStore &bodies) {
+  if (bodies.size() != order.size() || nodes.empty()) {
+    build(bodies);
+    return;
+  }
+  refit(bodies);
+  if (totalArea() > rebuildGrowth * builtArea)
+    build(bodies);
+}
+
+double BodyBvh::totalArea() const {
+  double area = 0.0;
+  for (const BvhNode &node : nodes) {
+    const glm::vec3 size = node.high - node.low;
+    if (size.x >= 0.0f && size.y >= 0.0f && size.z >= 0.0f)
+      area += double(size.x) * size.y + double(size.y) * size.z +
+              double(size.z) * size.x;
+  }
+  return area;
+}
+
+bool BodyBvh::closestHit(const BodyStore &bodies, const glm::vec3 &origin,
+                         const glm::vec3 &direction, float maxDistance,
+                         BodyHit &hit) const {
+  return traverse<false>(bodies, origin, direction, maxDistance, hit);
+}
+
+bool BodyBvh::anyHit(const BodyStore &bodies, const glm::vec3 &origin,
+                     const glm::vec3 &direction, float maxDistance) const {
+  BodyHit hit;
+  return traverse<true>(bodies, origin, direction, maxDistance, hit);
+}
+
+template <bool Any>
+bool BodyBvh::traverse(const BodyStore &bodies, const glm::vec3 &origin,
+                       const glm::vec3 &direction, float maxDistance,
+                       BodyHit &hit) const {
+  const float length = glm::length(direction);
+  if (nodes.empty() || !(length > 0.0f))
+    return false;
+  const glm::vec3 unit = direction / length;
+  // zero components would turn the slab test into 0 * inf
+  glm::vec3 inverse;
+  for (int axis = 0; axis < 3; ++axis)
+    inverse[axis] =
+        1.0f / (unit[axis] != 0.0f ? unit[axis]
+                                   : std::numeric_limits<float>::min());
+  const double rayOrigin[3] = {origin.x, origin.y, origin.z};
+  const double rayLength = std::sqrt(double(direction.x) * direction.x +
+                                     double(direction.y) * direction.y +
+                                     double(direction.z) * direction.z);
+  const double rayDirection[3] = {direction.x / rayLength,
+                                  direction.y / rayLength,
+                                  direction.z / rayLength};
+
+  double best = maxDistance;
+  bool found = false;
+  std::uint32_t stack[stackSize];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const std::uint32_t index = stack[--top];
+    const BvhNode &node = nodes[index];
+    // leaves past the last body, and the nodes above only those
+    if (node.low.x > node.high.x)
+      continue;
+    const glm::vec3 a = (node.low - origin) * inverse;
+    const glm::vec3 b = (node.high - origin) * inverse;
+    const glm::vec3 entries = glm::min(a, b), exits = glm::max(a, b);
+    const float enter = std::max(std::max(entries.x, entries.y), entries.z);
+    const float leave = std::min(std::min(exits.x, exits.y), exits.z);
+    if (leave < std::max(enter, 0.0f) || enter > best)
+      continue;
+
+    if (index < firstLeaf) {
+      // the child nearer along the ray goes on top
+      const std::uint32_t left = 2 * index + 1, right = 2 * index + 2;
+      const float leftAlong =
+          glm::dot(nodes[left].low + nodes[left].high, unit);
+      const float rightAlong =
+          glm::dot(nodes[right].low + nodes[right].high, unit);
+      stack[top++] = leftAlong < rightAlong ? right : left;
+      stack[top++] = leftAlong < rightAlong ? left : right;
+      continue;
+    }
+
+    const std::size_t leaf = index - firstLeaf;
+    const std::size_t last = std::min(order.size(), (leaf + 1) * leafSize);
+    for (std::size_t j = leaf * leafSize; j < last; ++j) {
+      const std::uint32_t i = order[j];
+      const double distance =
+          sphereDistance(rayOrigin, rayDirection, bodies.x[i], bodies.y[i],
+                         bodies.z[i], bodies.radius[i]);
+      if (distance < 0.0 || distance > best)
+        continue;
+      if (Any) {
+        hit = {i, static_cast<float>(distance)};
+        return true;
+      }
+      // equal distances go to the lower index, whatever the visiting order
+      if (!found || distance < best || i < hit.body) {
+        hit = {i, static_cast<float>(distance)};
+        best = distance;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
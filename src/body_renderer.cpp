@@ -0,0 +1,100 @@
+#include <body_renderer.h>
+#include <cstddef>
+#include <utility>
+
+// colours told apart at a glance, picked by body index
+static const std::uint8_t palette[][4] = {
+    {255, 214, 120, 255}, {120, 180, 255, 255}, {230, 120, 90, 255},
+    {170, 230, 140, 255}, {210, 160, 240, 255}, {240, 240, 240, 255},
+    {120, 220, 220, 255}, {250, 170, 200, 255}};
+static const std::size_t paletteSize = sizeof(palette) / sizeof(palette[0]);
+
+BodyRenderer::~BodyRenderer() {
+  for (Model &model : models) {
+    for (Part &part : model.parts)
+      glDeleteVertexArrays(1, &part.vertexArray);
+    glDeleteBuffers(1, &model.instanceBuffer);
+  }
+}
+
+std::size_t BodyRenderer::addModel(const std::vector<Mesh> &meshes) {
+  Model model;
+  glGenBuffers(1, &model.instanceBuffer);
+  for (const Mesh &mesh : meshes) {
+    Part part;
+    part.indexCount = static_cast<GLsizei>(mesh.indices.size());
+    glGenVertexArrays(1, &part.vertexArray);
+    glBindVertexArray(part.vertexArray);
+
+    // same layout as the mesh's own vertex array
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
+                          (GLvoid *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
+                          (GLvoid *)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+
+    // one step per instance instead of per vertex
+    glBindBuffer(GL_ARRAY_BUFFER, model.instanceBuffer);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance),
+                          (GLvoid *)offsetof(BodyInstance, positionRadius));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          sizeof(BodyInstance),
+                          (GLvoid *)offsetof(BodyInstance, colour));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+
+    glBindVertexArray(0);
+    model.parts.push_back(part);
+  }
+  models.push_back(std::move(model));
+  return models.size() - 1;
+}
+
+void BodyRenderer::setInstances(std::size_t model,
+                                const PhysicsSnapshot &state) {
+  std::vector<BodyInstance> &instances = models[model].instances;
+  instances.resize(state.bodyCount);
+  // on the render thread alone: waiting on the shared pool could pick up
+  // chunks of the physics thread's force pass and hold the frame
+  for (std::size_t i = 0; i < state.bodyCount; ++i) {
+    BodyInstance &instance = instances[i];
+    instance.positionRadius =
+        glm::vec4(state.x[i], state.y[i], state.z[i], state.radius[i]);
+    const std::uint8_t *colour = palette[i % paletteSize];
+    for (int c = 0; c < 4; ++c)
+      instance.colour[c] = colour[c];
+  }
+}
+
+void BodyRenderer::render(Shader &shader) {
+  drawCount = 0;
+  shader.use();
+
+  for (Model &model : models) {
+    if (model.instances.empty())
+      continue;
+    const std::size_t count = model.instances.size();
+    const GLsizeiptr bytes = count * sizeof(BodyInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, model.instanceBuffer);
+    if (count > model.capacity)
+      model.capacity = count + count / 2;
+    // a fresh store each frame, so the driver need not wait for the draws
+    // still reading last frame's instances
+    glBufferData(GL_ARRAY_BUFFER, model.capacity * sizeof(BodyInstance),
+                 nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, model.instances.data());
+
+    for (const Part &part : model.parts) {
+      glBindVertexArray(part.vertexArray);
+      glDrawElementsInstanced(GL_TRIANGLES, part.indexCount, GL_UNSIGNED_INT,
+                              0, static_cast<GLsizei>(count));
+      ++drawCount;
+    }
+  }
+  glBindVertexArray(0);
+}
@@ -0,0 +1,219 @@
+#include <body_store.h>
+#include <parallel.h>
+#include <algorithm>
+
+template <typename Policy>
+BasicBodyView<Policy>::BasicBodyView(BasicBodyStore<Policy> &store,
+                                     std::size_t index)
+    : store(&store), bodyIndex(index) {}
+
+template <typename Policy>
+glm::vec3 BasicBodyView<Policy>::getPosition() const {
+  return glm::vec3(store->x[bodyIndex], store->y[bodyIndex],
+                   store->z[bodyIndex]);
+}
+
+template <typename Policy>
+glm::vec3 BasicBodyView<Policy>::getVelocity() const {
+  return glm::vec3(store->vx[bodyIndex], store->vy[bodyIndex],
+                   store->vz[bodyIndex]);
+}
+
+template <typename Policy> float BasicBodyView<Policy>::getMass() const {
+  return store->mass[bodyIndex];
+}
+
+template <typename Policy> float BasicBodyView<Policy>::getRadius() const {
+  return store->radius[bodyIndex];
+}
+
+template <typename Policy>
+void BasicBodyView<Policy>::setPosition(const glm::vec3 &position) {
+  store->x[bodyIndex] = position.x;
+  store->y[bodyIndex] = position.y;
+  store->z[bodyIndex] = position.z;
+}
+
+template <typename Policy>
+void BasicBodyView<Policy>::setVelocity(const glm::vec3 &velocity) {
+  store->vx[bodyIndex] = velocity.x;
+  store->vy[bodyIndex] = velocity.y;
+  store->vz[bodyIndex] = velocity.z;
+}
+
+template <typename Policy>
+void BasicBodyView<Policy>::updateBody(float deltaTime,
+                                       const glm::vec3 &force) {
+  CelestialBody body = toBody();
+  body.updateBody(deltaTime, force);
+  setPosition(body.position);
+  setVelocity(body.velocity);
+}
+
+template <typename Policy>
+glm::vec3 BasicBodyView<Policy>::calculateGravitationalForce(
+    const CelestialBody &other) const {
+  return toBody().calculateGravitationalForce(other);
+}
+
+template <typename Policy>
+float BasicBodyView<Policy>::getDistanceTo(const CelestialBody &other) const {
+  return toBody().getDistanceTo(other);
+}
+
+template <typename Policy>
+CelestialBody BasicBodyView<Policy>::toBody() const {
+  return store->get(bodyIndex);
+}
+
+template <typename Policy>
+BasicBodyView<Policy> &
+BasicBodyView<Policy>::operator=(const CelestialBody &body) {
+  store->set(bodyIndex, body);
+  return *this;
+}
+
+template <typename Policy>
+BasicBodyStore<Policy>::BasicBodyStore(
+    const std::vector<CelestialBody> &bodies) {
+  reserve(bodies.size());
+  for (const CelestialBody &body : bodies)
+    add(body);
+}
+
+template <typename Policy>
+std::size_t BasicBodyStore<Policy>::paddedCount(std::size_t n) {
+  return (n + laneWidth - 1) / laneWidth * laneWidth;
+}
+
+template <typename Policy>
+template <typename Visit>
+void BasicBodyStore<Policy>::forEachField(Visit visit) {
+  visit(x);
+  visit(y);
+  visit(z);
+  visit(vx);
+  visit(vy);
+  visit(vz);
+  visit(mass);
+  visit(radius);
+  visit(ax);
+  visit(ay);
+  visit(az);
+  visit(id);
+}
+
+template <typename Policy>
+void BasicBodyStore<Policy>::reserve(std::size_t capacity) {
+  std::size_t padded = paddedCount(capacity);
+  forEachField([&](auto &field) { field.reserve(padded); });
+}
+
+template <typename Policy>
+void BasicBodyStore<Policy>::resize(std::size_t newCount) {
+  std::size_t padded = paddedCount(newCount);
+  forEachField([&](auto &field) {
+    field.resize(padded, 0);
+    // slots past the last body must stay massless so kernels can read them
+    for (std::size_t i = newCount; i < padded; ++i)
+      field[i] = 0;
+  });
+  // bodies past the old count are new ones
+  for (std::size_t i = count; i < newCount; ++i)
+    id[i] = nextId++;
+  count = newCount;
+}
+
+template <typename Policy> void BasicBodyStore<Policy>::clear() {
+  resize(0);
+}
+
+template <typename Policy>
+void BasicBodyStore<Policy>::remove(
+    const std::vector<std::uint32_t> &indices) {
+  if (indices.empty())
+    return;
+  forEachField([&](auto &field) {
+    // bodies between two removed ones move down by the removals so far
+    std::size_t target = indices[0];
+    for (std::size_t k = 0; k < indices.size(); ++k) {
+      const std::size_t begin = indices[k] + 1;
+      const std::size_t end = k + 1 < indices.size() ? indices[k + 1] : count;
+      std::copy(field.begin() + begin, field.begin() + end,
+                field.begin() + target);
+      target += end - begin;
+    }
+  });
+  resize(count - indices.size());
+}
+
+template <typename Policy>
+std::size_t BasicBodyStore<Policy>::add(const CelestialBody &body) {
+  std::size_t index = count;
+  resize(count + 1);
+  set(index, body);
+  return index;
+}
+
+template <typename Policy>
+CelestialBody BasicBodyStore<Policy>::get(std::size_t index) const {
+  return CelestialBody(radius[index], mass[index],
+                       glm::vec3(x[index], y[index], z[index]),
+                       glm::vec3(vx[index], vy[index], vz[index]));
+}
+
+template <typename Policy>
+void BasicBodyStore<Policy>::set(std::size_t index,
+                                 const CelestialBody &body) {
+  x[index] = body.position.x;
+  y[index] = body.position.y;
+  z[index] = body.position.z;
+  vx[index] = body.velocity.x;
+  vy[index] = body.velocity.y;
+  vz[index] = body.velocity.z;
+  mass[index] = body.mass;
+  radius[index] = body.radius;
+}
+
+template <typename Policy>
+std::vector<CelestialBody> BasicBodyStore<Policy>::toBodies() const {
+  std::vector<CelestialBody> bodies;
+  bodies.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+    bodies.push_back(get(i));
+  return bodies;
+}
+
+template <typename Policy>
+BasicBodyArrays<Policy> BasicBodyStore<Policy>::arrays() const {
+  return {x.data(), y.data(), z.data(), mass.data(), radius.data(), count};
+}
+
+template <typename Policy>
+void BasicBodyStore<Policy>::updateBodies(float deltaTime,
+                                          const Accumulator *forceX,
+                                          const Accumulator *forceY,
+                                          const Accumulator *forceZ) {
+  Position *px = x.data(), *py = y.data(), *pz = z.data();
+  Position *qx = vx.data(), *qy = vy.data(), *qz = vz.data();
+  const Pair *m = mass.data();
+  const Position dt = deltaTime;
+
+  parallelFor(0, count, 4096, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      qx[i] += forceX[i] / m[i] * dt;
+      qy[i] += forceY[i] / m[i] * dt;
+      qz[i] += forceZ[i] / m[i] * dt;
+      px[i] += qx[i] * dt;
+      py[i] += qy[i] * dt;
+      pz[i] += qz[i] * dt;
+    }
+  });
+}
+
+template class BasicBodyView<FloatPrecision>;
+template class BasicBodyView<DoublePrecision>;
+template class BasicBodyView<MixedPrecision>;
+template class BasicBodyStore<FloatPrecision>;
+template class BasicBodyStore<DoublePrecision>;
+template class BasicBodyStore<MixedPrecision>;
@@ -0,0 +1,340 @@
+#include <broadphase.h>
+#include <morton.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// cells along each axis, the most a morton key holds
+static const std::uint64_t axisCells = std::uint64_t(1) << 21;
+// bodies per parallel chunk when computing keys
+static const std::size_t keyChunk = 4096;
+// cells per parallel chunk when looking for pairs
+static const std::size_t cellChunk = 256;
+static const std::uint64_t emptySlot = ~std::uint64_t(0);
+
+// the 13 neighbours after a cell; with the cell itself every pair of
+// neighbouring cells is visited once
+static const int forwardNeighbours[13][3] = {
+    {1, 0, 0},  {-1, 1, 0}, {0, 1, 0},  {1, 1, 0},   {-1, -1, 1},
+    {0, -1, 1}, {1, -1, 1}, {-1, 0, 1}, {0, 0, 1},   {1, 0, 1},
+    {-1, 1, 1}, {0, 1, 1},  {1, 1, 1}};
+
+static std::size_t hashSlot(std::uint64_t key, std::size_t mask) {
+  return static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+}
+
+static void testPair(double ax, double ay, double az, double ar,
+                     std::uint32_t a, double bx, double by, double bz,
+                     double br, std::uint32_t b, std::vector<BodyPair> &out) {
+  const double dx = bx - ax, dy = by - ay, dz = bz - az;
+  const double reach = ar + br;
+  if (dx * dx + dy * dy + dz * dz < reach * reach)
+    out.push_back(a < b ? BodyPair{a, b} : BodyPair{b, a});
+}
+
+void Broadphase::findOverlaps(const BodyArrays &bodies,
+                              std::vector<BodyPair> &pairs) {
+  const std::size_t n = bodies.count;
+  pairs.clear();
+  entries.clear();
+  spheres.clear();
+  cells.clear();
+  large.clear();
+  testCount = 0;
+  if (n < 2)
+    return;
+
+  // the cell size follows the ordinary bodies, anything much larger than
+  // the 99th percentile is handled on its own
+  std::vector<BodyStore::Pair> radii(bodies.radius, bodies.radius + n);
+  std::nth_element(radii.begin(), radii.begin() + n * 99 / 100, radii.end());
+  const double typical = radii[n * 99 / 100];
+  const double limit = typical > 0.0
+                           ? largeRadius * typical
+                           : std::numeric_limits<double>::infinity();
+
+  double low[3], high[3], largest = 0.0;
+  for (int axis = 0; axis < 3; ++axis) {
+    low[axis] = std::numeric_limits<double>::infinity();
+    high[axis] = -low[axis];
+  }
+  std::vector<std::uint32_t> members;
+  members.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double p[3] = {double(bodies.x[i]), double(bodies.y[i]),
+                         double(bodies.z[i])};
+    const double r = bodies.radius[i];
+    // lost bodies touch nothing
+    if (!std::isfinite(p[0]) || !std::isfinite(p[1]) ||
+        !std::isfinite(p[2]) || !std::isfinite(r))
+      continue;
+    if (r > limit) {
+      large.push_back(static_cast<std::uint32_t>(i));
+      continue;
+    }
+    members.push_back(static_cast<std::uint32_t>(i));
+    largest = std::max(largest, r);
+    for (int axis = 0; axis < 3; ++axis) {
+      low[axis] = std::min(low[axis], p[axis]);
+      high[axis] = std::max(high[axis], p[axis]);
+    }
+  }
+
+  // two bodies of at most half a cell in radius touch only within
+  // neighbouring cells; the grid has to fit the 21 bits of a key, though
+  double extent = 0.0;
+  for (int axis = 0; axis < 3; ++axis) {
+    origin[axis] = members.empty() ? 0.0 : low[axis];
+    if (!members.empty())
+      extent = std::max(extent, high[axis] - low[axis]);
+  }
+  cellSize = std::max(2.0 * largest, extent / double(axisCells - 2));
+  if (!(cellSize > 0.0))
+    cellSize = 1.0;
+
+  entries.resize(members.size());
+  parallelFor(0, members.size(), keyChunk,
+              [&](std::size_t begin, std::size_t end) {
+                const double inverse = 1.0 / cellSize;
+                for (std::size_t k = begin; k < end; ++k) {
+                  const std::uint32_t i = members[k];
+                  std::uint64_t cell[3];
+                  const double p[3] = {double(bodies.x[i]),
+                                       double(bodies.y[i]),
+                                       double(bodies.z[i])};
+                  for (int axis = 0; axis < 3; ++axis)
+                    cell[axis] = static_cast<std::uint64_t>(
+                        (p[axis] - origin[axis]) * inverse);
+                  entries[k] = {mortonKey(cell[0], cell[1], cell[2]), i};
+                }
+              });
+  sortEntries();
+
+  spheres.resize(entries.size());
+  parallelFor(0, entries.size(), keyChunk,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t k = begin; k < end; ++k) {
+                  const std::uint32_t i = entries[k].body;
+                  spheres[k] = {double(bodies.x[i]), double(bodies.y[i]),
+                                double(bodies.z[i]),
+                                double(bodies.radius[i])};
+                }
+              });
+  buildCells();
+
+  const std::size_t cellChunks = (cells.size() + cellChunk - 1) / cellChunk;
+  found.resize(cellChunks + large.size());
+  std::vector<std::size_t> tests(found.size(), 0);
+  parallelFor(0, found.size(), 1, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t chunk = begin; chunk < end; ++chunk) {
+      found[chunk].clear();
+      if (chunk < cellChunks) {
+        const std::size_t first = chunk * cellChunk;
+        const std::size_t last = std::min(cells.size(), first + cellChunk);
+        std::int64_t neighbours[cellChunk * 13];
+        findNeighbours(first, last, neighbours);
+        for (std::size_t c = first; c < last; ++c)
+          testCell(cells[c], neighbours + 13 * (c - first), found[chunk],
+                   tests[chunk]);
+      } else {
+        testLarge(bodies, chunk - cellChunks, found[chunk], tests[chunk]);
+      }
+    }
+  });
+
+  std::size_t total = 0;
+  for (std::size_t chunk = 0; chunk < found.size(); ++chunk) {
+    total += found[chunk].size();
+    testCount += tests[chunk];
+  }
+  pairs.reserve(total);
+  for (const std::vector<BodyPair> &part : found)
+    pairs.insert(pairs.end(), part.begin(), part.end());
+}
+
+// least significant byte first, skipping bytes that are the same in every
+// key; stable, so each cell keeps its bodies in index order
+void Broadphase::sortEntries() {
+  if (entries.empty())
+    return;
+  std::uint64_t differing = 0;
+  for (const Entry &entry : entries)
+    differing |= entry.key ^ entries[0].key;
+  scratch.resize(entries.size());
+  for (unsigned shift = 0; shift < 64 && (differing >> shift); shift += 8) {
+    if (((differing >> shift) & 0xff) == 0)
+      continue;
+    std::size_t offsets[256] = {};
+    for (const Entry &entry : entries)
+      ++offsets[(entry.key >> shift) & 0xff];
+    std::size_t sum = 0;
+    for (std::size_t &offset : offsets) {
+      const std::size_t count = offset;
+      offset = sum;
+      sum += count;
+    }
+    for (const Entry &entry : entries)
+      scratch[offsets[(entry.key >> shift) & 0xff]++] = entry;
+    entries.swap(scratch);
+  }
+}
+
+void Broadphase::buildCells() {
+  const double inverse = 1.0 / cellSize;
+  for (std::size_t k = 0; k < entries.size(); ++k) {
+    if (k > 0 && entries[k].key == entries[k - 1].key) {
+      ++cells.back().end;
+      continue;
+    }
+    const Sphere &sphere = spheres[k];
+    Cell cell;
+    cell.x = static_cast<std::uint32_t>((sphere.x - origin[0]) * inverse);
+    cell.y = static_cast<std::uint32_t>((sphere.y - origin[1]) * inverse);
+    cell.z = static_cast<std::uint32_t>((sphere.z - origin[2]) * inverse);
+    cell.begin = static_cast<std::uint32_t>(k);
+    cell.end = cell.begin + 1;
+    cells.push_back(cell);
+  }
+
+  std::size_t size = 16;
+  while (size < 2 * cells.size())
+    size *= 2;
+  slots.assign(size, Slot{emptySlot, 0});
+  for (std::size_t c = 0; c < cells.size(); ++c) {
+    const std::uint64_t key = entries[cells[c].begin].key;
+    std::size_t slot = hashSlot(key, size - 1);
+    while (slots[slot].key != emptySlot)
+      slot = (slot + 1) & (size - 1);
+    slots[slot] = Slot{key, c};
+  }
+}
+
+std::int64_t Broadphase::findCell(std::uint64_t key) const {
+  const std::size_t mask = slots.size() - 1;
+  for (std::size_t slot = hashSlot(key, mask);; slot = (slot + 1) & mask) {
+    if (slots[slot].key == key)
+      return static_cast<std::int64_t>(slots[slot].cell);
+    if (slots[slot].key == emptySlot)
+      return -1;
+  }
+}
+
+// the forward neighbours of cells first to last, 13 per cell and -1 where
+// there is none. the keys come first and the lookups after, independent of
+// each other, so their cache misses overlap instead of queueing up behind
+// the pair tests.
+void Broadphase::findNeighbours(std::size_t first, std::size_t last,
+                                std::int64_t *neighbours) const {
+  std::int64_t *out = neighbours;
+  for (std::size_t c = first; c < last; ++c) {
+    const Cell &cell = cells[c];
+    for (const int *offset : forwardNeighbours) {
+      const std::int64_t x = std::int64_t(cell.x) + offset[0];
+      const std::int64_t y = std::int64_t(cell.y) + offset[1];
+      const std::int64_t z = std::int64_t(cell.z) + offset[2];
+      const bool inside = x >= 0 && y >= 0 && z >= 0 &&
+                          x < std::int64_t(axisCells) &&
+                          y < std::int64_t(axisCells) &&
+                          z < std::int64_t(axisCells);
+      *out++ = inside ? static_cast<std::int64_t>(mortonKey(
+                            std::uint64_t(x), std::uint64_t(y),
+                            std::uint64_t(z)))
+                      : -1;
+    }
+  }
+  for (std::int64_t *key = neighbours; key != out; ++key)
+    if (*key >= 0)
+      *key = findCell(static_cast<std::uint64_t>(*key));
+}
+
+void Broadphase::testCell(const Cell &cell, const std::int64_t *neighbours,
+                          std::vector<BodyPair> &out,
+                          std::size_t &tests) const {
+  for (std::uint32_t a = cell.begin; a < cell.end; ++a) {
+    const Sphere &s = spheres[a];
+    for (std::uint32_t b = a + 1; b < cell.end; ++b) {
+      const Sphere &t = spheres[b];
+      testPair(s.x, s.y, s.z, s.radius, entries[a].body, t.x, t.y, t.z,
+               t.radius, entries[b].body, out);
+    }
+  }
+  tests += std::size_t(cell.end - cell.begin) * (cell.end - cell.begin - 1) / 2;
+
+  for (int k = 0; k < 13; ++k) {
+    if (neighbours[k] < 0)
+      continue;
+    const Cell &other = cells[static_cast<std::size_t>(neighbours[k])];
+    for (std::uint32_t a = cell.begin; a < cell.end; ++a) {
+      const Sphere &s = spheres[a];
+      for (std::uint32_t b = other.begin; b < other.end; ++b) {
+        const Sphere &t = spheres[b];
+        testPair(s.x, s.y, s.z, s.radius, entries[a].body, t.x, t.y, t.z,
+                 t.radius, entries[b].body, out);
+      }
+    }
+    tests += std::size_t(cell.end - cell.begin) * (other.end - other.begin);
+  }
+}
+
+// a large body against the cells its sphere reaches and the large bodies
+// after it
+void Broadphase::testLarge(const BodyArrays &bodies, std::size_t index,
+                           std::vector<BodyPair> &out,
+                           std::size_t &tests) const {
+  const std::uint32_t body = large[index];
+  const double p[3] = {double(bodies.x[body]), double(bodies.y[body]),
+                       double(bodies.z[body])};
+  const double r = bodies.radius[body];
+
+  for (std::size_t k = index + 1; k < large.size(); ++k) {
+    const std::uint32_t other = large[k];
+    testPair(p[0], p[1], p[2], r, body, bodies.x[other], bodies.y[other],
+             bodies.z[other], bodies.radius[other], other, out);
+  }
+  tests += large.size() - index - 1;
+  if (cells.empty())
+    return;
+
+  // ordinary bodies reach at most half a cell beyond their own
+  const double reach = r + cellSize / 2;
+  std::int64_t first[3], last[3];
+  double boxCells = 1.0;
+  for (int axis = 0; axis < 3; ++axis) {
+    const double from = std::floor((p[axis] - reach - origin[axis]) / cellSize);
+    const double to = std::floor((p[axis] + reach - origin[axis]) / cellSize);
+    first[axis] = static_cast<std::int64_t>(std::max(from, 0.0));
+    last[axis] = static_cast<std::int64_t>(
+        std::min(to, double(axisCells - 1)));
+    if (first[axis] > last[axis])
+      return;
+    boxCells *= double(last[axis] - first[axis] + 1);
+  }
+
+  auto testBodies = [&](const Cell &cell) {
+    for (std::uint32_t b = cell.begin; b < cell.end; ++b) {
+      const Sphere &t = spheres[b];
+      testPair(p[0], p[1], p[2], r, body, t.x, t.y, t.z, t.radius,
+               entries[b].body, out);
+    }
+    tests += cell.end - cell.begin;
+  };
+
+  // a sphere reaching over more cells than there are occupied ones walks the
+  // occupied ones instead
+  if (boxCells > double(cells.size())) {
+    for (const Cell &cell : cells)
+      if (cell.x >= first[0] && cell.x <= last[0] && cell.y >= first[1] &&
+          cell.y <= last[1] && cell.z >= first[2] && cell.z <= last[2])
+        testBodies(cell);
+    return;
+  }
+  for (std::int64_t z = first[2]; z <= last[2]; ++z)
+    for (std::int64_t y = first[1]; y <= last[1]; ++y)
+      for (std::int64_t x = first[0]; x <= last[0]; ++x) {
+        const std::int64_t cell = findCell(mortonKey(
+            std::uint64_t(x), std::uint64_t(y), std::uint64_t(z)));
+        if (cell >= 0)
+          testBodies(cells[static_cast<std::size_t>(cell)]);
+      }
+}
@@ -0,0 +1,285 @@
+#include <catalog.h>
+#include <mapped_file.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// the fields of a body in the order of a catalog without header
+enum CatalogField {
+  CatalogMass,
+  CatalogRadius,
+  CatalogX,
+  CatalogY,
+  CatalogZ,
+  CatalogVx,
+  CatalogVy,
+  CatalogVz,
+  CatalogFieldCount
+};
+
+static const char *const catalogFieldNames[CatalogFieldCount] = {
+    "mass", "radius", "x", "y", "z", "vx", "vy", "vz"};
+
+// bytes per chunk, enough lines to keep a thread busy for a while
+static const std::size_t chunkBytes = std::size_t(1) << 20;
+
+struct CatalogFormat {
+  bool commas = true;
+  // the field every column goes to, -1 for skipped columns
+  std::vector<int> columns;
+};
+
+// one piece of the file, cut at line boundaries
+struct CatalogChunk {
+  const char *begin;
+  const char *end;
+  std::size_t lines = 0;
+  std::size_t rows = 0;
+  // line number and body index of the first line
+  std::size_t firstLine = 0;
+  std::size_t firstRow = 0;
+  // first error in the chunk, line 0 for none
+  std::size_t errorLine = 0;
+  const char *errorMessage = nullptr;
+};
+
+static const char *lineEnd(const char *p, const char *end) {
+  const void *newline = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+  return newline ? static_cast<const char *>(newline) : end;
+}
+
+static const char *skipBlanks(const char *p, const char *end) {
+  while (p != end && (*p == ' ' || *p == '\t'))
+    ++p;
+  return p;
+}
+
+// the line without its line break, or p == end for blank and comment lines
+static const char *trimLine(const char *&p, const char *end) {
+  if (end != p && end[-1] == '\r')
+    --end;
+  p = skipBlanks(p, end);
+  return p == end || *p == '#' ? p : end;
+}
+
+static const char *skipField(const char *p, const char *end, bool commas) {
+  if (p != end && *p == '"') {
+    const void *quote =
+        std::memchr(p + 1, '"', static_cast<std::size_t>(end - p - 1));
+    p = quote ? static_cast<const char *>(quote) + 1 : end;
+  }
+  while (p != end && (commas ? *p != ',' : *p != ' ' && *p != '\t'))
+    ++p;
+  return p;
+}
+
+static bool parseRow(const char *p, const char *end,
+                     const CatalogFormat &format, double *values,
+                     const char *&message) {
+  for (int field = 0; field < CatalogFieldCount; ++field)
+    values[field] = 0.0;
+  for (std::size_t column = 0; column < format.columns.size(); ++column) {
+    p = skipBlanks(p, end);
+    if (column > 0 && (p == end || (format.commas && *p != ','))) {
+      message = "too few fields";
+      return false;
+    }
+    if (column > 0 && format.commas)
+      p = skipBlanks(p + 1, end);
+
+    const int field = format.columns[column];
+    if (field < 0) {
+      p = skipField(p, end, format.commas);
+      continue;
+    }
+    // from_chars takes no plus sign
+    if (p != end && *p == '+')
+      ++p;
+    std::from_chars_result result = std::from_chars(p, end, values[field]);
+    if (result.ec != std::errc() || !std::isfinite(values[field]) ||
+        (result.ptr != end && *result.ptr != ',' && *result.ptr != ' ' &&
+         *result.ptr != '\t')) {
+      message = "bad number";
+      return false;
+    }
+    p = result.ptr;
+  }
+  if (skipBlanks(p, end) != end) {
+    message = "too many fields";
+    return false;
+  }
+  return true;
+}
+
+static bool parseHeader(const char *p, const char *end, CatalogFormat &format,
+                        std::string &error) {
+  format.commas = std::memchr(p, ',', static_cast<std::size_t>(end - p));
+  bool seen[CatalogFieldCount] = {};
+  while (p != end) {
+    // blanks after the last name are not another column
+    p = skipBlanks(p, end);
+    if (p == end)
+      break;
+    const char *nameEnd = skipField(p, end, format.commas);
+    std::string name(p, nameEnd);
+    while (!name.empty() && (name.back() == ' ' || name.back() == '\t'))
+      name.pop_back();
+    if (name.size() >= 2 && name.front() == '"' && name.back() == '"')
+      name = name.substr(1, name.size() - 2);
+    for (char &c : name)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    int column = name == "m" ? CatalogMass : name == "r" ? CatalogRadius : -1;
+    for (int field = 0; field < CatalogFieldCount; ++field)
+      if (name == catalogFieldNames[field])
+        column = field;
+    if (column >= 0 && seen[column]) {
+      error = "column '" + name + "' appears twice";
+      return false;
+    }
+    if (column >= 0)
+      seen[column] = true;
+    format.columns.push_back(column);
+
+    p = nameEnd;
+    if (p != end && format.commas)
+      ++p;
+  }
+  for (int field : {CatalogMass, CatalogX, CatalogY, CatalogZ}) {
+    if (!seen[field]) {
+      error = std::string("no '") + catalogFieldNames[field] + "' column";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool loadCatalog(const std::string &path, BodyStore &bodies,
+                 std::string &error) {
+  MappedFile file;
+  if (!file.open(path, MappedFileAccess::Sequential, error))
+    return false;
+  // an empty file is an empty catalog
+  if (file.size() == 0)
+    return true;
+  const char *begin = reinterpret_cast<const char *>(file.data());
+  const char *end = begin + file.size();
+
+  // the first line that is not blank decides between header and data
+  CatalogFormat format;
+  std::size_t firstLine = 1;
+  const char *body = begin;
+  while (body != end) {
+    const char *next = lineEnd(body, end);
+    const char *text = body;
+    const char *textEnd = trimLine(text, next);
+    if (text != textEnd) {
+      const char c = *text;
+      if (std::isalpha(static_cast<unsigned char>(c)) || c == '"') {
+        if (!parseHeader(text, textEnd, format, error)) {
+          error = path + ":" + std::to_string(firstLine) + ": " + error;
+          return false;
+        }
+        body = next == end ? end : next + 1;
+        ++firstLine;
+      } else {
+        format.commas =
+            std::memchr(text, ',', static_cast<std::size_t>(textEnd - text));
+        for (int field = 0; field < CatalogFieldCount; ++field)
+          format.columns.push_back(field);
+      }
+      break;
+    }
+    body = next == end ? end : next + 1;
+    ++firstLine;
+  }
+
+  // chunks end just after a line break, the last one at the end of the file
+  const std::size_t bytes = static_cast<std::size_t>(end - body);
+  const std::size_t chunkCount = std::max<std::size_t>(
+      1, (bytes + chunkBytes - 1) / chunkBytes);
+  std::vector<CatalogChunk> chunks(chunkCount);
+  const char *cut = body;
+  for (std::size_t i = 0; i < chunkCount; ++i) {
+    chunks[i].begin = cut;
+    if (i + 1 < chunkCount) {
+      const char *target = body + bytes / chunkCount * (i + 1);
+      cut = std::max(cut, target);
+      cut = cut == end ? end : lineEnd(cut, end);
+      cut = cut == end ? end : cut + 1;
+    } else {
+      cut = end;
+    }
+    chunks[i].end = cut;
+  }
+
+  // counting the bodies of every chunk tells each where its bodies go
+  parallelFor(0, chunkCount, 1, [&](std::size_t first, std::size_t last) {
+    for (std::size_t i = first; i < last; ++i) {
+      CatalogChunk &chunk = chunks[i];
+      for (const char *p = chunk.begin; p != chunk.end;) {
+        const char *next = lineEnd(p, chunk.end);
+        const char *text = p;
+        if (trimLine(text, next) != text)
+          ++chunk.rows;
+        ++chunk.lines;
+        p = next == chunk.end ? next : next + 1;
+      }
+    }
+  });
+  std::size_t rows = 0;
+  for (CatalogChunk &chunk : chunks) {
+    chunk.firstLine = firstLine;
+    chunk.firstRow = rows;
+    firstLine += chunk.lines;
+    rows += chunk.rows;
+  }
+
+  const std::size_t base = bodies.size();
+  bodies.resize(base + rows);
+  parallelFor(0, chunkCount, 1, [&](std::size_t first, std::size_t last) {
+    double values[CatalogFieldCount];
+    for (std::size_t i = first; i < last; ++i) {
+      CatalogChunk &chunk = chunks[i];
+      std::size_t line = chunk.firstLine;
+      std::size_t row = base + chunk.firstRow;
+      for (const char *p = chunk.begin; p != chunk.end; ++line) {
+        const char *next = lineEnd(p, chunk.end);
+        const char *text = p;
+        const char *textEnd = trimLine(text, next);
+        p = next == chunk.end ? next : next + 1;
+        if (text == textEnd)
+          continue;
+        if (!parseRow(text, textEnd, format, values, chunk.errorMessage)) {
+          chunk.errorLine = line;
+          break;
+        }
+        bodies.mass[row] = static_cast<BodyStore::Pair>(values[CatalogMass]);
+        bodies.radius[row] =
+            static_cast<BodyStore::Pair>(values[CatalogRadius]);
+        bodies.x[row] = static_cast<BodyStore::Position>(values[CatalogX]);
+        bodies.y[row] = static_cast<BodyStore::Position>(values[CatalogY]);
+        bodies.z[row] = static_cast<BodyStore::Position>(values[CatalogZ]);
+        bodies.vx[row] = static_cast<BodyStore::Position>(values[CatalogVx]);
+        bodies.vy[row] = static_cast<BodyStore::Position>(values[CatalogVy]);
+        bodies.vz[row] = static_cast<BodyStore::Position>(values[CatalogVz]);
+        ++row;
+      }
+    }
+  });
+
+  // chunks are in file order, so the first failed one has the first error
+  for (const CatalogChunk &chunk : chunks) {
+    if (chunk.errorLine) {
+      error = path + ":" + std::to_string(chunk.errorLine) + ": " +
+              chunk.errorMessage;
+      bodies.resize(base);
+      return false;
+    }
+  }
+  return true;
+}
@@ -1,4 +1,5 @@
 #include <celestial_body.h>
+#include <globals.h>
 
 CelestialBody::CelestialBody(float r, float m, glm::vec3 pos, glm::vec3 vel)
     : radius(r), mass(m), position(pos), velocity(vel) {}
@@ -26,7 +27,7 @@ CelestialBody::calculateGravitationalForce(const CelestialBody &other) {
   if (distanceSquared == 0.0f)
     return glm::vec3(0.0f);
 
-  float forceMagnitude = (0.1f) * (mass * other.mass) / distanceSquared;
+  float forceMagnitude = gravityScale * (mass * other.mass) / distanceSquared;
   return glm::normalize(direction) *
          forceMagnitude; // normalize direction and multiply by force magnitude
 }
@@ -0,0 +1,433 @@
+#include <checkpoint.h>
+#include <parallel.h>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const char checkpointMagic[8] = {'S', 'O', 'L', 'S', 'I', 'M', 'C', 'P'};
+static const std::uint32_t byteOrderMark = 0x01020304;
+static const std::size_t maxSections = 48;
+static const std::size_t maxValueSize = 16;
+// bytes per memcpy chunk when restoring on several threads
+static const std::size_t copyChunk = std::size_t(1) << 20;
+
+// one entry of the section table. arrays live at offset, values are small
+// enough to sit in the table itself.
+struct CheckpointSection {
+  char name[32];
+  std::uint64_t offset;
+  std::uint64_t count;
+  std::uint32_t elementSize;
+  std::uint32_t isValue;
+  unsigned char value[maxValueSize];
+};
+
+struct CheckpointHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint32_t sectionCount;
+  // BodyStore::getNextId of the saved store
+  std::uint32_t nextBodyId;
+  std::uint64_t fileSize;
+  std::uint64_t bodyCount;
+  std::uint64_t steps;
+  double time;
+  char precision[16];
+  char integrator[32];
+  CheckpointSection sections[maxSections];
+};
+
+static_assert(sizeof(CheckpointHeader) <= Checkpoint::pageSize,
+              "the checkpoint header has to fit its page");
+
+static std::size_t roundToPage(std::size_t bytes) {
+  return (bytes + Checkpoint::pageSize - 1) / Checkpoint::pageSize *
+         Checkpoint::pageSize;
+}
+
+// calls visit(name, array) for every field of a body store
+template <typename Store, typename Visit>
+static void forEachBodyField(Store &bodies, Visit visit) {
+  visit("bodies.x", bodies.x);
+  visit("bodies.y", bodies.y);
+  visit("bodies.z", bodies.z);
+  visit("bodies.vx", bodies.vx);
+  visit("bodies.vy", bodies.vy);
+  visit("bodies.vz", bodies.vz);
+  visit("bodies.mass", bodies.mass);
+  visit("bodies.radius", bodies.radius);
+  visit("bodies.ax", bodies.ax);
+  visit("bodies.ay", bodies.ay);
+  visit("bodies.az", bodies.az);
+  visit("bodies.id", bodies.id);
+}
+
+static void copyParallel(void *to, const void *from, std::size_t bytes) {
+  parallelFor(0, bytes, copyChunk, [&](std::size_t begin, std::size_t end) {
+    std::memcpy(static_cast<unsigned char *>(to) + begin,
+                static_cast<const unsigned char *>(from) + begin,
+                end - begin);
+  });
+}
+
+// fills the section table and collects the arrays to write after it
+class CheckpointWriter : public IntegratorStateVisitor {
+public:
+  CheckpointHeader &header;
+  std::vector<std::pair<const void *, std::size_t>> arrays;
+  std::size_t offset = Checkpoint::pageSize;
+  std::string error;
+
+  explicit CheckpointWriter(CheckpointHeader &header) : header(header) {}
+
+  CheckpointSection *add(const std::string &name) {
+    if (!error.empty())
+      return nullptr;
+    if (header.sectionCount == maxSections) {
+      error = "too many sections";
+      return nullptr;
+    }
+    if (name.size() >= sizeof(CheckpointSection::name)) {
+      error = "section name '" + name + "' is too long";
+      return nullptr;
+    }
+    CheckpointSection &section = header.sections[header.sectionCount++];
+    std::memcpy(section.name, name.c_str(), name.size() + 1);
+    return &section;
+  }
+
+  void addArray(const std::string &name, const void *data,
+                std::size_t elementSize, std::size_t count) {
+    CheckpointSection *section = add(name);
+    if (!section)
+      return;
+    section->offset = offset;
+    section->count = count;
+    section->elementSize = static_cast<std::uint32_t>(elementSize);
+    arrays.emplace_back(data, elementSize * count);
+    offset += roundToPage(elementSize * count);
+  }
+
+  void value(const char *name, void *data, std::size_t size) override {
+    if (size > maxValueSize) {
+      error = std::string("value '") + name + "' is too large";
+      return;
+    }
+    CheckpointSection *section = add(std::string("integrator.") + name);
+    if (!section)
+      return;
+    section->count = 1;
+    section->elementSize = static_cast<std::uint32_t>(size);
+    section->isValue = 1;
+    std::memcpy(section->value, data, size);
+  }
+
+  void array(const char *name, void *data, std::size_t elementSize,
+             std::size_t count,
+             const std::function<void *(std::size_t)> &) override {
+    addArray(std::string("integrator.") + name, data, elementSize, count);
+  }
+};
+
+// checks the integrator state in a checkpoint against an integrator, and
+// copies it over when apply is set
+class CheckpointReader : public IntegratorStateVisitor {
+public:
+  const std::function<const CheckpointSection *(const std::string &)> find;
+  const unsigned char *data;
+  bool apply = false;
+  std::string error;
+
+  CheckpointReader(
+      std::function<const CheckpointSection *(const std::string &)> find,
+      const unsigned char *data)
+      : find(std::move(find)), data(data) {}
+
+  const CheckpointSection *get(const char *name, std::size_t elementSize,
+                               bool isValue) {
+    const CheckpointSection *section =
+        find(std::string("integrator.") + name);
+    if (!error.empty())
+      return nullptr;
+    if (!section || section->elementSize != elementSize ||
+        section->isValue != (isValue ? 1u : 0u)) {
+      error = std::string("integrator state '") + name +
+              "' is missing or of another type";
+      return nullptr;
+    }
+    return section;
+  }
+
+  void value(const char *name, void *target, std::size_t size) override {
+    const CheckpointSection *section = get(name, size, true);
+    if (section && apply)
+      std::memcpy(target, section->value, size);
+  }
+
+  void array(const char *name, void *, std::size_t elementSize,
+             std::size_t,
+             const std::function<void *(std::size_t)> &resize) override {
+    const CheckpointSection *section = get(name, elementSize, false);
+    if (!section || !apply)
+      return;
+    void *target = resize(section->count);
+    copyParallel(target, data + section->offset,
+                 section->count * elementSize);
+  }
+};
+
+// pushes everything written to file down to the disk
+static bool syncFile(std::FILE *file) {
+  if (std::fflush(file) != 0)
+    return false;
+#if defined(_WIN32)
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+// renames from over to and waits until the rename is on disk, so after a
+// power loss to names either the old file or the complete new one
+static bool replaceFile(const std::string &from, const std::string &to) {
+#if defined(_WIN32)
+  return MoveFileExA(from.c_str(), to.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  if (std::rename(from.c_str(), to.c_str()) != 0)
+    return false;
+  const std::size_t slash = to.find_last_of('/');
+  const std::string directory =
+      slash == std::string::npos ? "." : slash == 0 ? "/" : to.substr(0, slash);
+  int descriptor = ::open(directory.c_str(), O_RDONLY);
+  if (descriptor < 0)
+    return false;
+  bool synced = fsync(descriptor) == 0;
+  ::close(descriptor);
+  return synced;
+#endif
+}
+
+bool saveCheckpoint(const std::string &path, const BodyStore &bodies,
+                    Integrator &integrator, double time, std::uint64_t steps,
+                    std::string &error) {
+  // the header is written as one page, unused parts zeroed
+  std::vector<unsigned char> page(Checkpoint::pageSize, 0);
+  CheckpointHeader &header = *reinterpret_cast<CheckpointHeader *>(page.data());
+  std::memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+  header.version = Checkpoint::version;
+  header.byteOrder = byteOrderMark;
+  header.nextBodyId = bodies.getNextId();
+  header.bodyCount = bodies.size();
+  header.steps = steps;
+  header.time = time;
+  std::strncpy(header.precision, Precision::name,
+               sizeof(header.precision) - 1);
+  std::strncpy(header.integrator, integrator.getName(),
+               sizeof(header.integrator) - 1);
+
+  CheckpointWriter writer(header);
+  forEachBodyField(bodies, [&](const char *name, const auto &field) {
+    writer.addArray(name, field.data(), sizeof(field[0]), field.size());
+  });
+  integrator.visitState(writer);
+  if (!writer.error.empty()) {
+    error = path + ": " + writer.error;
+    return false;
+  }
+  header.fileSize = writer.offset;
+
+  const std::string temporary = path + ".tmp";
+  std::FILE *file = std::fopen(temporary.c_str(), "wb");
+  if (!file) {
+    error = "could not create " + temporary;
+    return false;
+  }
+  bool written = std::fwrite(page.data(), 1, page.size(), file) == page.size();
+  const std::vector<unsigned char> zeros(Checkpoint::pageSize, 0);
+  for (const auto &array : writer.arrays) {
+    if (!written)
+      break;
+    std::size_t padding = roundToPage(array.second) - array.second;
+    written = std::fwrite(array.first, 1, array.second, file) ==
+                  array.second &&
+              std::fwrite(zeros.data(), 1, padding, file) == padding;
+  }
+  // the data has to be on disk before the rename can be, or a power loss
+  // could leave path naming a file that was never written out
+  written = written && syncFile(file);
+  written = std::fclose(file) == 0 && written;
+
+  if (!written || !replaceFile(temporary, path)) {
+    std::remove(temporary.c_str());
+    error = "could not write " + path;
+    return false;
+  }
+  return true;
+}
+
+bool Checkpoint::open(const std::string &path, std::string &error) {
+  close();
+
+  // read ahead from the start, restoring touches every page anyway
+  if (!file.open(path, MappedFileAccess::WillNeed, error))
+    return false;
+  data = file.data();
+  size = file.size();
+
+  const CheckpointHeader *candidate =
+      reinterpret_cast<const CheckpointHeader *>(data);
+  if (size < pageSize ||
+      std::memcmp(candidate->magic, checkpointMagic, sizeof(checkpointMagic))) {
+    error = path + ": not a checkpoint";
+  } else if (candidate->version != version) {
+    error = path + ": checkpoint version " +
+            std::to_string(candidate->version) + ", expected " +
+            std::to_string(version);
+  } else if (candidate->byteOrder != byteOrderMark) {
+    error = path + ": checkpoint of another byte order";
+  } else if (std::strncmp(candidate->precision, Precision::name,
+                          sizeof(candidate->precision))) {
+    error = path + ": checkpoint of " +
+            std::string(candidate->precision,
+                        strnlen(candidate->precision,
+                                sizeof(candidate->precision))) +
+            " precision, this build uses " + Precision::name;
+  } else if (candidate->fileSize != size ||
+             candidate->sectionCount > maxSections) {
+    error = path + ": checkpoint is truncated or damaged";
+  }
+  for (std::uint32_t i = 0; error.empty() && i < candidate->sectionCount;
+       ++i) {
+    const CheckpointSection &section = candidate->sections[i];
+    // divided rather than multiplied, so a damaged count cannot wrap around
+    if (!section.isValue &&
+        (section.offset % pageSize != 0 || section.offset > size ||
+         section.elementSize == 0 ||
+         section.count > (size - section.offset) / section.elementSize))
+      error = path + ": checkpoint is truncated or damaged";
+  }
+  if (!error.empty()) {
+    close();
+    return false;
+  }
+  header = candidate;
+
+  // the body arrays have to match the store of this build exactly, padding
+  // included
+  const std::size_t padded =
+      (header->bodyCount + BodyStore::laneWidth - 1) / BodyStore::laneWidth *
+      BodyStore::laneWidth;
+  BodyStore types;
+  forEachBodyField(types, [&](const char *name, const auto &field) {
+    using Field = typename std::decay<decltype(field)>::type;
+    const CheckpointSection *section = findSection(name);
+    if (error.empty() &&
+        (!section || section->isValue ||
+         section->elementSize != sizeof(typename Field::value_type) ||
+         section->count != padded))
+      error = path + ": body array " + name + " is missing or of another type";
+  });
+  if (!error.empty()) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void Checkpoint::close() {
+  file.close();
+  data = nullptr;
+  size = 0;
+  header = nullptr;
+}
+
+std::size_t Checkpoint::getBodyCount() const {
+  return header ? static_cast<std::size_t>(header->bodyCount) : 0;
+}
+
+double Checkpoint::getTime() const { return header ? header->time : 0.0; }
+
+std::uint64_t Checkpoint::getSteps() const {
+  return header ? header->steps : 0;
+}
+
+std::string Checkpoint::getIntegratorName() const {
+  // the field comes from the file, which need not end it with a NUL
+  return header ? std::string(header->integrator,
+                              strnlen(header->integrator,
+                                      sizeof(header->integrator)))
+                : std::string();
+}
+
+const CheckpointSection *
+Checkpoint::findSection(const std::string &name) const {
+  for (std::uint32_t i = 0; i < header->sectionCount; ++i)
+    if (!std::strncmp(header->sections[i].name, name.c_str(),
+                      sizeof(header->sections[i].name)))
+      return &header->sections[i];
+  return nullptr;
+}
+
+const void *Checkpoint::sectionData(const std::string &name) const {
+  return data + findSection(name)->offset;
+}
+
+BodyArrays Checkpoint::arrays() const {
+  if (!header)
+    return BodyArrays{nullptr, nullptr, nullptr, nullptr, nullptr, 0};
+  using Position = BodyStore::Position;
+  using Pair = BodyStore::Pair;
+  return BodyArrays{
+      static_cast<const Position *>(sectionData("bodies.x")),
+      static_cast<const Position *>(sectionData("bodies.y")),
+      static_cast<const Position *>(sectionData("bodies.z")),
+      static_cast<const Pair *>(sectionData("bodies.mass")),
+      static_cast<const Pair *>(sectionData("bodies.radius")),
+      getBodyCount()};
+}
+
+bool Checkpoint::restore(BodyStore &bodies, Integrator &integrator,
+                         std::string &error) const {
+  if (!header) {
+    error = "no checkpoint open";
+    return false;
+  }
+  if (std::strncmp(header->integrator, integrator.getName(),
+                   sizeof(header->integrator))) {
+    error = "checkpoint was saved by the " + getIntegratorName() +
+            " integrator, not " + integrator.getName();
+    return false;
+  }
+
+  // a dry run first, so nothing changes unless all of the state fits
+  CheckpointReader reader(
+      [this](const std::string &name) { return findSection(name); }, data);
+  integrator.visitState(reader);
+  if (!reader.error.empty()) {
+    error = reader.error;
+    return false;
+  }
+
+  bodies.resize(getBodyCount());
+  forEachBodyField(bodies, [&](const char *name, auto &field) {
+    copyParallel(field.data(), sectionData(name),
+                 field.size() * sizeof(field[0]));
+  });
+  bodies.setNextId(header->nextBodyId);
+  reader.apply = true;
+  integrator.visitState(reader);
+  return true;
+}
@@ -0,0 +1,107 @@
+#include <continuous_collision.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// bodies per parallel chunk
+static const std::size_t sweepChunk = 4096;
+// pairs per parallel chunk of the exact test
+static const std::size_t impactChunk = 1024;
+static const double noImpact = std::numeric_limits<double>::infinity();
+
+// earliest t in [0, 1] at which a sphere of radius reach around s + w t
+// holds the origin, s the offset at the start and w the change over the step
+static double impactTime(const double *s, const double *w, double reach) {
+  const double c = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] - reach * reach;
+  if (c <= 0.0)
+    return 0.0;
+  const double b = s[0] * w[0] + s[1] * w[1] + s[2] * w[2];
+  if (b >= 0.0)
+    return noImpact;
+  const double a = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+  const double discriminant = b * b - a * c;
+  if (discriminant < 0.0)
+    return noImpact;
+  // the smaller root of a t^2 + 2 b t + c, without cancellation
+  const double t = c / (std::sqrt(discriminant) - b);
+  return t <= 1.0 ? t : noImpact;
+}
+
+void ContinuousCollision::begin(const BodyStore &bodies) {
+  const std::size_t n = bodies.size();
+  startX.assign(bodies.x.begin(), bodies.x.begin() + n);
+  startY.assign(bodies.y.begin(), bodies.y.begin() + n);
+  startZ.assign(bodies.z.begin(), bodies.z.begin() + n);
+}
+
+void ContinuousCollision::findImpacts(const BodyStore &bodies,
+                                      std::vector<BodyImpact> &impacts) {
+  const std::size_t n = bodies.size();
+  impacts.clear();
+  candidates.clear();
+  if (n != startX.size())
+    return;
+
+  sweptX.resize(n);
+  sweptY.resize(n);
+  sweptZ.resize(n);
+  sweptRadius.resize(n);
+  parallelFor(0, n, sweepChunk, [&](std::size_t begin, std::size_t end) {
+    // the rounded centre may sit a few ulps off the true one
+    const double slack = 4.0 * std::numeric_limits<Position>::epsilon();
+    for (std::size_t i = begin; i < end; ++i) {
+      const double from[3] = {double(startX[i]), double(startY[i]),
+                              double(startZ[i])};
+      const double to[3] = {double(bodies.x[i]), double(bodies.y[i]),
+                            double(bodies.z[i])};
+      const double dx = to[0] - from[0], dy = to[1] - from[1],
+                   dz = to[2] - from[2];
+      const double half = 0.5 * std::sqrt(dx * dx + dy * dy + dz * dz);
+      sweptX[i] = static_cast<Position>(0.5 * (from[0] + to[0]));
+      sweptY[i] = static_cast<Position>(0.5 * (from[1] + to[1]));
+      sweptZ[i] = static_cast<Position>(0.5 * (from[2] + to[2]));
+      const double size = std::fabs(from[0]) + std::fabs(from[1]) +
+                          std::fabs(from[2]) + std::fabs(to[0]) +
+                          std::fabs(to[1]) + std::fabs(to[2]);
+      sweptRadius[i] = static_cast<Pair>(
+          (bodies.radius[i] + half + slack * size) * (1.0 + slack));
+    }
+  });
+
+  broadphase.findOverlaps(BodyArrays{sweptX.data(), sweptY.data(),
+                                     sweptZ.data(), bodies.mass.data(),
+                                     sweptRadius.data(), n},
+                          candidates);
+
+  times.resize(candidates.size());
+  parallelFor(0, candidates.size(), impactChunk,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t k = begin; k < end; ++k) {
+                  const std::uint32_t a = candidates[k].first;
+                  const std::uint32_t b = candidates[k].second;
+                  const double s[3] = {double(startX[b]) - startX[a],
+                                       double(startY[b]) - startY[a],
+                                       double(startZ[b]) - startZ[a]};
+                  const double e[3] = {double(bodies.x[b]) - bodies.x[a],
+                                       double(bodies.y[b]) - bodies.y[a],
+                                       double(bodies.z[b]) - bodies.z[a]};
+                  const double w[3] = {e[0] - s[0], e[1] - s[1],
+                                       e[2] - s[2]};
+                  times[k] = impactTime(
+                      s, w, double(bodies.radius[a]) + bodies.radius[b]);
+                }
+              });
+
+  for (std::size_t k = 0; k < candidates.size(); ++k)
+    if (times[k] != noImpact)
+      impacts.push_back(
+          BodyImpact{candidates[k].first, candidates[k].second, times[k]});
+  std::sort(impacts.begin(), impacts.end(),
+            [](const BodyImpact &p, const BodyImpact &q) {
+              if (p.time != q.time)
+                return p.time < q.time;
+              return p.first != q.first ? p.first < q.first
+                                        : p.second < q.second;
+            });
+}
@@ -0,0 +1,90 @@
+#include <cpu_features.h>
+
+#if defined(SOLAR_SIM_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(SOLAR_SIM_X86)
+static void cpuid(unsigned int leaf, unsigned int subleaf,
+                  unsigned int regs[4]) {
+#if defined(_MSC_VER)
+  int out[4];
+  __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i)
+    regs[i] = static_cast<unsigned int>(out[i]);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long readXcr0() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned int eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+static CpuFeatures queryCpuFeatures() {
+  CpuFeatures features;
+#if defined(SOLAR_SIM_X86)
+  unsigned int regs[4];
+  cpuid(0, 0, regs);
+  unsigned int maxLeaf = regs[0];
+
+  cpuid(1, 0, regs);
+  features.sse2 = (regs[3] & (1u << 26)) != 0;
+  bool osxsave = (regs[2] & (1u << 27)) != 0;
+  bool avx = (regs[2] & (1u << 28)) != 0;
+  bool fma = (regs[2] & (1u << 12)) != 0;
+
+  // the OS has to save ymm (bits 1-2) and zmm/opmask (bits 5-7) state
+  unsigned long long xcr0 = osxsave ? readXcr0() : 0;
+  bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+  bool zmmEnabled = (xcr0 & 0xe6) == 0xe6;
+
+  if (maxLeaf >= 7) {
+    cpuid(7, 0, regs);
+    features.avx2 = avx && ymmEnabled && (regs[1] & (1u << 5)) != 0;
+    features.avx512f = zmmEnabled && (regs[1] & (1u << 16)) != 0;
+  }
+  features.fma = avx && ymmEnabled && fma;
+#endif
+  return features;
+}
+
+const CpuFeatures &getCpuFeatures() {
+  static const CpuFeatures features = queryCpuFeatures();
+  return features;
+}
+
+SimdLevel detectSimdLevel() {
+  const CpuFeatures &features = getCpuFeatures();
+  if (features.avx512f)
+    return SimdLevel::Avx512;
+  if (features.avx2 && features.fma)
+    return SimdLevel::Avx2;
+  if (features.sse2)
+    return SimdLevel::Sse2;
+  return SimdLevel::Scalar;
+}
+
+const char *getSimdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::Sse2:
+    return "SSE2";
+  case SimdLevel::Avx2:
+    return "AVX2";
+  case SimdLevel::Avx512:
+    return "AVX-512";
+  default:
+    return "scalar";
+  }
+}
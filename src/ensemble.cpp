@@ -0,0 +1,239 @@
+#include <ensemble.h>
+#include <gravity_kernels.h>
+#include <pair_force.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+
+const char *getSystemStateName(SystemState state) {
+  switch (state) {
+  case SystemState::Running:
+    return "running";
+  case SystemState::Ejected:
+    return "ejected";
+  case SystemState::Diverged:
+    return "diverged";
+  }
+  return "unknown";
+}
+
+Ensemble::Ensemble(std::size_t bodiesPerSystem)
+    : bodiesPerSystem(bodiesPerSystem) {}
+
+EnsembleArrays Ensemble::arrays() const {
+  return EnsembleArrays{x.data(),    y.data(),      z.data(),
+                        mass.data(), radius.data(), bodiesPerSystem};
+}
+
+template <typename From, typename To>
+void Ensemble::copyBody(const From &from, std::size_t i, To &to,
+                        std::size_t j) {
+  to.x[j] = from.x[i];
+  to.y[j] = from.y[i];
+  to.z[j] = from.z[i];
+  to.vx[j] = from.vx[i];
+  to.vy[j] = from.vy[i];
+  to.vz[j] = from.vz[i];
+  to.mass[j] = from.mass[i];
+  to.radius[j] = from.radius[i];
+}
+
+bool Ensemble::addSystem(const BodyStore &system, std::string &error) {
+  if (system.size() > bodiesPerSystem) {
+    error = "system of " + std::to_string(system.size()) +
+            " bodies does not fit " + std::to_string(bodiesPerSystem) +
+            " bodies per system";
+    return false;
+  }
+
+  // retired slots are cleared, so the lanes after the running ones are free
+  const std::size_t slot = runningCount++;
+  const std::size_t elements =
+      (slot / laneWidth + 1) * bodiesPerSystem * laneWidth;
+  if (x.size() < elements) {
+    for (auto *field : {&x, &y, &z, &vx, &vy, &vz})
+      field->resize(elements, 0);
+    for (auto *field : {&mass, &radius})
+      field->resize(elements, 0);
+    for (auto *field : {&ax, &ay, &az})
+      field->resize(elements, 0);
+  }
+
+  for (std::size_t b = 0; b < system.size(); ++b)
+    copyBody(system, b, *this, index(slot, b));
+  slotSystem.push_back(static_cast<std::uint32_t>(systems.size()));
+
+  System added;
+  added.bodyCount = system.size();
+  added.slot = slot;
+  added.addedAt = stepCount;
+  systems.push_back(added);
+  systems.back().startEnergy = systems.back().energy = slotEnergy(slot);
+  accelerationsValid = false;
+  return true;
+}
+
+double Ensemble::slotEnergy(std::size_t slot) const {
+  const std::size_t n = systems[slotSystem[slot]].bodyCount;
+  double energy = 0.0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::size_t a = index(slot, i);
+    double massI = mass[a];
+    energy += 0.5 * massI *
+              (double(vx[a]) * vx[a] + double(vy[a]) * vy[a] +
+               double(vz[a]) * vz[a]);
+    for (std::size_t j = i + 1; j < n; ++j) {
+      const std::size_t b = index(slot, j);
+      double dx = double(x[b]) - x[a];
+      double dy = double(y[b]) - y[a];
+      double dz = double(z[b]) - z[a];
+      energy += massI * mass[b] *
+                pairPotential<double>(dx * dx + dy * dy + dz * dz, radius[a],
+                                      radius[b]);
+    }
+  }
+  return energy;
+}
+
+SystemState Ensemble::checkSlot(std::size_t slot) {
+  System &system = systems[slotSystem[slot]];
+  double totalMass = 0.0, centreX = 0.0, centreY = 0.0, centreZ = 0.0;
+  for (std::size_t b = 0; b < system.bodyCount; ++b) {
+    const std::size_t k = index(slot, b);
+    if (!std::isfinite(x[k]) || !std::isfinite(y[k]) || !std::isfinite(z[k]) ||
+        !std::isfinite(vx[k]) || !std::isfinite(vy[k]) ||
+        !std::isfinite(vz[k]))
+      return SystemState::Diverged;
+    totalMass += mass[k];
+    centreX += mass[k] * double(x[k]);
+    centreY += mass[k] * double(y[k]);
+    centreZ += mass[k] * double(z[k]);
+  }
+
+  system.energy = slotEnergy(slot);
+  if (std::fabs(system.energy - system.startEnergy) >
+      energyTolerance * std::fabs(system.startEnergy))
+    return SystemState::Diverged;
+
+  if (totalMass > 0.0 && std::isfinite(ejectionDistance)) {
+    centreX /= totalMass;
+    centreY /= totalMass;
+    centreZ /= totalMass;
+    for (std::size_t b = 0; b < system.bodyCount; ++b) {
+      const std::size_t k = index(slot, b);
+      double dx = x[k] - centreX, dy = y[k] - centreY, dz = z[k] - centreZ;
+      if (mass[k] > 0 &&
+          dx * dx + dy * dy + dz * dz > ejectionDistance * ejectionDistance)
+        return SystemState::Ejected;
+    }
+  }
+  return SystemState::Running;
+}
+
+void Ensemble::stepBlock(std::size_t block, std::size_t steps,
+                         Position deltaTime) {
+  const EnsembleKernel kernel = getEnsembleKernel();
+  const EnsembleArrays lanes = arrays();
+  const std::size_t first = block * bodiesPerSystem * laneWidth;
+  const std::size_t last = first + bodiesPerSystem * laneWidth;
+  const Position halfStep = deltaTime / 2;
+
+  if (!accelerationsValid)
+    kernel(lanes, block, block + 1, ax.data(), ay.data(), az.data());
+  for (std::size_t step = 0; step < steps; ++step) {
+    for (std::size_t k = first; k < last; ++k) {
+      vx[k] += halfStep * ax[k];
+      vy[k] += halfStep * ay[k];
+      vz[k] += halfStep * az[k];
+      x[k] += deltaTime * vx[k];
+      y[k] += deltaTime * vy[k];
+      z[k] += deltaTime * vz[k];
+    }
+    kernel(lanes, block, block + 1, ax.data(), ay.data(), az.data());
+    for (std::size_t k = first; k < last; ++k) {
+      vx[k] += halfStep * ax[k];
+      vy[k] += halfStep * ay[k];
+      vz[k] += halfStep * az[k];
+    }
+  }
+}
+
+void Ensemble::run(std::size_t steps, float deltaTime) {
+  std::vector<SystemState> states;
+  while (steps > 0 && runningCount > 0) {
+    const std::size_t chunk = std::min(steps, checkInterval);
+    states.assign(runningCount, SystemState::Running);
+
+    parallelFor(0, blockCount(), 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t block = begin; block < end; ++block) {
+        stepBlock(block, chunk, static_cast<Position>(deltaTime));
+        const std::size_t slotEnd =
+            std::min((block + 1) * laneWidth, runningCount);
+        for (std::size_t slot = block * laneWidth; slot < slotEnd; ++slot)
+          states[slot] = checkSlot(slot);
+      }
+    });
+    accelerationsValid = true;
+    stepCount += chunk;
+    steps -= chunk;
+
+    // from the back, so the last running slot never is one still to retire
+    for (std::size_t slot = runningCount; slot-- > 0;)
+      if (states[slot] != SystemState::Running)
+        retire(slot, states[slot]);
+  }
+}
+
+void Ensemble::retire(std::size_t slot, SystemState state) {
+  System &system = systems[slotSystem[slot]];
+  system.state = state;
+  system.retiredAt = stepCount;
+
+  const std::size_t offset = retired.size();
+  retired.resize(offset + system.bodyCount);
+  for (std::size_t b = 0; b < system.bodyCount; ++b)
+    copyBody(*this, index(slot, b), retired, offset + b);
+  system.slot = offset;
+
+  // the last running system takes over the lane, accelerations included
+  const std::size_t lastSlot = runningCount - 1;
+  for (std::size_t b = 0; b < bodiesPerSystem; ++b) {
+    const std::size_t to = index(slot, b), from = index(lastSlot, b);
+    copyBody(*this, from, *this, to);
+    ax[to] = ax[from];
+    ay[to] = ay[from];
+    az[to] = az[from];
+    x[from] = y[from] = z[from] = 0;
+    vx[from] = vy[from] = vz[from] = 0;
+    mass[from] = radius[from] = 0;
+    ax[from] = ay[from] = az[from] = 0;
+  }
+  slotSystem[slot] = slotSystem[lastSlot];
+  systems[slotSystem[slot]].slot = slot;
+  slotSystem.pop_back();
+  --runningCount;
+}
+
+std::uint64_t Ensemble::getStepCount(std::size_t system) const {
+  const System &info = systems[system];
+  return (info.state == SystemState::Running ? stepCount : info.retiredAt) -
+         info.addedAt;
+}
+
+double Ensemble::getEnergyError(std::size_t system) const {
+  const System &info = systems[system];
+  if (info.startEnergy == 0.0)
+    return info.energy;
+  return (info.energy - info.startEnergy) / std::fabs(info.startEnergy);
+}
+
+void Ensemble::getSystem(std::size_t system, BodyStore &out) const {
+  const System &info = systems[system];
+  out.resize(info.bodyCount);
+  for (std::size_t b = 0; b < info.bodyCount; ++b) {
+    if (info.state == SystemState::Running)
+      copyBody(*this, index(info.slot, b), out, b);
+    else
+      copyBody(retired, info.slot + b, out, b);
+  }
+}
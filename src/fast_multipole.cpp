@@ -0,0 +1,467 @@
+#include <fast_multipole.h>
+#include <globals.h>
+#include <gravity_kernels.h>
+#include <parallel.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+using Accumulator = BodyStore::Accumulator;
+
+// multi-indices n = (a, b, c) listed by degree a + b + c, with the index
+// tables the translation operators walk. with M_n = sum m d^n / n! and D_n
+// the n-th derivative of 1/r, the potential sum m / |x - x_j| of a cell is
+// sum_n (-1)^|n| M_n D_n(x - z); locals are plain derivatives L_m, evaluated
+// as sum_m L_m h^m / m!.
+struct ExpansionTables {
+  struct Shift {
+    int large, small, difference;
+  };
+  struct Translation {
+    int multipole, coefficient;
+    double scale;
+  };
+  struct Recurrence {
+    // k - e_i and k - 2 e_i, or the always zero slot termCount
+    int one[3], two[3];
+    double first, second;
+  };
+
+  int order;
+  int side;
+  std::size_t termCount;     // degree <= order
+  std::size_t gradientCount; // degree <= order - 1
+  std::vector<std::array<int, 3>> exponents;
+  std::vector<int> lookup;
+  std::vector<double> factorial;
+  // term k is term monomialParent[k] times h[axis] / exponent[axis]
+  std::vector<int> monomialParent, monomialAxis;
+  // terms of the 1/r coefficient recurrence
+  std::vector<Recurrence> recurrences;
+  // M2M and L2L pairs n >= k with the index of n - k
+  std::vector<Shift> shifts;
+  // L_m += (-1)^|n| (m + n)! M_n b_(m + n) for |m| + |n| <= order, grouped
+  // by m: the terms of L_m are translations[translationStart[m]] up to
+  // translations[translationStart[m + 1]]
+  std::vector<Translation> translations;
+  std::vector<int> translationStart;
+  // index of m + e_i for every m of degree <= order - 1
+  std::vector<std::array<int, 3>> gradient;
+
+  explicit ExpansionTables(int order);
+  int indexOf(int a, int b, int c) const {
+    if (a < 0 || b < 0 || c < 0 || a + b + c >= side)
+      return -1;
+    return lookup[(a * side + b) * side + c];
+  }
+};
+
+ExpansionTables::ExpansionTables(int order) : order(order) {
+  side = order + 1;
+  lookup.assign(side * side * side, -1);
+  for (int degree = 0; degree <= order; ++degree) {
+    for (int a = degree; a >= 0; --a)
+      for (int b = degree - a; b >= 0; --b) {
+        int c = degree - a - b;
+        lookup[(a * side + b) * side + c] = static_cast<int>(exponents.size());
+        exponents.push_back({a, b, c});
+      }
+    if (degree == order - 1)
+      gradientCount = exponents.size();
+  }
+  termCount = exponents.size();
+
+  auto factorialOf = [](int n) {
+    double result = 1.0;
+    for (int i = 2; i <= n; ++i)
+      result *= i;
+    return result;
+  };
+
+  for (std::size_t k = 0; k < termCount; ++k) {
+    const std::array<int, 3> &e = exponents[k];
+    factorial.push_back(factorialOf(e[0]) * factorialOf(e[1]) *
+                        factorialOf(e[2]));
+
+    int axis = e[0] > 0 ? 0 : (e[1] > 0 ? 1 : 2);
+    monomialAxis.push_back(axis);
+    monomialParent.push_back(
+        k == 0 ? -1
+               : indexOf(e[0] - (axis == 0), e[1] - (axis == 1),
+                         e[2] - (axis == 2)));
+
+    Recurrence recurrence;
+    int degree = std::max(e[0] + e[1] + e[2], 1);
+    int zero = static_cast<int>(termCount);
+    for (int i = 0; i < 3; ++i) {
+      int one = indexOf(e[0] - (i == 0), e[1] - (i == 1), e[2] - (i == 2));
+      int two = indexOf(e[0] - 2 * (i == 0), e[1] - 2 * (i == 1),
+                        e[2] - 2 * (i == 2));
+      recurrence.one[i] = one >= 0 ? one : zero;
+      recurrence.two[i] = two >= 0 ? two : zero;
+    }
+    recurrence.first = -(2.0 * degree - 1.0) / degree;
+    recurrence.second = -(degree - 1.0) / degree;
+    recurrences.push_back(recurrence);
+  }
+
+  for (std::size_t n = 0; n < termCount; ++n) {
+    const std::array<int, 3> &en = exponents[n];
+    for (std::size_t k = 0; k < termCount; ++k) {
+      const std::array<int, 3> &ek = exponents[k];
+      int difference = indexOf(en[0] - ek[0], en[1] - ek[1], en[2] - ek[2]);
+      if (difference >= 0)
+        shifts.push_back(
+            {static_cast<int>(n), static_cast<int>(k), difference});
+    }
+  }
+
+  for (std::size_t m = 0; m < termCount; ++m) {
+    const std::array<int, 3> &em = exponents[m];
+    translationStart.push_back(static_cast<int>(translations.size()));
+    for (std::size_t n = 0; n < termCount; ++n) {
+      const std::array<int, 3> &en = exponents[n];
+      int degree = em[0] + em[1] + em[2] + en[0] + en[1] + en[2];
+      if (degree > order)
+        continue;
+      int sum = indexOf(em[0] + en[0], em[1] + en[1], em[2] + en[2]);
+      double sign = (en[0] + en[1] + en[2]) % 2 ? -1.0 : 1.0;
+      translations.push_back({static_cast<int>(n), sum, sign * factorial[sum]});
+    }
+  }
+  translationStart.push_back(static_cast<int>(translations.size()));
+
+  for (std::size_t m = 0; m < gradientCount; ++m) {
+    const std::array<int, 3> &e = exponents[m];
+    gradient.push_back({indexOf(e[0] + 1, e[1], e[2]),
+                        indexOf(e[0], e[1] + 1, e[2]),
+                        indexOf(e[0], e[1], e[2] + 1)});
+  }
+}
+
+// largest table any order up to maxExpansionOrder needs
+static constexpr std::size_t maxTermCount =
+    (FastMultipoleGravity::maxExpansionOrder + 1) *
+    (FastMultipoleGravity::maxExpansionOrder + 2) *
+    (FastMultipoleGravity::maxExpansionOrder + 3) / 6;
+
+// h^n / n! for the first count terms
+static void computeMonomials(const ExpansionTables &tables,
+                             const glm::dvec3 &h, std::size_t count,
+                             double *out) {
+  out[0] = 1.0;
+  for (std::size_t k = 1; k < count; ++k) {
+    int axis = tables.monomialAxis[k];
+    out[k] = out[tables.monomialParent[k]] * h[axis] /
+             tables.exponents[k][axis];
+  }
+}
+
+// taylor coefficients b_k = D_k / k! of 1/|r| up to degree order, all that
+// M2L needs once it is truncated at |m| + |n| <= order. they obey
+// |k| r^2 b_k + (2|k| - 1) sum_i r_i b_(k - e_i) + (|k| - 1) sum_i
+// b_(k - 2 e_i) = 0. out needs termCount + 1 slots, the last one stays zero.
+static void computeCoefficients(const ExpansionTables &tables,
+                                const glm::dvec3 &r, double *out) {
+  double distanceSquared = glm::dot(r, r);
+  double inverseSquared = 1.0 / distanceSquared;
+  out[0] = 1.0 / std::sqrt(distanceSquared);
+  out[tables.termCount] = 0.0;
+
+  for (std::size_t k = 1; k < tables.termCount; ++k) {
+    const ExpansionTables::Recurrence &term = tables.recurrences[k];
+    double first = r.x * out[term.one[0]] + r.y * out[term.one[1]] +
+                   r.z * out[term.one[2]];
+    double second = out[term.two[0]] + out[term.two[1]] + out[term.two[2]];
+    out[k] = (term.first * first + term.second * second) * inverseSquared;
+  }
+}
+
+FastMultipoleGravity::FastMultipoleGravity(int expansionOrder,
+                                           float openingAngle,
+                                           std::uint32_t leafCapacity)
+    : expansionOrder(0), openingAngle(openingAngle),
+      leafCapacity(std::max(1u, leafCapacity)) {
+  setExpansionOrder(expansionOrder);
+  setOpeningAngle(openingAngle);
+}
+
+FastMultipoleGravity::~FastMultipoleGravity() = default;
+
+void FastMultipoleGravity::setExpansionOrder(int order) {
+  order = std::min(std::max(order, 1), maxExpansionOrder);
+  if (order == expansionOrder)
+    return;
+  expansionOrder = order;
+  tables = std::make_unique<ExpansionTables>(order);
+}
+
+void FastMultipoleGravity::setOpeningAngle(float angle) {
+  openingAngle = std::min(std::max(angle, 0.05f), 1.0f);
+}
+
+void FastMultipoleGravity::setLeafCapacity(std::uint32_t capacity) {
+  leafCapacity = std::max(1u, capacity);
+}
+
+void FastMultipoleGravity::computeAccelerations(BodyStore &bodies) {
+  tree.build(bodies, leafCapacity);
+  if (tree.nodes.empty())
+    return;
+
+  upwardPass(bodies);
+  buildInteractionLists();
+  translateFarField();
+  downwardPass();
+  evaluateLeaves(bodies);
+}
+
+// P2M at the leaves, M2M towards the root, and the radius around each
+// expansion centre that holds all of a cell's bodies
+void FastMultipoleGravity::upwardPass(const BodyStore &bodies) {
+  const ExpansionTables &t = *tables;
+  const std::size_t terms = t.termCount;
+  multipoles.assign(tree.nodes.size() * terms, 0.0);
+  radii.resize(tree.nodes.size());
+
+  tree.visitBottomUp([&](std::uint32_t index) {
+    const OctreeNode &node = tree.nodes[index];
+    double *multipole = &multipoles[index * terms];
+    glm::dvec3 center(node.center);
+    double monomials[maxTermCount];
+
+    double reach = 0.0;
+
+    if (node.isLeaf()) {
+      for (std::uint32_t k = node.begin; k < node.end; ++k) {
+        std::uint32_t b = tree.order[k];
+        glm::dvec3 d =
+            glm::dvec3(bodies.x[b], bodies.y[b], bodies.z[b]) - center;
+        reach = std::max(reach, glm::length(d));
+        computeMonomials(t, d, terms, monomials);
+        for (std::size_t n = 0; n < terms; ++n)
+          multipole[n] += bodies.mass[b] * monomials[n];
+      }
+    } else {
+      for (std::uint32_t c = 0; c < node.childCount; ++c) {
+        std::uint32_t child = node.firstChild + c;
+        const double *source = &multipoles[child * terms];
+        glm::dvec3 shift = glm::dvec3(tree.nodes[child].center) - center;
+        reach = std::max(reach, glm::length(shift) + radii[child]);
+        computeMonomials(t, shift, terms, monomials);
+        for (const ExpansionTables::Shift &pair : t.shifts)
+          multipole[pair.large] +=
+              source[pair.small] * monomials[pair.difference];
+      }
+    }
+
+    // the bodies usually fill far less than the whole cube
+    radii[index] = static_cast<float>(
+        std::min(reach, node.halfSize * 1.7320508075688772));
+  });
+}
+
+void FastMultipoleGravity::buildInteractionLists() {
+  farLists.resize(tree.nodes.size());
+  nearLists.resize(tree.nodes.size());
+  for (std::size_t i = 0; i < tree.nodes.size(); ++i) {
+    farLists[i].clear();
+    nearLists[i].clear();
+  }
+
+  // every body sits below exactly one cell of this cut, and a walk only ever
+  // appends to its own target cell and the cells below it, so the walks of
+  // different cut cells can run in parallel
+  std::vector<std::uint32_t> cut;
+  std::vector<std::uint32_t> stack{0};
+  while (!stack.empty()) {
+    std::uint32_t index = stack.back();
+    stack.pop_back();
+    const OctreeNode &node = tree.nodes[index];
+    if (node.isLeaf() || node.depth >= 2) {
+      cut.push_back(index);
+      continue;
+    }
+    for (std::uint32_t c = 0; c < node.childCount; ++c)
+      stack.push_back(node.firstChild + c);
+  }
+
+  parallelFor(0, cut.size(), 1, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k)
+      interact(cut[k], 0);
+  });
+}
+
+void FastMultipoleGravity::interact(std::uint32_t target,
+                                    std::uint32_t source) {
+  const OctreeNode &t = tree.nodes[target];
+  const OctreeNode &s = tree.nodes[source];
+  glm::vec3 d = t.center - s.center;
+  float reach = radii[target] + radii[source];
+
+  if (reach * reach < openingAngle * openingAngle * glm::dot(d, d)) {
+    farLists[target].push_back(source);
+    return;
+  }
+  if (t.isLeaf() && s.isLeaf()) {
+    nearLists[target].push_back(source);
+    return;
+  }
+
+  if (s.isLeaf() || (!t.isLeaf() && t.halfSize >= s.halfSize)) {
+    for (std::uint32_t c = 0; c < t.childCount; ++c)
+      interact(t.firstChild + c, source);
+  } else {
+    for (std::uint32_t c = 0; c < s.childCount; ++c)
+      interact(target, s.firstChild + c);
+  }
+}
+
+// M2L, every target cell only writes its own local expansion
+void FastMultipoleGravity::translateFarField() {
+  const ExpansionTables &t = *tables;
+  const std::size_t terms = t.termCount;
+  locals.assign(tree.nodes.size() * terms, 0.0);
+
+  parallelFor(0, tree.nodes.size(), 16,
+              [&](std::size_t begin, std::size_t end) {
+                double coefficients[maxTermCount + 1];
+                for (std::size_t target = begin; target < end; ++target) {
+                  double *local = &locals[target * terms];
+                  glm::dvec3 center(tree.nodes[target].center);
+                  for (std::uint32_t source : farLists[target]) {
+                    computeCoefficients(
+                        t, center - glm::dvec3(tree.nodes[source].center),
+                        coefficients);
+                    const double *multipole = &multipoles[source * terms];
+                    for (std::size_t m = 0; m < terms; ++m) {
+                      double sum = 0.0;
+                      for (int k = t.translationStart[m];
+                           k < t.translationStart[m + 1]; ++k) {
+                        const ExpansionTables::Translation &translation =
+                            t.translations[k];
+                        sum += translation.scale *
+                               multipole[translation.multipole] *
+                               coefficients[translation.coefficient];
+                      }
+                      local[m] += sum;
+                    }
+                  }
+                }
+              });
+}
+
+// L2L from every cell into its children
+void FastMultipoleGravity::downwardPass() {
+  const ExpansionTables &t = *tables;
+  const std::size_t terms = t.termCount;
+
+  tree.visitTopDown([&](std::uint32_t index) {
+    const OctreeNode &node = tree.nodes[index];
+    const double *local = &locals[index * terms];
+    glm::dvec3 center(node.center);
+    double monomials[maxTermCount];
+
+    for (std::uint32_t c = 0; c < node.childCount; ++c) {
+      std::uint32_t child = node.firstChild + c;
+      double *target = &locals[child * terms];
+      computeMonomials(t, glm::dvec3(tree.nodes[child].center) - center,
+                       terms, monomials);
+      for (const ExpansionTables::Shift &shift : t.shifts)
+        target[shift.small] += local[shift.large] * monomials[shift.difference];
+    }
+  });
+}
+
+// bodies one leaf sums directly, copied next to each other so the vector
+// kernel can stream them. the leaf's own bodies come first, padded to whole
+// lanes with massless bodies, and are the kernel's targets.
+struct NearField {
+  AlignedVector<BodyStore::Position> x, y, z;
+  AlignedVector<BodyStore::Pair> mass, radius;
+  AlignedVector<Accumulator> ax, ay, az;
+
+  void clear() { resize(0); }
+  void add(const BodyStore &bodies, std::uint32_t b) {
+    x.push_back(bodies.x[b]);
+    y.push_back(bodies.y[b]);
+    z.push_back(bodies.z[b]);
+    mass.push_back(bodies.mass[b]);
+    radius.push_back(bodies.radius[b]);
+  }
+  void pad() {
+    resize((x.size() + BodyStore::laneWidth - 1) / BodyStore::laneWidth *
+           BodyStore::laneWidth);
+  }
+  void resize(std::size_t size) {
+    x.resize(size, 0);
+    y.resize(size, 0);
+    z.resize(size, 0);
+    mass.resize(size, 0);
+    radius.resize(size, 0);
+  }
+  BodyArrays arrays() const {
+    return {x.data(), y.data(), z.data(), mass.data(), radius.data(), x.size()};
+  }
+};
+
+// L2P plus the direct sums with neighbouring leaves
+void FastMultipoleGravity::evaluateLeaves(BodyStore &bodies) {
+  const ExpansionTables &t = *tables;
+  const std::size_t terms = t.termCount;
+  std::vector<std::uint32_t> leaves;
+  for (std::uint32_t i = 0; i < tree.nodes.size(); ++i)
+    if (tree.nodes[i].isLeaf())
+      leaves.push_back(i);
+
+  AccelerationKernel kernel = getAccelerationKernel();
+  Accumulator *ax = bodies.ax.data(), *ay = bodies.ay.data(),
+              *az = bodies.az.data();
+  parallelFor(0, leaves.size(), 8, [&](std::size_t begin, std::size_t end) {
+    double monomials[maxTermCount];
+    NearField near;
+    for (std::size_t l = begin; l < end; ++l) {
+      const std::uint32_t index = leaves[l];
+      const OctreeNode &leaf = tree.nodes[index];
+      const double *local = &locals[index * terms];
+      glm::dvec3 center(leaf.center);
+
+      near.clear();
+      for (std::uint32_t k = leaf.begin; k < leaf.end; ++k)
+        near.add(bodies, tree.order[k]);
+      near.pad();
+      for (std::uint32_t source : nearLists[index]) {
+        if (source == index)
+          continue;
+        const OctreeNode &other = tree.nodes[source];
+        for (std::uint32_t k = other.begin; k < other.end; ++k)
+          near.add(bodies, tree.order[k]);
+      }
+      near.ax.resize(near.x.size());
+      near.ay.resize(near.x.size());
+      near.az.resize(near.x.size());
+      kernel(near.arrays(), 0, leaf.bodyCount(), near.ax.data(),
+             near.ay.data(), near.az.data());
+
+      for (std::uint32_t k = leaf.begin; k < leaf.end; ++k) {
+        std::uint32_t b = tree.order[k];
+        std::size_t slot = k - leaf.begin;
+        computeMonomials(
+            t, glm::dvec3(bodies.x[b], bodies.y[b], bodies.z[b]) - center,
+            t.gradientCount, monomials);
+        glm::dvec3 field(0.0);
+        for (std::size_t m = 0; m < t.gradientCount; ++m)
+          field += glm::dvec3(local[t.gradient[m][0]], local[t.gradient[m][1]],
+                              local[t.gradient[m][2]]) *
+                   monomials[m];
+
+        ax[b] = static_cast<Accumulator>(gravityScale * field.x) +
+                near.ax[slot];
+        ay[b] = static_cast<Accumulator>(gravityScale * field.y) +
+                near.ay[slot];
+        az[b] = static_cast<Accumulator>(gravityScale * field.z) +
+                near.az[slot];
+      }
+    }
+  });
+}
@@ -0,0 +1,341 @@
+#include <gravity_kernels.h>
+#include <body_store.h>
+#include <pair_force.h>
+#include <algorithm>
+
+template <typename Policy>
+void accelerationsScalar(const BasicBodyArrays<Policy> &bodies,
+                         std::size_t begin, std::size_t end,
+                         typename Policy::Accumulator *ax,
+                         typename Policy::Accumulator *ay,
+                         typename Policy::Accumulator *az) {
+  using Pair = typename Policy::Pair;
+  using Accumulator = typename Policy::Accumulator;
+  const std::size_t n = bodies.count;
+  const auto *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const Pair *m = bodies.mass, *r = bodies.radius;
+  end = std::min(end, n);
+
+  for (std::size_t i = begin; i < end; ++i) {
+    Accumulator accX = 0, accY = 0, accZ = 0;
+    for (std::size_t j = 0; j < n; ++j)
+      accumulatePairAcceleration<Pair>(x[j] - x[i], y[j] - y[i], z[j] - z[i],
+                                       r[i], r[j], m[j], accX, accY, accZ);
+    ax[i] = accX;
+    ay[i] = accY;
+    az[i] = accZ;
+  }
+}
+
+template <typename Policy>
+void symmetricAccelerationsScalar(const BasicBodyArrays<Policy> &bodies,
+                                  std::size_t iBegin, std::size_t iEnd,
+                                  std::size_t jBegin, std::size_t jEnd,
+                                  typename Policy::Accumulator *ax,
+                                  typename Policy::Accumulator *ay,
+                                  typename Policy::Accumulator *az) {
+  using Pair = typename Policy::Pair;
+  using Accumulator = typename Policy::Accumulator;
+  const auto *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const Pair *m = bodies.mass, *r = bodies.radius;
+  const bool diagonal = iBegin == jBegin;
+  iEnd = std::min(iEnd, bodies.count);
+  jEnd = std::min(jEnd, bodies.count);
+
+  for (std::size_t i = iBegin; i < iEnd; ++i) {
+    Accumulator accX = 0, accY = 0, accZ = 0;
+    for (std::size_t j = diagonal ? i + 1 : jBegin; j < jEnd; ++j) {
+      Pair dx = Pair(x[j] - x[i]), dy = Pair(y[j] - y[i]);
+      Pair dz = Pair(z[j] - z[i]);
+      Pair scale = pairScale(dx * dx + dy * dy + dz * dz, r[i], r[j]);
+      Pair toI = m[j] * scale, toJ = m[i] * scale;
+      accX += dx * toI;
+      accY += dy * toI;
+      accZ += dz * toI;
+      ax[j] -= dx * toJ;
+      ay[j] -= dy * toJ;
+      az[j] -= dz * toJ;
+    }
+    ax[i] += accX;
+    ay[i] += accY;
+    az[i] += accZ;
+  }
+}
+
+template <typename Policy>
+void targetAccelerationsScalar(const BasicBodyArrays<Policy> &bodies,
+                               const std::uint32_t *targets, std::size_t count,
+                               typename Policy::Accumulator *ax,
+                               typename Policy::Accumulator *ay,
+                               typename Policy::Accumulator *az) {
+  using Pair = typename Policy::Pair;
+  using Accumulator = typename Policy::Accumulator;
+  const std::size_t n = bodies.count;
+  const auto *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const Pair *m = bodies.mass, *r = bodies.radius;
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    Accumulator accX = 0, accY = 0, accZ = 0;
+    for (std::size_t j = 0; j < n; ++j)
+      accumulatePairAcceleration<Pair>(x[j] - x[i], y[j] - y[i], z[j] - z[i],
+                                       r[i], r[j], m[j], accX, accY, accZ);
+    ax[i] = accX;
+    ay[i] = accY;
+    az[i] = accZ;
+  }
+}
+
+template <typename Policy>
+void jerksScalar(const BasicBodyArrays<Policy> &bodies,
+                 const typename Policy::Position *vx,
+                 const typename Policy::Position *vy,
+                 const typename Policy::Position *vz,
+                 const std::uint32_t *targets, std::size_t count,
+                 typename Policy::Accumulator *ax,
+                 typename Policy::Accumulator *ay,
+                 typename Policy::Accumulator *az,
+                 typename Policy::Accumulator *jx,
+                 typename Policy::Accumulator *jy,
+                 typename Policy::Accumulator *jz) {
+  using Pair = typename Policy::Pair;
+  using Accumulator = typename Policy::Accumulator;
+  const std::size_t n = bodies.count;
+  const auto *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const Pair *m = bodies.mass, *r = bodies.radius;
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    Accumulator accX = 0, accY = 0, accZ = 0;
+    Accumulator jerkX = 0, jerkY = 0, jerkZ = 0;
+    for (std::size_t j = 0; j < n; ++j)
+      accumulatePairJerk<Pair>(x[j] - x[i], y[j] - y[i], z[j] - z[i],
+                               vx[j] - vx[i], vy[j] - vy[i], vz[j] - vz[i],
+                               r[i], r[j], m[j], accX, accY, accZ, jerkX,
+                               jerkY, jerkZ);
+    ax[i] = accX;
+    ay[i] = accY;
+    az[i] = accZ;
+    jx[i] = jerkX;
+    jy[i] = jerkY;
+    jz[i] = jerkZ;
+  }
+}
+
+template <typename Policy>
+void ensembleAccelerationsScalar(const BasicEnsembleArrays<Policy> &systems,
+                                 std::size_t begin, std::size_t end,
+                                 typename Policy::Accumulator *ax,
+                                 typename Policy::Accumulator *ay,
+                                 typename Policy::Accumulator *az) {
+  using Pair = typename Policy::Pair;
+  const std::size_t lanes = BasicEnsembleArrays<Policy>::lanes;
+  const std::size_t bodies = systems.bodiesPerSystem;
+  const auto *x = systems.x, *y = systems.y, *z = systems.z;
+  const Pair *m = systems.mass, *r = systems.radius;
+
+  for (std::size_t block = begin; block < end; ++block) {
+    const std::size_t first = block * bodies * lanes;
+    std::fill(ax + first, ax + first + bodies * lanes, 0);
+    std::fill(ay + first, ay + first + bodies * lanes, 0);
+    std::fill(az + first, az + first + bodies * lanes, 0);
+
+    for (std::size_t i = 0; i < bodies; ++i) {
+      for (std::size_t j = i + 1; j < bodies; ++j) {
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+          const std::size_t a = first + i * lanes + lane;
+          const std::size_t b = first + j * lanes + lane;
+          Pair dx = Pair(x[b] - x[a]), dy = Pair(y[b] - y[a]);
+          Pair dz = Pair(z[b] - z[a]);
+          Pair scale = pairScale(dx * dx + dy * dy + dz * dz, r[a], r[b]);
+          Pair toA = m[b] * scale, toB = m[a] * scale;
+          ax[a] += dx * toA;
+          ay[a] += dy * toA;
+          az[a] += dz * toA;
+          ax[b] -= dx * toB;
+          ay[b] -= dy * toB;
+          az[b] -= dz * toB;
+        }
+      }
+    }
+  }
+}
+
+#define INSTANTIATE_SCALAR_KERNELS(Policy)                                     \
+  template void accelerationsScalar<Policy>(                                   \
+      const BasicBodyArrays<Policy> &, std::size_t, std::size_t,               \
+      Policy::Accumulator *, Policy::Accumulator *, Policy::Accumulator *);    \
+  template void symmetricAccelerationsScalar<Policy>(                          \
+      const BasicBodyArrays<Policy> &, std::size_t, std::size_t, std::size_t,  \
+      std::size_t, Policy::Accumulator *, Policy::Accumulator *,               \
+      Policy::Accumulator *);                                                  \
+  template void targetAccelerationsScalar<Policy>(                             \
+      const BasicBodyArrays<Policy> &, const std::uint32_t *, std::size_t,     \
+      Policy::Accumulator *, Policy::Accumulator *, Policy::Accumulator *);    \
+  template void jerksScalar<Policy>(                                           \
+      const BasicBodyArrays<Policy> &, const Policy::Position *,               \
+      const Policy::Position *, const Policy::Position *,                      \
+      const std::uint32_t *, std::size_t, Policy::Accumulator *,               \
+      Policy::Accumulator *, Policy::Accumulator *, Policy::Accumulator *,     \
+      Policy::Accumulator *, Policy::Accumulator *);                           \
+  template void ensembleAccelerationsScalar<Policy>(                           \
+      const BasicEnsembleArrays<Policy> &, std::size_t, std::size_t,           \
+      Policy::Accumulator *, Policy::Accumulator *, Policy::Accumulator *);
+
+INSTANTIATE_SCALAR_KERNELS(FloatPrecision)
+INSTANTIATE_SCALAR_KERNELS(DoublePrecision)
+INSTANTIATE_SCALAR_KERNELS(MixedPrecision)
+
+// kernels for one policy and instruction set. only float has vector kernels,
+// so this is resolved at compile time and never branches inside a kernel.
+template <typename Policy> struct KernelTable {
+  static BasicAccelerationKernel<Policy> acceleration(SimdLevel) {
+    return accelerationsScalar<Policy>;
+  }
+  static BasicSymmetricKernel<Policy> symmetric(SimdLevel) {
+    return symmetricAccelerationsScalar<Policy>;
+  }
+  static BasicTargetKernel<Policy> target(SimdLevel) {
+    return targetAccelerationsScalar<Policy>;
+  }
+  static BasicJerkKernel<Policy> jerk(SimdLevel) {
+    return jerksScalar<Policy>;
+  }
+  static BasicEnsembleKernel<Policy> ensemble(SimdLevel) {
+    return ensembleAccelerationsScalar<Policy>;
+  }
+};
+
+template <> struct KernelTable<FloatPrecision> {
+  static BasicAccelerationKernel<FloatPrecision>
+  acceleration(SimdLevel level) {
+#if defined(SOLAR_SIM_X86)
+    switch (level) {
+    case SimdLevel::Avx512:
+      return accelerationsAvx512;
+    case SimdLevel::Avx2:
+      return accelerationsAvx2;
+    case SimdLevel::Sse2:
+      return accelerationsSse2;
+    default:
+      break;
+    }
+#endif
+    return accelerationsScalar<FloatPrecision>;
+  }
+
+  static BasicSymmetricKernel<FloatPrecision> symmetric(SimdLevel level) {
+#if defined(SOLAR_SIM_X86)
+    switch (level) {
+    case SimdLevel::Avx512:
+      return symmetricAccelerationsAvx512;
+    case SimdLevel::Avx2:
+      return symmetricAccelerationsAvx2;
+    case SimdLevel::Sse2:
+      return symmetricAccelerationsSse2;
+    default:
+      break;
+    }
+#endif
+    return symmetricAccelerationsScalar<FloatPrecision>;
+  }
+
+  static BasicTargetKernel<FloatPrecision> target(SimdLevel level) {
+#if defined(SOLAR_SIM_X86)
+    switch (level) {
+    case SimdLevel::Avx512:
+      return targetAccelerationsAvx512;
+    case SimdLevel::Avx2:
+      return targetAccelerationsAvx2;
+    case SimdLevel::Sse2:
+      return targetAccelerationsSse2;
+    default:
+      break;
+    }
+#endif
+    return targetAccelerationsScalar<FloatPrecision>;
+  }
+
+  static BasicJerkKernel<FloatPrecision> jerk(SimdLevel level) {
+#if defined(SOLAR_SIM_X86)
+    switch (level) {
+    case SimdLevel::Avx512:
+      return jerksAvx512;
+    case SimdLevel::Avx2:
+      return jerksAvx2;
+    case SimdLevel::Sse2:
+      return jerksSse2;
+    default:
+      break;
+    }
+#endif
+    return jerksScalar<FloatPrecision>;
+  }
+
+  static BasicEnsembleKernel<FloatPrecision> ensemble(SimdLevel level) {
+#if defined(SOLAR_SIM_X86)
+    switch (level) {
+    case SimdLevel::Avx512:
+      return ensembleAccelerationsAvx512;
+    case SimdLevel::Avx2:
+      return ensembleAccelerationsAvx2;
+    case SimdLevel::Sse2:
+      return ensembleAccelerationsSse2;
+    default:
+      break;
+    }
+#endif
+    return ensembleAccelerationsScalar<FloatPrecision>;
+  }
+};
+
+AccelerationKernel getAccelerationKernel(SimdLevel level) {
+  return KernelTable<Precision>::acceleration(level);
+}
+
+SymmetricKernel getSymmetricKernel(SimdLevel level) {
+  return KernelTable<Precision>::symmetric(level);
+}
+
+TargetKernel getTargetKernel(SimdLevel level) {
+  return KernelTable<Precision>::target(level);
+}
+
+JerkKernel getJerkKernel(SimdLevel level) {
+  return KernelTable<Precision>::jerk(level);
+}
+
+EnsembleKernel getEnsembleKernel(SimdLevel level) {
+  return KernelTable<Precision>::ensemble(level);
+}
+
+AccelerationKernel getAccelerationKernel() {
+  static const AccelerationKernel kernel =
+      getAccelerationKernel(detectSimdLevel());
+  return kernel;
+}
+
+SymmetricKernel getSymmetricKernel() {
+  static const SymmetricKernel kernel = getSymmetricKernel(detectSimdLevel());
+  return kernel;
+}
+
+TargetKernel getTargetKernel() {
+  static const TargetKernel kernel = getTargetKernel(detectSimdLevel());
+  return kernel;
+}
+
+JerkKernel getJerkKernel() {
+  static const JerkKernel kernel = getJerkKernel(detectSimdLevel());
+  return kernel;
+}
+
+EnsembleKernel getEnsembleKernel() {
+  static const EnsembleKernel kernel = getEnsembleKernel(detectSimdLevel());
+  return kernel;
+}
+
+void computeAccelerations(BodyStore &bodies) {
+  getAccelerationKernel()(bodies.arrays(), 0, bodies.size(), bodies.ax.data(),
+                          bodies.ay.data(), bodies.az.data());
+}
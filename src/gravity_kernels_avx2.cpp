@@ -0,0 +1,335 @@
+#include <gravity_kernels.h>
+#include <globals.h>
+
+#if defined(SOLAR_SIM_X86)
+#include <immintrin.h>
+
+// rsqrt is good to 12 bits, one newton step brings it close to full precision
+static inline __m256 rsqrtNewton(__m256 value) {
+  __m256 estimate = _mm256_rsqrt_ps(value);
+  __m256 halfValue = _mm256_mul_ps(_mm256_set1_ps(0.5f), value);
+  __m256 square = _mm256_mul_ps(estimate, estimate);
+  return _mm256_mul_ps(
+      estimate, _mm256_fnmadd_ps(halfValue, square, _mm256_set1_ps(1.5f)));
+}
+
+void accelerationsAvx2(const FloatBodyArrays &bodies, std::size_t begin,
+                       std::size_t end, float *ax, float *ay, float *az) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m256 zero = _mm256_setzero_ps();
+
+  for (std::size_t i = begin; i < end; i += 8) {
+    __m256 xi = _mm256_load_ps(x + i);
+    __m256 yi = _mm256_load_ps(y + i);
+    __m256 zi = _mm256_load_ps(z + i);
+    __m256 ri = _mm256_load_ps(r + i);
+    __m256 accX = zero, accY = zero, accZ = zero;
+
+    for (std::size_t j = 0; j < n; ++j) {
+      __m256 dx = _mm256_sub_ps(_mm256_set1_ps(x[j]), xi);
+      __m256 dy = _mm256_sub_ps(_mm256_set1_ps(y[j]), yi);
+      __m256 dz = _mm256_sub_ps(_mm256_set1_ps(z[j]), zi);
+      __m256 distanceSquared = _mm256_fmadd_ps(
+          dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+
+      __m256 minDistance = _mm256_add_ps(ri, _mm256_set1_ps(r[j] + 1.0f));
+      __m256 clamped = _mm256_max_ps(
+          distanceSquared, _mm256_mul_ps(minDistance, minDistance));
+      __m256 inverse = rsqrtNewton(distanceSquared);
+      __m256 inverseClamped = rsqrtNewton(clamped);
+
+      __m256 scale =
+          _mm256_mul_ps(_mm256_set1_ps(gravityScale * m[j]), inverse);
+      scale = _mm256_mul_ps(scale,
+                            _mm256_mul_ps(inverseClamped, inverseClamped));
+      // coincident pairs (the body itself) would give inf * 0
+      scale = _mm256_and_ps(
+          scale, _mm256_cmp_ps(distanceSquared, zero, _CMP_GT_OQ));
+
+      accX = _mm256_fmadd_ps(dx, scale, accX);
+      accY = _mm256_fmadd_ps(dy, scale, accY);
+      accZ = _mm256_fmadd_ps(dz, scale, accZ);
+    }
+
+    _mm256_storeu_ps(ax + i, accX);
+    _mm256_storeu_ps(ay + i, accY);
+    _mm256_storeu_ps(az + i, accZ);
+  }
+}
+
+static inline float horizontalSum(__m256 value) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(value),
+                          _mm256_extractf128_ps(value, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+}
+
+void symmetricAccelerationsAvx2(const FloatBodyArrays &bodies,
+                                std::size_t iBegin, std::size_t iEnd,
+                                std::size_t jBegin, std::size_t jEnd,
+                                float *ax, float *ay, float *az) {
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const bool diagonal = iBegin == jBegin;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 laneIndex = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256 allLanes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  if (iEnd > bodies.count)
+    iEnd = bodies.count;
+
+  for (std::size_t i = iBegin; i < iEnd; ++i) {
+    const __m256 xi = _mm256_set1_ps(x[i]);
+    const __m256 yi = _mm256_set1_ps(y[i]);
+    const __m256 zi = _mm256_set1_ps(z[i]);
+    const __m256 ri = _mm256_set1_ps(r[i] + 1.0f);
+    const __m256 mi = _mm256_set1_ps(m[i]);
+    __m256 accX = zero, accY = zero, accZ = zero;
+
+    // on the diagonal the vector holding i only takes the lanes after it
+    std::size_t j = diagonal ? i & ~std::size_t(7) : jBegin;
+    __m256 lanes =
+        diagonal ? _mm256_cmp_ps(laneIndex,
+                                 _mm256_set1_ps(static_cast<float>(i & 7)),
+                                 _CMP_GT_OQ)
+                 : allLanes;
+    for (; j < jEnd; j += 8, lanes = allLanes) {
+      __m256 dx = _mm256_sub_ps(_mm256_load_ps(x + j), xi);
+      __m256 dy = _mm256_sub_ps(_mm256_load_ps(y + j), yi);
+      __m256 dz = _mm256_sub_ps(_mm256_load_ps(z + j), zi);
+      __m256 distanceSquared = _mm256_fmadd_ps(
+          dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+
+      __m256 minDistance = _mm256_add_ps(ri, _mm256_load_ps(r + j));
+      __m256 clamped = _mm256_max_ps(
+          distanceSquared, _mm256_mul_ps(minDistance, minDistance));
+      __m256 inverse = rsqrtNewton(distanceSquared);
+      __m256 inverseClamped = rsqrtNewton(clamped);
+
+      __m256 scale = _mm256_mul_ps(_mm256_set1_ps(gravityScale), inverse);
+      scale = _mm256_mul_ps(scale,
+                            _mm256_mul_ps(inverseClamped, inverseClamped));
+      __m256 apart = _mm256_and_ps(
+          lanes, _mm256_cmp_ps(distanceSquared, zero, _CMP_GT_OQ));
+      scale = _mm256_and_ps(scale, apart);
+
+      __m256 toI = _mm256_mul_ps(_mm256_load_ps(m + j), scale);
+      accX = _mm256_fmadd_ps(dx, toI, accX);
+      accY = _mm256_fmadd_ps(dy, toI, accY);
+      accZ = _mm256_fmadd_ps(dz, toI, accZ);
+
+      __m256 toJ = _mm256_mul_ps(mi, scale);
+      _mm256_storeu_ps(ax + j,
+                       _mm256_fnmadd_ps(dx, toJ, _mm256_loadu_ps(ax + j)));
+      _mm256_storeu_ps(ay + j,
+                       _mm256_fnmadd_ps(dy, toJ, _mm256_loadu_ps(ay + j)));
+      _mm256_storeu_ps(az + j,
+                       _mm256_fnmadd_ps(dz, toJ, _mm256_loadu_ps(az + j)));
+    }
+
+    ax[i] += horizontalSum(accX);
+    ay[i] += horizontalSum(accY);
+    az[i] += horizontalSum(accZ);
+  }
+}
+
+void targetAccelerationsAvx2(const FloatBodyArrays &bodies,
+                             const std::uint32_t *targets, std::size_t count,
+                             float *ax, float *ay, float *az) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m256 zero = _mm256_setzero_ps();
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    const __m256 xi = _mm256_set1_ps(x[i]);
+    const __m256 yi = _mm256_set1_ps(y[i]);
+    const __m256 zi = _mm256_set1_ps(z[i]);
+    const __m256 ri = _mm256_set1_ps(r[i] + 1.0f);
+    __m256 accX = zero, accY = zero, accZ = zero;
+
+    // partners past n are massless padding
+    for (std::size_t j = 0; j < n; j += 8) {
+      __m256 dx = _mm256_sub_ps(_mm256_load_ps(x + j), xi);
+      __m256 dy = _mm256_sub_ps(_mm256_load_ps(y + j), yi);
+      __m256 dz = _mm256_sub_ps(_mm256_load_ps(z + j), zi);
+      __m256 distanceSquared = _mm256_fmadd_ps(
+          dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+
+      __m256 minDistance = _mm256_add_ps(ri, _mm256_load_ps(r + j));
+      __m256 clamped = _mm256_max_ps(
+          distanceSquared, _mm256_mul_ps(minDistance, minDistance));
+      __m256 inverse = rsqrtNewton(distanceSquared);
+      __m256 inverseClamped = rsqrtNewton(clamped);
+
+      __m256 scale = _mm256_mul_ps(
+          _mm256_mul_ps(_mm256_set1_ps(gravityScale), _mm256_load_ps(m + j)),
+          inverse);
+      scale = _mm256_mul_ps(scale,
+                            _mm256_mul_ps(inverseClamped, inverseClamped));
+      // coincident pairs (the body itself) would give inf * 0
+      scale = _mm256_and_ps(
+          scale, _mm256_cmp_ps(distanceSquared, zero, _CMP_GT_OQ));
+
+      accX = _mm256_fmadd_ps(dx, scale, accX);
+      accY = _mm256_fmadd_ps(dy, scale, accY);
+      accZ = _mm256_fmadd_ps(dz, scale, accZ);
+    }
+
+    ax[i] = horizontalSum(accX);
+    ay[i] = horizontalSum(accY);
+    az[i] = horizontalSum(accZ);
+  }
+}
+
+void jerksAvx2(const FloatBodyArrays &bodies, const float *vx, const float *vy,
+               const float *vz, const std::uint32_t *targets,
+               std::size_t count, float *ax, float *ay, float *az, float *jx,
+               float *jy, float *jz) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    const __m256 xi = _mm256_set1_ps(x[i]);
+    const __m256 yi = _mm256_set1_ps(y[i]);
+    const __m256 zi = _mm256_set1_ps(z[i]);
+    const __m256 vxi = _mm256_set1_ps(vx[i]);
+    const __m256 vyi = _mm256_set1_ps(vy[i]);
+    const __m256 vzi = _mm256_set1_ps(vz[i]);
+    const __m256 ri = _mm256_set1_ps(r[i] + 1.0f);
+    __m256 accX = zero, accY = zero, accZ = zero;
+    __m256 jerkX = zero, jerkY = zero, jerkZ = zero;
+
+    // partners past n are massless padding
+    for (std::size_t j = 0; j < n; j += 8) {
+      __m256 dx = _mm256_sub_ps(_mm256_load_ps(x + j), xi);
+      __m256 dy = _mm256_sub_ps(_mm256_load_ps(y + j), yi);
+      __m256 dz = _mm256_sub_ps(_mm256_load_ps(z + j), zi);
+      __m256 dvx = _mm256_sub_ps(_mm256_load_ps(vx + j), vxi);
+      __m256 dvy = _mm256_sub_ps(_mm256_load_ps(vy + j), vyi);
+      __m256 dvz = _mm256_sub_ps(_mm256_load_ps(vz + j), vzi);
+      __m256 distanceSquared = _mm256_fmadd_ps(
+          dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+      __m256 dot = _mm256_fmadd_ps(
+          dx, dvx, _mm256_fmadd_ps(dy, dvy, _mm256_mul_ps(dz, dvz)));
+
+      __m256 minDistance = _mm256_add_ps(ri, _mm256_load_ps(r + j));
+      __m256 minSquared = _mm256_mul_ps(minDistance, minDistance);
+      __m256 clamped = _mm256_max_ps(distanceSquared, minSquared);
+      __m256 inverse = rsqrtNewton(distanceSquared);
+      __m256 inverseClamped = rsqrtNewton(clamped);
+
+      __m256 scale = _mm256_mul_ps(
+          _mm256_mul_ps(_mm256_set1_ps(gravityScale), _mm256_load_ps(m + j)),
+          inverse);
+      scale = _mm256_mul_ps(scale,
+                            _mm256_mul_ps(inverseClamped, inverseClamped));
+      // coincident pairs (the body itself) would give inf * 0
+      __m256 apart = _mm256_cmp_ps(distanceSquared, zero, _CMP_GT_OQ);
+      scale = _mm256_and_ps(scale, apart);
+
+      // 3 outside the clamp distance, 1 inside
+      __m256 falloff = _mm256_add_ps(
+          one, _mm256_and_ps(two, _mm256_cmp_ps(distanceSquared, minSquared,
+                                                _CMP_GE_OQ)));
+      __m256 radial = _mm256_mul_ps(
+          _mm256_mul_ps(falloff, dot), _mm256_mul_ps(inverse, inverse));
+      radial = _mm256_and_ps(radial, apart);
+
+      accX = _mm256_fmadd_ps(dx, scale, accX);
+      accY = _mm256_fmadd_ps(dy, scale, accY);
+      accZ = _mm256_fmadd_ps(dz, scale, accZ);
+      jerkX = _mm256_fmadd_ps(_mm256_fnmadd_ps(radial, dx, dvx), scale, jerkX);
+      jerkY = _mm256_fmadd_ps(_mm256_fnmadd_ps(radial, dy, dvy), scale, jerkY);
+      jerkZ = _mm256_fmadd_ps(_mm256_fnmadd_ps(radial, dz, dvz), scale, jerkZ);
+    }
+
+    ax[i] = horizontalSum(accX);
+    ay[i] = horizontalSum(accY);
+    az[i] = horizontalSum(accZ);
+    jx[i] = horizontalSum(jerkX);
+    jy[i] = horizontalSum(jerkY);
+    jz[i] = horizontalSum(jerkZ);
+  }
+}
+
+void ensembleAccelerationsAvx2(const FloatEnsembleArrays &systems,
+                               std::size_t begin, std::size_t end, float *ax,
+                               float *ay, float *az) {
+  const std::size_t lanes = FloatEnsembleArrays::lanes;
+  const std::size_t bodies = systems.bodiesPerSystem;
+  const float *x = systems.x, *y = systems.y, *z = systems.z;
+  const float *m = systems.mass, *r = systems.radius;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 gravity = _mm256_set1_ps(gravityScale);
+
+  for (std::size_t block = begin; block < end; ++block) {
+    const std::size_t first = block * bodies * lanes;
+    for (std::size_t k = first; k < first + bodies * lanes; k += 8) {
+      _mm256_store_ps(ax + k, zero);
+      _mm256_store_ps(ay + k, zero);
+      _mm256_store_ps(az + k, zero);
+    }
+
+    for (std::size_t lane = 0; lane < lanes; lane += 8) {
+      for (std::size_t i = 0; i < bodies; ++i) {
+        const std::size_t a = first + i * lanes + lane;
+        __m256 xi = _mm256_load_ps(x + a);
+        __m256 yi = _mm256_load_ps(y + a);
+        __m256 zi = _mm256_load_ps(z + a);
+        __m256 mi = _mm256_load_ps(m + a);
+        __m256 ri = _mm256_add_ps(_mm256_load_ps(r + a), one);
+        __m256 accX = _mm256_load_ps(ax + a);
+        __m256 accY = _mm256_load_ps(ay + a);
+        __m256 accZ = _mm256_load_ps(az + a);
+
+        for (std::size_t j = i + 1; j < bodies; ++j) {
+          const std::size_t b = first + j * lanes + lane;
+          __m256 dx = _mm256_sub_ps(_mm256_load_ps(x + b), xi);
+          __m256 dy = _mm256_sub_ps(_mm256_load_ps(y + b), yi);
+          __m256 dz = _mm256_sub_ps(_mm256_load_ps(z + b), zi);
+          __m256 distanceSquared = _mm256_fmadd_ps(
+              dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+
+          __m256 minDistance = _mm256_add_ps(ri, _mm256_load_ps(r + b));
+          __m256 clamped = _mm256_max_ps(
+              distanceSquared, _mm256_mul_ps(minDistance, minDistance));
+          __m256 inverse = rsqrtNewton(distanceSquared);
+          __m256 inverseClamped = rsqrtNewton(clamped);
+
+          __m256 scale = _mm256_mul_ps(gravity, inverse);
+          scale = _mm256_mul_ps(
+              scale, _mm256_mul_ps(inverseClamped, inverseClamped));
+          // coincident pairs, like two padding bodies, would give inf * 0
+          scale = _mm256_and_ps(
+              scale, _mm256_cmp_ps(distanceSquared, zero, _CMP_GT_OQ));
+          __m256 toI = _mm256_mul_ps(scale, _mm256_load_ps(m + b));
+          __m256 toJ = _mm256_mul_ps(scale, mi);
+
+          accX = _mm256_fmadd_ps(dx, toI, accX);
+          accY = _mm256_fmadd_ps(dy, toI, accY);
+          accZ = _mm256_fmadd_ps(dz, toI, accZ);
+          _mm256_store_ps(ax + b,
+                          _mm256_fnmadd_ps(dx, toJ, _mm256_load_ps(ax + b)));
+          _mm256_store_ps(ay + b,
+                          _mm256_fnmadd_ps(dy, toJ, _mm256_load_ps(ay + b)));
+          _mm256_store_ps(az + b,
+                          _mm256_fnmadd_ps(dz, toJ, _mm256_load_ps(az + b)));
+        }
+
+        _mm256_store_ps(ax + a, accX);
+        _mm256_store_ps(ay + a, accY);
+        _mm256_store_ps(az + a, accZ);
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,320 @@
+#include <gravity_kernels.h>
+#include <globals.h>
+
+#if defined(SOLAR_SIM_X86)
+#include <immintrin.h>
+
+// rsqrt14 is good to 14 bits, one newton step brings it to full precision
+static inline __m512 rsqrtNewton(__m512 value) {
+  __m512 estimate = _mm512_rsqrt14_ps(value);
+  __m512 halfValue = _mm512_mul_ps(_mm512_set1_ps(0.5f), value);
+  __m512 square = _mm512_mul_ps(estimate, estimate);
+  return _mm512_mul_ps(
+      estimate, _mm512_fnmadd_ps(halfValue, square, _mm512_set1_ps(1.5f)));
+}
+
+void accelerationsAvx512(const FloatBodyArrays &bodies, std::size_t begin,
+                         std::size_t end, float *ax, float *ay, float *az) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m512 zero = _mm512_setzero_ps();
+
+  for (std::size_t i = begin; i < end; i += 16) {
+    __m512 xi = _mm512_load_ps(x + i);
+    __m512 yi = _mm512_load_ps(y + i);
+    __m512 zi = _mm512_load_ps(z + i);
+    __m512 ri = _mm512_load_ps(r + i);
+    __m512 accX = zero, accY = zero, accZ = zero;
+
+    for (std::size_t j = 0; j < n; ++j) {
+      __m512 dx = _mm512_sub_ps(_mm512_set1_ps(x[j]), xi);
+      __m512 dy = _mm512_sub_ps(_mm512_set1_ps(y[j]), yi);
+      __m512 dz = _mm512_sub_ps(_mm512_set1_ps(z[j]), zi);
+      __m512 distanceSquared = _mm512_fmadd_ps(
+          dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+
+      __m512 minDistance = _mm512_add_ps(ri, _mm512_set1_ps(r[j] + 1.0f));
+      __m512 clamped = _mm512_max_ps(
+          distanceSquared, _mm512_mul_ps(minDistance, minDistance));
+      __m512 inverse = rsqrtNewton(distanceSquared);
+      __m512 inverseClamped = rsqrtNewton(clamped);
+
+      // coincident pairs (the body itself) would give inf * 0
+      __mmask16 apart =
+          _mm512_cmp_ps_mask(distanceSquared, zero, _CMP_GT_OQ);
+      __m512 scale = _mm512_maskz_mul_ps(
+          apart, _mm512_set1_ps(gravityScale * m[j]), inverse);
+      scale = _mm512_mul_ps(scale,
+                            _mm512_mul_ps(inverseClamped, inverseClamped));
+
+      accX = _mm512_fmadd_ps(dx, scale, accX);
+      accY = _mm512_fmadd_ps(dy, scale, accY);
+      accZ = _mm512_fmadd_ps(dz, scale, accZ);
+    }
+
+    _mm512_storeu_ps(ax + i, accX);
+    _mm512_storeu_ps(ay + i, accY);
+    _mm512_storeu_ps(az + i, accZ);
+  }
+}
+
+void symmetricAccelerationsAvx512(const FloatBodyArrays &bodies,
+                                  std::size_t iBegin, std::size_t iEnd,
+                                  std::size_t jBegin, std::size_t jEnd,
+                                  float *ax, float *ay, float *az) {
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const bool diagonal = iBegin == jBegin;
+  const __m512 zero = _mm512_setzero_ps();
+  if (iEnd > bodies.count)
+    iEnd = bodies.count;
+
+  for (std::size_t i = iBegin; i < iEnd; ++i) {
+    const __m512 xi = _mm512_set1_ps(x[i]);
+    const __m512 yi = _mm512_set1_ps(y[i]);
+    const __m512 zi = _mm512_set1_ps(z[i]);
+    const __m512 ri = _mm512_set1_ps(r[i] + 1.0f);
+    const __m512 mi = _mm512_set1_ps(m[i]);
+    __m512 accX = zero, accY = zero, accZ = zero;
+
+    // on the diagonal the vector holding i only takes the lanes after it
+    std::size_t j = diagonal ? i & ~std::size_t(15) : jBegin;
+    __mmask16 lanes = diagonal ? static_cast<__mmask16>(0xfffe << (i & 15))
+                               : static_cast<__mmask16>(0xffff);
+    for (; j < jEnd; j += 16, lanes = 0xffff) {
+      __m512 dx = _mm512_sub_ps(_mm512_load_ps(x + j), xi);
+      __m512 dy = _mm512_sub_ps(_mm512_load_ps(y + j), yi);
+      __m512 dz = _mm512_sub_ps(_mm512_load_ps(z + j), zi);
+      __m512 distanceSquared = _mm512_fmadd_ps(
+          dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+
+      __m512 minDistance = _mm512_add_ps(ri, _mm512_load_ps(r + j));
+      __m512 clamped = _mm512_max_ps(
+          distanceSquared, _mm512_mul_ps(minDistance, minDistance));
+      __m512 inverse = rsqrtNewton(distanceSquared);
+      __m512 inverseClamped = rsqrtNewton(clamped);
+
+      __mmask16 apart = _mm512_mask_cmp_ps_mask(lanes, distanceSquared, zero,
+                                                _CMP_GT_OQ);
+      __m512 scale = _mm512_maskz_mul_ps(
+          apart, _mm512_set1_ps(gravityScale), inverse);
+      scale = _mm512_mul_ps(scale,
+                            _mm512_mul_ps(inverseClamped, inverseClamped));
+
+      __m512 toI = _mm512_mul_ps(_mm512_load_ps(m + j), scale);
+      accX = _mm512_fmadd_ps(dx, toI, accX);
+      accY = _mm512_fmadd_ps(dy, toI, accY);
+      accZ = _mm512_fmadd_ps(dz, toI, accZ);
+
+      __m512 toJ = _mm512_mul_ps(mi, scale);
+      _mm512_storeu_ps(ax + j,
+                       _mm512_fnmadd_ps(dx, toJ, _mm512_loadu_ps(ax + j)));
+      _mm512_storeu_ps(ay + j,
+                       _mm512_fnmadd_ps(dy, toJ, _mm512_loadu_ps(ay + j)));
+      _mm512_storeu_ps(az + j,
+                       _mm512_fnmadd_ps(dz, toJ, _mm512_loadu_ps(az + j)));
+    }
+
+    ax[i] += _mm512_reduce_add_ps(accX);
+    ay[i] += _mm512_reduce_add_ps(accY);
+    az[i] += _mm512_reduce_add_ps(accZ);
+  }
+}
+
+void targetAccelerationsAvx512(const FloatBodyArrays &bodies,
+                               const std::uint32_t *targets, std::size_t count,
+                               float *ax, float *ay, float *az) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m512 zero = _mm512_setzero_ps();
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    const __m512 xi = _mm512_set1_ps(x[i]);
+    const __m512 yi = _mm512_set1_ps(y[i]);
+    const __m512 zi = _mm512_set1_ps(z[i]);
+    const __m512 ri = _mm512_set1_ps(r[i] + 1.0f);
+    __m512 accX = zero, accY = zero, accZ = zero;
+
+    // partners past n are massless padding
+    for (std::size_t j = 0; j < n; j += 16) {
+      __m512 dx = _mm512_sub_ps(_mm512_load_ps(x + j), xi);
+      __m512 dy = _mm512_sub_ps(_mm512_load_ps(y + j), yi);
+      __m512 dz = _mm512_sub_ps(_mm512_load_ps(z + j), zi);
+      __m512 distanceSquared = _mm512_fmadd_ps(
+          dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+
+      __m512 minDistance = _mm512_add_ps(ri, _mm512_load_ps(r + j));
+      __m512 clamped = _mm512_max_ps(
+          distanceSquared, _mm512_mul_ps(minDistance, minDistance));
+      __m512 inverse = rsqrtNewton(distanceSquared);
+      __m512 inverseClamped = rsqrtNewton(clamped);
+
+      __mmask16 apart =
+          _mm512_cmp_ps_mask(distanceSquared, zero, _CMP_GT_OQ);
+      __m512 scale = _mm512_maskz_mul_ps(
+          apart,
+          _mm512_mul_ps(_mm512_set1_ps(gravityScale), _mm512_load_ps(m + j)),
+          inverse);
+      scale = _mm512_mul_ps(scale,
+                            _mm512_mul_ps(inverseClamped, inverseClamped));
+
+      accX = _mm512_fmadd_ps(dx, scale, accX);
+      accY = _mm512_fmadd_ps(dy, scale, accY);
+      accZ = _mm512_fmadd_ps(dz, scale, accZ);
+    }
+
+    ax[i] = _mm512_reduce_add_ps(accX);
+    ay[i] = _mm512_reduce_add_ps(accY);
+    az[i] = _mm512_reduce_add_ps(accZ);
+  }
+}
+
+void jerksAvx512(const FloatBodyArrays &bodies, const float *vx,
+                 const float *vy, const float *vz,
+                 const std::uint32_t *targets, std::size_t count, float *ax,
+                 float *ay, float *az, float *jx, float *jy, float *jz) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.0f), three = _mm512_set1_ps(3.0f);
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    const __m512 xi = _mm512_set1_ps(x[i]);
+    const __m512 yi = _mm512_set1_ps(y[i]);
+    const __m512 zi = _mm512_set1_ps(z[i]);
+    const __m512 vxi = _mm512_set1_ps(vx[i]);
+    const __m512 vyi = _mm512_set1_ps(vy[i]);
+    const __m512 vzi = _mm512_set1_ps(vz[i]);
+    const __m512 ri = _mm512_set1_ps(r[i] + 1.0f);
+    __m512 accX = zero, accY = zero, accZ = zero;
+    __m512 jerkX = zero, jerkY = zero, jerkZ = zero;
+
+    // partners past n are massless padding
+    for (std::size_t j = 0; j < n; j += 16) {
+      __m512 dx = _mm512_sub_ps(_mm512_load_ps(x + j), xi);
+      __m512 dy = _mm512_sub_ps(_mm512_load_ps(y + j), yi);
+      __m512 dz = _mm512_sub_ps(_mm512_load_ps(z + j), zi);
+      __m512 dvx = _mm512_sub_ps(_mm512_load_ps(vx + j), vxi);
+      __m512 dvy = _mm512_sub_ps(_mm512_load_ps(vy + j), vyi);
+      __m512 dvz = _mm512_sub_ps(_mm512_load_ps(vz + j), vzi);
+      __m512 distanceSquared = _mm512_fmadd_ps(
+          dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+      __m512 dot = _mm512_fmadd_ps(
+          dx, dvx, _mm512_fmadd_ps(dy, dvy, _mm512_mul_ps(dz, dvz)));
+
+      __m512 minDistance = _mm512_add_ps(ri, _mm512_load_ps(r + j));
+      __m512 minSquared = _mm512_mul_ps(minDistance, minDistance);
+      __m512 clamped = _mm512_max_ps(distanceSquared, minSquared);
+      __m512 inverse = rsqrtNewton(distanceSquared);
+      __m512 inverseClamped = rsqrtNewton(clamped);
+
+      __mmask16 apart =
+          _mm512_cmp_ps_mask(distanceSquared, zero, _CMP_GT_OQ);
+      __m512 scale = _mm512_maskz_mul_ps(
+          apart,
+          _mm512_mul_ps(_mm512_set1_ps(gravityScale), _mm512_load_ps(m + j)),
+          inverse);
+      scale = _mm512_mul_ps(scale,
+                            _mm512_mul_ps(inverseClamped, inverseClamped));
+
+      // 3 outside the clamp distance, 1 inside
+      __m512 falloff = _mm512_mask_blend_ps(
+          _mm512_cmp_ps_mask(distanceSquared, minSquared, _CMP_GE_OQ), one,
+          three);
+      __m512 radial = _mm512_maskz_mul_ps(
+          apart, _mm512_mul_ps(falloff, dot), _mm512_mul_ps(inverse, inverse));
+
+      accX = _mm512_fmadd_ps(dx, scale, accX);
+      accY = _mm512_fmadd_ps(dy, scale, accY);
+      accZ = _mm512_fmadd_ps(dz, scale, accZ);
+      jerkX = _mm512_fmadd_ps(_mm512_fnmadd_ps(radial, dx, dvx), scale, jerkX);
+      jerkY = _mm512_fmadd_ps(_mm512_fnmadd_ps(radial, dy, dvy), scale, jerkY);
+      jerkZ = _mm512_fmadd_ps(_mm512_fnmadd_ps(radial, dz, dvz), scale, jerkZ);
+    }
+
+    ax[i] = _mm512_reduce_add_ps(accX);
+    ay[i] = _mm512_reduce_add_ps(accY);
+    az[i] = _mm512_reduce_add_ps(accZ);
+    jx[i] = _mm512_reduce_add_ps(jerkX);
+    jy[i] = _mm512_reduce_add_ps(jerkY);
+    jz[i] = _mm512_reduce_add_ps(jerkZ);
+  }
+}
+
+// the 16 lanes of a block are exactly one register
+void ensembleAccelerationsAvx512(const FloatEnsembleArrays &systems,
+                                 std::size_t begin, std::size_t end,
+                                 float *ax, float *ay, float *az) {
+  const std::size_t lanes = FloatEnsembleArrays::lanes;
+  const std::size_t bodies = systems.bodiesPerSystem;
+  const float *x = systems.x, *y = systems.y, *z = systems.z;
+  const float *m = systems.mass, *r = systems.radius;
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.0f);
+  const __m512 gravity = _mm512_set1_ps(gravityScale);
+
+  for (std::size_t block = begin; block < end; ++block) {
+    const std::size_t first = block * bodies * lanes;
+    for (std::size_t k = first; k < first + bodies * lanes; k += lanes) {
+      _mm512_store_ps(ax + k, zero);
+      _mm512_store_ps(ay + k, zero);
+      _mm512_store_ps(az + k, zero);
+    }
+
+    for (std::size_t i = 0; i < bodies; ++i) {
+      const std::size_t a = first + i * lanes;
+      __m512 xi = _mm512_load_ps(x + a);
+      __m512 yi = _mm512_load_ps(y + a);
+      __m512 zi = _mm512_load_ps(z + a);
+      __m512 mi = _mm512_load_ps(m + a);
+      __m512 ri = _mm512_add_ps(_mm512_load_ps(r + a), one);
+      __m512 accX = _mm512_load_ps(ax + a);
+      __m512 accY = _mm512_load_ps(ay + a);
+      __m512 accZ = _mm512_load_ps(az + a);
+
+      for (std::size_t j = i + 1; j < bodies; ++j) {
+        const std::size_t b = first + j * lanes;
+        __m512 dx = _mm512_sub_ps(_mm512_load_ps(x + b), xi);
+        __m512 dy = _mm512_sub_ps(_mm512_load_ps(y + b), yi);
+        __m512 dz = _mm512_sub_ps(_mm512_load_ps(z + b), zi);
+        __m512 distanceSquared = _mm512_fmadd_ps(
+            dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+
+        __m512 minDistance = _mm512_add_ps(ri, _mm512_load_ps(r + b));
+        __m512 clamped = _mm512_max_ps(
+            distanceSquared, _mm512_mul_ps(minDistance, minDistance));
+        __m512 inverse = rsqrtNewton(distanceSquared);
+        __m512 inverseClamped = rsqrtNewton(clamped);
+
+        // coincident pairs, like two padding bodies, would give inf * 0
+        __mmask16 apart =
+            _mm512_cmp_ps_mask(distanceSquared, zero, _CMP_GT_OQ);
+        __m512 scale = _mm512_maskz_mul_ps(apart, gravity, inverse);
+        scale = _mm512_mul_ps(scale,
+                              _mm512_mul_ps(inverseClamped, inverseClamped));
+        __m512 toI = _mm512_mul_ps(scale, _mm512_load_ps(m + b));
+        __m512 toJ = _mm512_mul_ps(scale, mi);
+
+        accX = _mm512_fmadd_ps(dx, toI, accX);
+        accY = _mm512_fmadd_ps(dy, toI, accY);
+        accZ = _mm512_fmadd_ps(dz, toI, accZ);
+        _mm512_store_ps(ax + b,
+                        _mm512_fnmadd_ps(dx, toJ, _mm512_load_ps(ax + b)));
+        _mm512_store_ps(ay + b,
+                        _mm512_fnmadd_ps(dy, toJ, _mm512_load_ps(ay + b)));
+        _mm512_store_ps(az + b,
+                        _mm512_fnmadd_ps(dz, toJ, _mm512_load_ps(az + b)));
+      }
+
+      _mm512_store_ps(ax + a, accX);
+      _mm512_store_ps(ay + a, accY);
+      _mm512_store_ps(az + a, accZ);
+    }
+  }
+}
+#endif
@@ -0,0 +1,331 @@
+#include <gravity_kernels.h>
+#include <globals.h>
+
+#if defined(SOLAR_SIM_X86)
+#include <emmintrin.h>
+
+// rsqrt is good to 12 bits, one newton step brings it close to full precision
+static inline __m128 rsqrtNewton(__m128 value) {
+  __m128 estimate = _mm_rsqrt_ps(value);
+  __m128 halfValue = _mm_mul_ps(_mm_set1_ps(0.5f), value);
+  __m128 square = _mm_mul_ps(estimate, estimate);
+  __m128 correction =
+      _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(halfValue, square));
+  return _mm_mul_ps(estimate, correction);
+}
+
+void accelerationsSse2(const FloatBodyArrays &bodies, std::size_t begin,
+                       std::size_t end, float *ax, float *ay, float *az) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m128 zero = _mm_setzero_ps();
+
+  for (std::size_t i = begin; i < end; i += 4) {
+    __m128 xi = _mm_load_ps(x + i);
+    __m128 yi = _mm_load_ps(y + i);
+    __m128 zi = _mm_load_ps(z + i);
+    __m128 ri = _mm_load_ps(r + i);
+    __m128 accX = zero, accY = zero, accZ = zero;
+
+    for (std::size_t j = 0; j < n; ++j) {
+      __m128 dx = _mm_sub_ps(_mm_set1_ps(x[j]), xi);
+      __m128 dy = _mm_sub_ps(_mm_set1_ps(y[j]), yi);
+      __m128 dz = _mm_sub_ps(_mm_set1_ps(z[j]), zi);
+      __m128 distanceSquared =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                     _mm_mul_ps(dz, dz));
+
+      __m128 minDistance = _mm_add_ps(ri, _mm_set1_ps(r[j] + 1.0f));
+      __m128 clamped =
+          _mm_max_ps(distanceSquared, _mm_mul_ps(minDistance, minDistance));
+      __m128 inverse = rsqrtNewton(distanceSquared);
+      __m128 inverseClamped = rsqrtNewton(clamped);
+
+      __m128 scale = _mm_mul_ps(_mm_set1_ps(gravityScale * m[j]), inverse);
+      scale = _mm_mul_ps(scale, _mm_mul_ps(inverseClamped, inverseClamped));
+      // coincident pairs (the body itself) would give inf * 0
+      scale = _mm_and_ps(scale, _mm_cmpgt_ps(distanceSquared, zero));
+
+      accX = _mm_add_ps(accX, _mm_mul_ps(dx, scale));
+      accY = _mm_add_ps(accY, _mm_mul_ps(dy, scale));
+      accZ = _mm_add_ps(accZ, _mm_mul_ps(dz, scale));
+    }
+
+    _mm_storeu_ps(ax + i, accX);
+    _mm_storeu_ps(ay + i, accY);
+    _mm_storeu_ps(az + i, accZ);
+  }
+}
+
+static inline float horizontalSum(__m128 value) {
+  __m128 sum = _mm_add_ps(value, _mm_movehl_ps(value, value));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+}
+
+void symmetricAccelerationsSse2(const FloatBodyArrays &bodies,
+                                std::size_t iBegin, std::size_t iEnd,
+                                std::size_t jBegin, std::size_t jEnd,
+                                float *ax, float *ay, float *az) {
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const bool diagonal = iBegin == jBegin;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 laneIndex = _mm_setr_ps(0, 1, 2, 3);
+  const __m128 allLanes = _mm_castsi128_ps(_mm_set1_epi32(-1));
+  if (iEnd > bodies.count)
+    iEnd = bodies.count;
+
+  for (std::size_t i = iBegin; i < iEnd; ++i) {
+    const __m128 xi = _mm_set1_ps(x[i]);
+    const __m128 yi = _mm_set1_ps(y[i]);
+    const __m128 zi = _mm_set1_ps(z[i]);
+    const __m128 ri = _mm_set1_ps(r[i] + 1.0f);
+    const __m128 mi = _mm_set1_ps(m[i]);
+    __m128 accX = zero, accY = zero, accZ = zero;
+
+    // on the diagonal the vector holding i only takes the lanes after it
+    std::size_t j = diagonal ? i & ~std::size_t(3) : jBegin;
+    __m128 lanes =
+        diagonal ? _mm_cmpgt_ps(laneIndex,
+                                _mm_set1_ps(static_cast<float>(i & 3)))
+                 : allLanes;
+    for (; j < jEnd; j += 4, lanes = allLanes) {
+      __m128 dx = _mm_sub_ps(_mm_load_ps(x + j), xi);
+      __m128 dy = _mm_sub_ps(_mm_load_ps(y + j), yi);
+      __m128 dz = _mm_sub_ps(_mm_load_ps(z + j), zi);
+      __m128 distanceSquared =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                     _mm_mul_ps(dz, dz));
+
+      __m128 minDistance = _mm_add_ps(ri, _mm_load_ps(r + j));
+      __m128 clamped =
+          _mm_max_ps(distanceSquared, _mm_mul_ps(minDistance, minDistance));
+      __m128 inverse = rsqrtNewton(distanceSquared);
+      __m128 inverseClamped = rsqrtNewton(clamped);
+
+      __m128 scale = _mm_mul_ps(_mm_set1_ps(gravityScale), inverse);
+      scale = _mm_mul_ps(scale, _mm_mul_ps(inverseClamped, inverseClamped));
+      __m128 apart =
+          _mm_and_ps(lanes, _mm_cmpgt_ps(distanceSquared, zero));
+      scale = _mm_and_ps(scale, apart);
+
+      __m128 toI = _mm_mul_ps(_mm_load_ps(m + j), scale);
+      accX = _mm_add_ps(accX, _mm_mul_ps(dx, toI));
+      accY = _mm_add_ps(accY, _mm_mul_ps(dy, toI));
+      accZ = _mm_add_ps(accZ, _mm_mul_ps(dz, toI));
+
+      __m128 toJ = _mm_mul_ps(mi, scale);
+      _mm_storeu_ps(ax + j,
+                    _mm_sub_ps(_mm_loadu_ps(ax + j), _mm_mul_ps(dx, toJ)));
+      _mm_storeu_ps(ay + j,
+                    _mm_sub_ps(_mm_loadu_ps(ay + j), _mm_mul_ps(dy, toJ)));
+      _mm_storeu_ps(az + j,
+                    _mm_sub_ps(_mm_loadu_ps(az + j), _mm_mul_ps(dz, toJ)));
+    }
+
+    ax[i] += horizontalSum(accX);
+    ay[i] += horizontalSum(accY);
+    az[i] += horizontalSum(accZ);
+  }
+}
+
+void targetAccelerationsSse2(const FloatBodyArrays &bodies,
+                             const std::uint32_t *targets, std::size_t count,
+                             float *ax, float *ay, float *az) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m128 zero = _mm_setzero_ps();
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    const __m128 xi = _mm_set1_ps(x[i]);
+    const __m128 yi = _mm_set1_ps(y[i]);
+    const __m128 zi = _mm_set1_ps(z[i]);
+    const __m128 ri = _mm_set1_ps(r[i] + 1.0f);
+    __m128 accX = zero, accY = zero, accZ = zero;
+
+    // partners past n are massless padding
+    for (std::size_t j = 0; j < n; j += 4) {
+      __m128 dx = _mm_sub_ps(_mm_load_ps(x + j), xi);
+      __m128 dy = _mm_sub_ps(_mm_load_ps(y + j), yi);
+      __m128 dz = _mm_sub_ps(_mm_load_ps(z + j), zi);
+      __m128 distanceSquared =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                     _mm_mul_ps(dz, dz));
+
+      __m128 minDistance = _mm_add_ps(ri, _mm_load_ps(r + j));
+      __m128 clamped =
+          _mm_max_ps(distanceSquared, _mm_mul_ps(minDistance, minDistance));
+      __m128 inverse = rsqrtNewton(distanceSquared);
+      __m128 inverseClamped = rsqrtNewton(clamped);
+
+      __m128 scale = _mm_mul_ps(
+          _mm_mul_ps(_mm_set1_ps(gravityScale), _mm_load_ps(m + j)), inverse);
+      scale = _mm_mul_ps(scale, _mm_mul_ps(inverseClamped, inverseClamped));
+      // coincident pairs (the body itself) would give inf * 0
+      scale = _mm_and_ps(scale, _mm_cmpgt_ps(distanceSquared, zero));
+
+      accX = _mm_add_ps(accX, _mm_mul_ps(dx, scale));
+      accY = _mm_add_ps(accY, _mm_mul_ps(dy, scale));
+      accZ = _mm_add_ps(accZ, _mm_mul_ps(dz, scale));
+    }
+
+    ax[i] = horizontalSum(accX);
+    ay[i] = horizontalSum(accY);
+    az[i] = horizontalSum(accZ);
+  }
+}
+
+void jerksSse2(const FloatBodyArrays &bodies, const float *vx, const float *vy,
+               const float *vz, const std::uint32_t *targets,
+               std::size_t count, float *ax, float *ay, float *az, float *jx,
+               float *jy, float *jz) {
+  const std::size_t n = bodies.count;
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *m = bodies.mass, *r = bodies.radius;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+
+  for (std::size_t k = 0; k < count; ++k) {
+    const std::uint32_t i = targets[k];
+    const __m128 xi = _mm_set1_ps(x[i]);
+    const __m128 yi = _mm_set1_ps(y[i]);
+    const __m128 zi = _mm_set1_ps(z[i]);
+    const __m128 vxi = _mm_set1_ps(vx[i]);
+    const __m128 vyi = _mm_set1_ps(vy[i]);
+    const __m128 vzi = _mm_set1_ps(vz[i]);
+    const __m128 ri = _mm_set1_ps(r[i] + 1.0f);
+    __m128 accX = zero, accY = zero, accZ = zero;
+    __m128 jerkX = zero, jerkY = zero, jerkZ = zero;
+
+    // partners past n are massless padding
+    for (std::size_t j = 0; j < n; j += 4) {
+      __m128 dx = _mm_sub_ps(_mm_load_ps(x + j), xi);
+      __m128 dy = _mm_sub_ps(_mm_load_ps(y + j), yi);
+      __m128 dz = _mm_sub_ps(_mm_load_ps(z + j), zi);
+      __m128 dvx = _mm_sub_ps(_mm_load_ps(vx + j), vxi);
+      __m128 dvy = _mm_sub_ps(_mm_load_ps(vy + j), vyi);
+      __m128 dvz = _mm_sub_ps(_mm_load_ps(vz + j), vzi);
+      __m128 distanceSquared =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                     _mm_mul_ps(dz, dz));
+      __m128 dot =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dvx), _mm_mul_ps(dy, dvy)),
+                     _mm_mul_ps(dz, dvz));
+
+      __m128 minDistance = _mm_add_ps(ri, _mm_load_ps(r + j));
+      __m128 minSquared = _mm_mul_ps(minDistance, minDistance);
+      __m128 clamped = _mm_max_ps(distanceSquared, minSquared);
+      __m128 inverse = rsqrtNewton(distanceSquared);
+      __m128 inverseClamped = rsqrtNewton(clamped);
+
+      __m128 scale = _mm_mul_ps(
+          _mm_mul_ps(_mm_set1_ps(gravityScale), _mm_load_ps(m + j)), inverse);
+      scale = _mm_mul_ps(scale, _mm_mul_ps(inverseClamped, inverseClamped));
+      // coincident pairs (the body itself) would give inf * 0
+      __m128 apart = _mm_cmpgt_ps(distanceSquared, zero);
+      scale = _mm_and_ps(scale, apart);
+
+      // 3 outside the clamp distance, 1 inside
+      __m128 falloff = _mm_add_ps(
+          one, _mm_and_ps(two, _mm_cmpge_ps(distanceSquared, minSquared)));
+      __m128 radial = _mm_and_ps(
+          _mm_mul_ps(_mm_mul_ps(falloff, dot), _mm_mul_ps(inverse, inverse)),
+          apart);
+
+      accX = _mm_add_ps(accX, _mm_mul_ps(dx, scale));
+      accY = _mm_add_ps(accY, _mm_mul_ps(dy, scale));
+      accZ = _mm_add_ps(accZ, _mm_mul_ps(dz, scale));
+      jerkX = _mm_add_ps(
+          jerkX, _mm_mul_ps(_mm_sub_ps(dvx, _mm_mul_ps(radial, dx)), scale));
+      jerkY = _mm_add_ps(
+          jerkY, _mm_mul_ps(_mm_sub_ps(dvy, _mm_mul_ps(radial, dy)), scale));
+      jerkZ = _mm_add_ps(
+          jerkZ, _mm_mul_ps(_mm_sub_ps(dvz, _mm_mul_ps(radial, dz)), scale));
+    }
+
+    ax[i] = horizontalSum(accX);
+    ay[i] = horizontalSum(accY);
+    az[i] = horizontalSum(accZ);
+    jx[i] = horizontalSum(jerkX);
+    jy[i] = horizontalSum(jerkY);
+    jz[i] = horizontalSum(jerkZ);
+  }
+}
+
+void ensembleAccelerationsSse2(const FloatEnsembleArrays &systems,
+                               std::size_t begin, std::size_t end, float *ax,
+                               float *ay, float *az) {
+  const std::size_t lanes = FloatEnsembleArrays::lanes;
+  const std::size_t bodies = systems.bodiesPerSystem;
+  const float *x = systems.x, *y = systems.y, *z = systems.z;
+  const float *m = systems.mass, *r = systems.radius;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 gravity = _mm_set1_ps(gravityScale);
+
+  for (std::size_t block = begin; block < end; ++block) {
+    const std::size_t first = block * bodies * lanes;
+    for (std::size_t k = first; k < first + bodies * lanes; k += 4) {
+      _mm_store_ps(ax + k, zero);
+      _mm_store_ps(ay + k, zero);
+      _mm_store_ps(az + k, zero);
+    }
+
+    for (std::size_t lane = 0; lane < lanes; lane += 4) {
+      for (std::size_t i = 0; i < bodies; ++i) {
+        const std::size_t a = first + i * lanes + lane;
+        __m128 xi = _mm_load_ps(x + a);
+        __m128 yi = _mm_load_ps(y + a);
+        __m128 zi = _mm_load_ps(z + a);
+        __m128 mi = _mm_load_ps(m + a);
+        __m128 ri = _mm_add_ps(_mm_load_ps(r + a), one);
+        __m128 accX = _mm_load_ps(ax + a);
+        __m128 accY = _mm_load_ps(ay + a);
+        __m128 accZ = _mm_load_ps(az + a);
+
+        for (std::size_t j = i + 1; j < bodies; ++j) {
+          const std::size_t b = first + j * lanes + lane;
+          __m128 dx = _mm_sub_ps(_mm_load_ps(x + b), xi);
+          __m128 dy = _mm_sub_ps(_mm_load_ps(y + b), yi);
+          __m128 dz = _mm_sub_ps(_mm_load_ps(z + b), zi);
+          __m128 distanceSquared =
+              _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                         _mm_mul_ps(dz, dz));
+
+          __m128 minDistance = _mm_add_ps(ri, _mm_load_ps(r + b));
+          __m128 clamped = _mm_max_ps(distanceSquared,
+                                      _mm_mul_ps(minDistance, minDistance));
+          __m128 inverse = rsqrtNewton(distanceSquared);
+          __m128 inverseClamped = rsqrtNewton(clamped);
+
+          __m128 scale = _mm_mul_ps(gravity, inverse);
+          scale =
+              _mm_mul_ps(scale, _mm_mul_ps(inverseClamped, inverseClamped));
+          // coincident pairs, like two padding bodies, would give inf * 0
+          scale = _mm_and_ps(scale, _mm_cmpgt_ps(distanceSquared, zero));
+          __m128 toI = _mm_mul_ps(scale, _mm_load_ps(m + b));
+          __m128 toJ = _mm_mul_ps(scale, mi);
+
+          accX = _mm_add_ps(accX, _mm_mul_ps(dx, toI));
+          accY = _mm_add_ps(accY, _mm_mul_ps(dy, toI));
+          accZ = _mm_add_ps(accZ, _mm_mul_ps(dz, toI));
+          _mm_store_ps(ax + b,
+                       _mm_sub_ps(_mm_load_ps(ax + b), _mm_mul_ps(dx, toJ)));
+          _mm_store_ps(ay + b,
+                       _mm_sub_ps(_mm_load_ps(ay + b), _mm_mul_ps(dy, toJ)));
+          _mm_store_ps(az + b,
+                       _mm_sub_ps(_mm_load_ps(az + b), _mm_mul_ps(dz, toJ)));
+        }
+
+        _mm_store_ps(ax + a, accX);
+        _mm_store_ps(ay + a, accY);
+        _mm_store_ps(az + a, accZ);
+      }
+    }
+  }
+}
+#endif
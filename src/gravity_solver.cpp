@@ -0,0 +1,116 @@
+#include <gravity_solver.h>
+#include <barnes_hut.h>
+#include <fast_multipole.h>
+#include <gravity_kernels.h>
+#include <parallel.h>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+using Accumulator = BodyStore::Accumulator;
+
+void DirectGravity::computeAccelerations(BodyStore &bodies) {
+  if (symmetric) {
+    computeSymmetric(bodies);
+    return;
+  }
+
+  AccelerationKernel kernel = getAccelerationKernel();
+  BodyArrays arrays = bodies.arrays();
+  Accumulator *ax = bodies.ax.data(), *ay = bodies.ay.data(),
+              *az = bodies.az.data();
+
+  // chunks stay lane aligned so no two threads write the same vector
+  parallelFor(0, bodies.size(), 4 * BodyStore::laneWidth,
+              [&](std::size_t begin, std::size_t end) {
+                kernel(arrays, begin, end, ax, ay, az);
+              });
+}
+
+void DirectGravity::computeActiveAccelerations(
+    BodyStore &bodies, const std::vector<std::uint32_t> &active) {
+  TargetKernel kernel = getTargetKernel();
+  BodyArrays arrays = bodies.arrays();
+  Accumulator *ax = bodies.ax.data(), *ay = bodies.ay.data(),
+              *az = bodies.az.data();
+
+  parallelFor(0, active.size(), 16, [&](std::size_t begin, std::size_t end) {
+    kernel(arrays, active.data() + begin, end - begin, ax, ay, az);
+  });
+}
+
+void DirectGravity::computeSymmetric(BodyStore &bodies) {
+  if (bodies.empty())
+    return;
+  SymmetricKernel kernel = getSymmetricKernel();
+  BodyArrays arrays = bodies.arrays();
+  const std::size_t padded = bodies.paddedSize();
+  const std::size_t blocks = (padded + tileSize - 1) / tileSize;
+
+  std::vector<std::pair<std::size_t, std::size_t>> tiles;
+  tiles.reserve(blocks * (blocks + 1) / 2);
+  for (std::size_t i = 0; i < blocks; ++i)
+    for (std::size_t j = i; j < blocks; ++j)
+      tiles.emplace_back(i * tileSize, j * tileSize);
+
+  const std::size_t slots =
+      std::min<std::size_t>(getThreadCount(), tiles.size());
+  if (accumulators.size() < 3 * (slots - 1))
+    accumulators.resize(3 * (slots - 1));
+
+  // a slot claims tiles until none are left and only ever writes its own
+  // accumulator, so tiles sharing bodies never race
+  std::atomic<std::size_t> nextTile(0);
+  parallelFor(0, slots, 1, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t slot = begin; slot < end; ++slot) {
+      Accumulator *acc[3] = {bodies.ax.data(), bodies.ay.data(),
+                             bodies.az.data()};
+      for (int axis = 0; axis < 3; ++axis) {
+        if (slot > 0) {
+          AlignedVector<Accumulator> &own =
+              accumulators[3 * (slot - 1) + axis];
+          own.resize(padded);
+          acc[axis] = own.data();
+        }
+        std::fill(acc[axis], acc[axis] + padded, Accumulator(0));
+      }
+
+      for (std::size_t t = nextTile++; t < tiles.size(); t = nextTile++) {
+        std::size_t i = tiles[t].first, j = tiles[t].second;
+        kernel(arrays, i, std::min(i + tileSize, padded), j,
+               std::min(j + tileSize, padded), acc[0], acc[1], acc[2]);
+      }
+    }
+  });
+
+  if (slots < 2)
+    return;
+  Accumulator *ax = bodies.ax.data(), *ay = bodies.ay.data(),
+              *az = bodies.az.data();
+  parallelFor(0, padded, 4096, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t slot = 1; slot < slots; ++slot) {
+      const Accumulator *sx = accumulators[3 * (slot - 1)].data();
+      const Accumulator *sy = accumulators[3 * (slot - 1) + 1].data();
+      const Accumulator *sz = accumulators[3 * (slot - 1) + 2].data();
+      for (std::size_t i = begin; i < end; ++i) {
+        ax[i] += sx[i];
+        ay[i] += sy[i];
+        az[i] += sz[i];
+      }
+    }
+  });
+}
+
+std::unique_ptr<GravitySolver>
+createGravitySolver(const GravitySettings &settings) {
+  switch (settings.method) {
+  case GravityMethod::BarnesHut:
+    return std::make_unique<BarnesHutGravity>(settings.openingAngle,
+                                              settings.quadrupole);
+  case GravityMethod::FastMultipole:
+    return std::make_unique<FastMultipoleGravity>(settings.expansionOrder,
+                                                  settings.openingAngle);
+  default:
+    return std::make_unique<DirectGravity>(settings.symmetric);
+  }
+}
@@ -0,0 +1,110 @@
+#include <hermite_integrator.h>
+#include <gravity_kernels.h>
+#include <parallel.h>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using Position = BodyStore::Position;
+using Accumulator = BodyStore::Accumulator;
+
+static float length(float x, float y, float z) {
+  return std::sqrt(x * x + y * y + z * z);
+}
+
+void HermiteIntegrator::visitState(IntegratorStateVisitor &visitor) {
+  BlockTimestepIntegrator::visitState(visitor);
+  visitor.visit("snap", snap);
+  visitor.visit("crackle", crackle);
+}
+
+void HermiteIntegrator::evaluate(BodyStore &bodies, GravitySolver &,
+                                 bool all) {
+  const std::size_t n = bodies.size();
+  // scratch only, so a restored checkpoint does not bring it along
+  if (newJerkX.size() != n)
+    for (AlignedVector<Accumulator> *field : {&newJerkX, &newJerkY, &newJerkZ})
+      field->assign(n, 0);
+  if (all) {
+    snap.assign(n, 0.0f);
+    crackle.assign(n, 0.0f);
+    everyone.resize(n);
+    std::iota(everyone.begin(), everyone.end(), 0u);
+  }
+
+  const std::vector<std::uint32_t> &targets = all ? everyone : active;
+  const JerkKernel kernel = getJerkKernel();
+  const BodyArrays arrays = bodies.arrays();
+  parallelFor(0, targets.size(), 16, [&](std::size_t begin, std::size_t end) {
+    kernel(arrays, bodies.vx.data(), bodies.vy.data(), bodies.vz.data(),
+           targets.data() + begin, end - begin, bodies.ax.data(),
+           bodies.ay.data(), bodies.az.data(), newJerkX.data(),
+           newJerkY.data(), newJerkZ.data());
+  });
+}
+
+void HermiteIntegrator::initializeBody(const BodyStore &bodies,
+                                       std::size_t i) {
+  ax0[i] = bodies.ax[i];
+  ay0[i] = bodies.ay[i];
+  az0[i] = bodies.az[i];
+  jx[i] = newJerkX[i];
+  jy[i] = newJerkY[i];
+  jz[i] = newJerkZ[i];
+}
+
+void HermiteIntegrator::correctBody(const BodyStore &bodies, std::size_t i,
+                                    Position h) {
+  const Accumulator ax1 = bodies.ax[i], ay1 = bodies.ay[i], az1 = bodies.az[i];
+  const Accumulator jx1 = newJerkX[i], jy1 = newJerkY[i], jz1 = newJerkZ[i];
+  const Position h2 = h / 2, h12 = h * h / 12;
+
+  Position vx1 = vx0[i] + h2 * (ax0[i] + ax1) + h12 * (jx[i] - jx1);
+  Position vy1 = vy0[i] + h2 * (ay0[i] + ay1) + h12 * (jy[i] - jy1);
+  Position vz1 = vz0[i] + h2 * (az0[i] + az1) + h12 * (jz[i] - jz1);
+  x0[i] += h2 * (vx0[i] + vx1) + h12 * (ax0[i] - ax1);
+  y0[i] += h2 * (vy0[i] + vy1) + h12 * (ay0[i] - ay1);
+  z0[i] += h2 * (vz0[i] + vz1) + h12 * (az0[i] - az1);
+  vx0[i] = vx1;
+  vy0[i] = vy1;
+  vz0[i] = vz1;
+
+  // derivatives of the cubic through both accelerations and jerks
+  const float step = static_cast<float>(h);
+  const float hSquared = step * step, hCubed = hSquared * step;
+  float crackleX = (12 * (ax0[i] - ax1) + 6 * step * (jx[i] + jx1)) / hCubed;
+  float crackleY = (12 * (ay0[i] - ay1) + 6 * step * (jy[i] + jy1)) / hCubed;
+  float crackleZ = (12 * (az0[i] - az1) + 6 * step * (jz[i] + jz1)) / hCubed;
+  float snapX =
+      (-6 * (ax0[i] - ax1) - step * (4 * jx[i] + 2 * jx1)) / hSquared +
+      step * crackleX;
+  float snapY =
+      (-6 * (ay0[i] - ay1) - step * (4 * jy[i] + 2 * jy1)) / hSquared +
+      step * crackleY;
+  float snapZ =
+      (-6 * (az0[i] - az1) - step * (4 * jz[i] + 2 * jz1)) / hSquared +
+      step * crackleZ;
+  snap[i] = length(snapX, snapY, snapZ);
+  crackle[i] = length(crackleX, crackleY, crackleZ);
+
+  ax0[i] = ax1;
+  ay0[i] = ay1;
+  az0[i] = az1;
+  jx[i] = jx1;
+  jy[i] = jy1;
+  jz[i] = jz1;
+}
+
+float HermiteIntegrator::wantedStep(std::size_t i, float) const {
+  const float acceleration = length(ax0[i], ay0[i], az0[i]);
+  const float jerk = length(jx[i], jy[i], jz[i]);
+
+  const float denominator = jerk * crackle[i] + snap[i] * snap[i];
+  if (denominator > 0.0f)
+    return std::sqrt(accuracy * (acceleration * snap[i] + jerk * jerk) /
+                     denominator);
+  // first step, before any higher derivative is known
+  if (jerk > 0.0f)
+    return accuracy * acceleration / jerk;
+  return std::numeric_limits<float>::max();
+}
@@ -0,0 +1,111 @@
+#include <integrator.h>
+#include <block_integrator.h>
+#include <hermite_integrator.h>
+#include <parallel.h>
+
+// bodies per chunk for the element-wise updates
+static const std::size_t chunkSize = 4096;
+
+// v += a * dt
+static void kick(BodyStore &bodies, float deltaTime) {
+  parallelFor(0, bodies.size(), chunkSize,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                  bodies.vx[i] += bodies.ax[i] * deltaTime;
+                  bodies.vy[i] += bodies.ay[i] * deltaTime;
+                  bodies.vz[i] += bodies.az[i] * deltaTime;
+                }
+              });
+}
+
+// x += v * dt
+static void drift(BodyStore &bodies, float deltaTime) {
+  parallelFor(0, bodies.size(), chunkSize,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                  bodies.x[i] += bodies.vx[i] * deltaTime;
+                  bodies.y[i] += bodies.vy[i] * deltaTime;
+                  bodies.z[i] += bodies.vz[i] * deltaTime;
+                }
+              });
+}
+
+void EulerIntegrator::step(BodyStore &bodies, GravitySolver &gravity,
+                           float deltaTime) {
+  gravity.computeAccelerations(bodies);
+  kick(bodies, deltaTime);
+  drift(bodies, deltaTime);
+}
+
+void LeapfrogIntegrator::step(BodyStore &bodies, GravitySolver &gravity,
+                              float deltaTime) {
+  if (cachedCount != bodies.size())
+    gravity.computeAccelerations(bodies);
+
+  kick(bodies, 0.5f * deltaTime);
+  drift(bodies, deltaTime);
+  gravity.computeAccelerations(bodies);
+  kick(bodies, 0.5f * deltaTime);
+  cachedCount = bodies.size();
+}
+
+void VelocityVerletIntegrator::step(BodyStore &bodies, GravitySolver &gravity,
+                                    float deltaTime) {
+  if (cachedCount != bodies.size())
+    gravity.computeAccelerations(bodies);
+
+  const float halfSquare = 0.5f * deltaTime * deltaTime;
+  previousX.resize(bodies.size());
+  previousY.resize(bodies.size());
+  previousZ.resize(bodies.size());
+  parallelFor(0, bodies.size(), chunkSize,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                  bodies.x[i] += bodies.vx[i] * deltaTime +
+                                 bodies.ax[i] * halfSquare;
+                  bodies.y[i] += bodies.vy[i] * deltaTime +
+                                 bodies.ay[i] * halfSquare;
+                  bodies.z[i] += bodies.vz[i] * deltaTime +
+                                 bodies.az[i] * halfSquare;
+                  previousX[i] = bodies.ax[i];
+                  previousY[i] = bodies.ay[i];
+                  previousZ[i] = bodies.az[i];
+                }
+              });
+
+  gravity.computeAccelerations(bodies);
+  const float halfStep = 0.5f * deltaTime;
+  parallelFor(0, bodies.size(), chunkSize,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                  bodies.vx[i] += (previousX[i] + bodies.ax[i]) * halfStep;
+                  bodies.vy[i] += (previousY[i] + bodies.ay[i]) * halfStep;
+                  bodies.vz[i] += (previousZ[i] + bodies.az[i]) * halfStep;
+                }
+              });
+  cachedCount = bodies.size();
+}
+
+std::unique_ptr<Integrator> createIntegrator(IntegratorMethod method) {
+  IntegratorSettings settings;
+  settings.method = method;
+  return createIntegrator(settings);
+}
+
+std::unique_ptr<Integrator>
+createIntegrator(const IntegratorSettings &settings) {
+  switch (settings.method) {
+  case IntegratorMethod::Leapfrog:
+    return std::make_unique<LeapfrogIntegrator>();
+  case IntegratorMethod::VelocityVerlet:
+    return std::make_unique<VelocityVerletIntegrator>();
+  case IntegratorMethod::BlockTimestep:
+    return std::make_unique<BlockTimestepIntegrator>(settings.levelCount,
+                                                     settings.accuracy);
+  case IntegratorMethod::Hermite:
+    return std::make_unique<HermiteIntegrator>(settings.levelCount,
+                                               settings.accuracy);
+  default:
+    return std::make_unique<EulerIntegrator>();
+  }
+}
@@ -0,0 +1,204 @@
+#include <job_system.h>
+#include <algorithm>
+
+struct JobState {
+  JobSystem::Job job;
+  // unfinished dependencies, plus one held by submit until it has
+  // registered with all of them
+  std::atomic<std::size_t> pending{1};
+  std::atomic<bool> done{false};
+  std::mutex mutex;
+  // jobs waiting for this one, taken over by whoever finishes it
+  std::vector<std::shared_ptr<JobState>> dependents;
+};
+
+// pool and queue of the worker running on this thread; no pool on threads
+// the pool did not start
+static thread_local const JobSystem *currentPool = nullptr;
+static thread_local std::size_t currentWorker = 0;
+
+bool JobHandle::isDone() const {
+  return !state || state->done.load(std::memory_order_acquire);
+}
+
+JobSystem::JobSystem(unsigned int workerCount) {
+  for (unsigned int i = 0; i < workerCount; ++i)
+    queues.push_back(std::make_unique<Queue>());
+  for (unsigned int i = 0; i < workerCount; ++i)
+    threads.emplace_back([this, i] { workerLoop(i); });
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads)
+    thread.join();
+}
+
+JobSystem &JobSystem::instance() {
+  static JobSystem pool(
+      std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+JobHandle JobSystem::submit(Job job,
+                            std::initializer_list<JobHandle> dependencies) {
+  return submit(std::move(job), dependencies.begin(), dependencies.size());
+}
+
+JobHandle JobSystem::submit(Job job,
+                            const std::vector<JobHandle> &dependencies) {
+  return submit(std::move(job), dependencies.data(), dependencies.size());
+}
+
+JobHandle JobSystem::submit(Job job, const JobHandle *dependencies,
+                            std::size_t dependencyCount) {
+  auto state = std::make_shared<JobState>();
+  state->job = std::move(job);
+
+  for (std::size_t i = 0; i < dependencyCount; ++i) {
+    const std::shared_ptr<JobState> &dependency = dependencies[i].state;
+    if (!dependency)
+      continue;
+    std::lock_guard<std::mutex> lock(dependency->mutex);
+    if (dependency->done.load(std::memory_order_acquire))
+      continue;
+    state->pending.fetch_add(1);
+    dependency->dependents.push_back(state);
+  }
+
+  if (state->pending.fetch_sub(1) == 1)
+    schedule(state);
+  return JobHandle(state);
+}
+
+void JobSystem::schedule(std::shared_ptr<JobState> job) {
+  Queue &queue =
+      currentPool == this ? *queues[currentWorker] : injected;
+  // counted before it can be taken, so the take that follows never brings
+  // queued below zero; a worker woken in between just looks again
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    queued.fetch_add(1);
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(std::move(job));
+  }
+  wake.notify_one();
+}
+
+std::shared_ptr<JobState> JobSystem::take() {
+  std::shared_ptr<JobState> job;
+  auto popBack = [&](Queue &queue) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+      return false;
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+  };
+  auto popFront = [&](Queue &queue) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+      return false;
+    job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    return true;
+  };
+
+  // own work newest first while it is still in cache, then the oldest (and
+  // usually largest) job of anyone else
+  const bool inPool = currentPool == this;
+  const std::size_t self = inPool ? currentWorker : 0;
+  bool found = (inPool && popBack(*queues[self])) || popFront(injected);
+  for (std::size_t k = 1; !found && k <= queues.size(); ++k) {
+    std::size_t victim = (self + k) % queues.size();
+    if (!inPool || victim != self)
+      found = popFront(*queues[victim]);
+  }
+  if (found)
+    queued.fetch_sub(1);
+  return job;
+}
+
+void JobSystem::run(const std::shared_ptr<JobState> &job) {
+  job->job();
+  job->job = nullptr;
+
+  std::vector<std::shared_ptr<JobState>> dependents;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->done.store(true, std::memory_order_release);
+    dependents.swap(job->dependents);
+  }
+  for (std::shared_ptr<JobState> &dependent : dependents)
+    if (dependent->pending.fetch_sub(1) == 1)
+      schedule(std::move(dependent));
+}
+
+bool JobSystem::runOne() {
+  std::shared_ptr<JobState> job = take();
+  if (!job)
+    return false;
+  run(job);
+  return true;
+}
+
+void JobSystem::workerLoop(std::size_t index) {
+  currentPool = this;
+  currentWorker = index;
+  for (;;) {
+    if (runOne())
+      continue;
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+    if (stopping)
+      return;
+  }
+}
+
+void JobSystem::wait(const JobHandle &handle) {
+  while (!handle.isDone())
+    if (!runOne())
+      std::this_thread::yield();
+}
+
+void JobSystem::wait(const std::vector<JobHandle> &handles) {
+  for (const JobHandle &handle : handles)
+    wait(handle);
+}
+
+void JobSystem::parallelFor(
+    std::size_t begin, std::size_t end, std::size_t grain,
+    const std::function<void(std::size_t, std::size_t)> &body) {
+  if (begin >= end)
+    return;
+  grain = std::max<std::size_t>(grain, 1);
+  const std::size_t chunkCount = (end - begin + grain - 1) / grain;
+
+  // chunks are claimed from a shared counter by one runner per thread, so a
+  // runner that got stolen late just finds fewer chunks left
+  std::atomic<std::size_t> nextChunk(0);
+  auto runner = [&] {
+    for (;;) {
+      std::size_t chunk = nextChunk.fetch_add(1);
+      if (chunk >= chunkCount)
+        return;
+      std::size_t chunkBegin = begin + chunk * grain;
+      body(chunkBegin, std::min(chunkBegin + grain, end));
+    }
+  };
+
+  const std::size_t helpers =
+      std::min<std::size_t>(queues.size(), chunkCount - 1);
+  std::vector<JobHandle> handles;
+  handles.reserve(helpers);
+  for (std::size_t i = 0; i < helpers; ++i)
+    handles.push_back(submit(runner));
+  runner();
+  wait(handles);
+}
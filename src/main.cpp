@@ -10,10 +10,15 @@
 #include <string>
 #include <btBulletDynamicsCommon.h>
 #include <iostream>
+#include <memory>
 #include <globals.h>
 #include <starfield.h>
 #include <camera.h>
 #include <window_manager.h>
+#include <body_renderer.h>
+#include <physics_thread.h>
+#include <scene.h>
+#include <snapshot_interpolator.h>
 
 btBroadphaseInterface *broadphase;
 btDefaultCollisionConfiguration *collisionConfig;
@@ -24,6 +29,9 @@ btDiscreteDynamicsWorld *dynamicsWorld;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// steps per second of the physics thread, whatever the frame rate
+const double physicsRate = 60.0;
+
 Camera camera(glm::vec3(-1.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f,
               0.0f);
 
@@ -64,13 +72,31 @@ void cleanupPhysics() {
   delete broadphase;
 }
 
-int main() {
+int main(int argc, char **argv) {
+  // bodies come from the scene file given, or are the single unit sphere at
+  // the origin the window always showed
+  Scene scene;
+  if (argc > 1) {
+    std::string error;
+    if (!loadScene(argv[1], scene, error)) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+  } else {
+    scene.bodies.add(
+        CelestialBody(1.0f, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f)));
+  }
+  std::unique_ptr<GravitySolver> gravity = createGravitySolver(scene.gravity);
+  std::unique_ptr<Integrator> integrator = createIntegrator(scene.integrator);
+
   initPhysics();
   WindowManager windowManager(SCR_WIDTH, SCR_HEIGHT, "Solar Sim", camera);
-  Shader modelShader(RESOURCES_PATH "shaders/sphere.vert",
-                     RESOURCES_PATH "shaders/sphere.frag");
   Shader starfieldShader(RESOURCES_PATH "shaders/starfield.vert",
                          RESOURCES_PATH "shaders/starfield.frag");
+  Shader bodyShader(RESOURCES_PATH "shaders/bodies.vert",
+                    RESOURCES_PATH "shaders/bodies.frag");
+  // projection and view, set once a frame for every shader
+  FrameUniforms frameUniforms;
 
   std::cout << camera.position.x << std::endl;
   std::vector<Mesh> modelMeshes =
@@ -78,6 +104,29 @@ int main() {
 
   Starfield starfield1(10000, 40000.0f);
 
+  // every body is drawn with the sphere model, one instanced draw per mesh
+  BodyRenderer bodyRenderer;
+  const std::size_t sphereModel = bodyRenderer.addModel(modelMeshes);
+
+  // the bullet world and the bodies belong to the physics thread from here
+  // until it stops; the loop below only sees the snapshots it publishes
+  PhysicsThread physics;
+  physics.start(
+      PhysicsSettings{physicsRate},
+      [&](float stepTime) {
+        dynamicsWorld->stepSimulation(stepTime, 1, stepTime);
+        integrator->step(scene.bodies, *gravity, scene.timeStep);
+      },
+      [&](PhysicsSnapshot &snapshot) {
+        snapshot.capture(scene.bodies);
+        btTransform trans;
+        cameraRigidBody->getMotionState()->getWorldTransform(trans);
+        snapshot.cameraPosition =
+            glm::vec3(trans.getOrigin().getX(), trans.getOrigin().getY(),
+                      trans.getOrigin().getZ());
+      });
+
+  SnapshotInterpolator interpolator;
   while (!windowManager.shouldClose()) {
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
@@ -85,39 +134,31 @@ int main() {
 
     windowManager.processInput(deltaTime);
 
-    dynamicsWorld->stepSimulation(deltaTime, 10);
-
-    btTransform trans;
-    cameraRigidBody->getMotionState()->getWorldTransform(trans);
-    camera.position =
-        glm::vec3(trans.getOrigin().getX(), trans.getOrigin().getY(),
-                  trans.getOrigin().getZ());
+    // drawn one physics step behind, between the two newest states, so
+    // frames between steps still move
+    if (physics.update())
+      interpolator.push(physics.latest());
+    const PhysicsSnapshot &state =
+        interpolator.interpolate(physics.getTime() - 1.0 / physicsRate);
+    camera.position = state.cameraPosition;
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_DEPTH_TEST);
 
     glm::mat4 projection = camera.getProjectionMatrix(SCR_WIDTH, SCR_HEIGHT);
     glm::mat4 view = camera.getViewMatrix();
+    frameUniforms.update(projection, view);
 
-    starfield1.render(starfieldShader, projection, view);
-
-    for (Mesh &mesh : modelMeshes) {
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-      model = glm::scale(model, glm::vec3(1.0f));
+    starfield1.render(starfieldShader);
 
-      modelShader.use();
-      modelShader.setMat4("projection", projection);
-      modelShader.setMat4("view", view);
-      modelShader.setMat4("model", model);
-
-      mesh.Draw(modelShader);
-    }
+    bodyRenderer.setInstances(sphereModel, state);
+    bodyRenderer.render(bodyShader);
 
     windowManager.swapBuffers();
     windowManager.pollEvents();
   }
 
+  physics.stop();
   cleanupPhysics();
   return 0;
 }
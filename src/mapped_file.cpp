@@ -0,0 +1,89 @@
+#include <mapped_file.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string &path, MappedFileAccess access,
+                      std::string &error) {
+  close();
+
+#if defined(_WIN32)
+  HANDLE fileHandle = CreateFileA(
+      path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      access == MappedFileAccess::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0,
+      nullptr);
+  LARGE_INTEGER fileSize;
+  if (fileHandle == INVALID_HANDLE_VALUE ||
+      !GetFileSizeEx(fileHandle, &fileSize)) {
+    if (fileHandle != INVALID_HANDLE_VALUE)
+      CloseHandle(fileHandle);
+    error = "could not open " + path;
+    return false;
+  }
+  file = fileHandle;
+  length = static_cast<std::size_t>(fileSize.QuadPart);
+  if (length > 0) {
+    mapping =
+        CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+      bytes = static_cast<const unsigned char *>(
+          MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  }
+#else
+  int descriptor = ::open(path.c_str(), O_RDONLY);
+  struct stat status;
+  if (descriptor < 0 || fstat(descriptor, &status) != 0) {
+    if (descriptor >= 0)
+      ::close(descriptor);
+    error = "could not open " + path;
+    return false;
+  }
+  length = static_cast<std::size_t>(status.st_size);
+  if (length > 0) {
+    void *mapped =
+        mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (mapped != MAP_FAILED) {
+      bytes = static_cast<const unsigned char *>(mapped);
+      madvise(mapped, length,
+              access == MappedFileAccess::Sequential ? MADV_SEQUENTIAL
+                                                     : MADV_WILLNEED);
+    }
+  }
+  ::close(descriptor);
+#endif
+
+  if (!bytes && length > 0) {
+    close();
+    error = "could not map " + path;
+    return false;
+  }
+  opened = true;
+  return true;
+}
+
+void MappedFile::close() {
+#if defined(_WIN32)
+  if (bytes)
+    UnmapViewOfFile(bytes);
+  if (mapping)
+    CloseHandle(mapping);
+  if (file)
+    CloseHandle(file);
+  mapping = nullptr;
+  file = nullptr;
+#else
+  if (bytes)
+    munmap(const_cast<unsigned char *>(bytes), length);
+#endif
+  bytes = nullptr;
+  length = 0;
+  opened = false;
+}
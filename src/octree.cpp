@@ -0,0 +1,247 @@
+#include <octree.h>
+#include <morton.h>
+#include <parallel.h>
+#include <algorithm>
+#include <limits>
+
+void Octree::build(const BodyStore &bodies, std::uint32_t leafCapacity) {
+  const std::size_t n = bodies.size();
+  const std::size_t chunk = 4096;
+  nodes.clear();
+  subtrees.clear();
+  order.resize(n);
+  keys.resize(n);
+  topNodeCount = 0;
+  if (n == 0)
+    return;
+
+  // bounding cube of all bodies
+  std::size_t chunkCount = (n + chunk - 1) / chunk;
+  std::vector<glm::vec3> lows(chunkCount), highs(chunkCount);
+  parallelFor(0, n, chunk, [&](std::size_t begin, std::size_t end) {
+    glm::vec3 low(std::numeric_limits<float>::max());
+    glm::vec3 high(-std::numeric_limits<float>::max());
+    for (std::size_t i = begin; i < end; ++i) {
+      glm::vec3 p(bodies.x[i], bodies.y[i], bodies.z[i]);
+      low = glm::min(low, p);
+      high = glm::max(high, p);
+    }
+    lows[begin / chunk] = low;
+    highs[begin / chunk] = high;
+  });
+  glm::vec3 low = lows[0], high = highs[0];
+  for (std::size_t i = 1; i < chunkCount; ++i) {
+    low = glm::min(low, lows[i]);
+    high = glm::max(high, highs[i]);
+  }
+
+  glm::vec3 extent = high - low;
+  float halfSize =
+      std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-3f)) *
+      0.5f * 1.001f;
+  glm::vec3 center = (low + high) * 0.5f;
+  glm::vec3 corner = center - glm::vec3(halfSize);
+
+  const float cells = static_cast<float>(1u << maxDepth);
+  const float scale = cells / (2.0f * halfSize);
+  parallelFor(0, n, chunk, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      glm::vec3 cell =
+          (glm::vec3(bodies.x[i], bodies.y[i], bodies.z[i]) - corner) * scale;
+      cell = glm::clamp(cell, glm::vec3(0.0f), glm::vec3(cells - 1.0f));
+      std::uint64_t key = mortonKey(static_cast<std::uint64_t>(cell.x),
+                                    static_cast<std::uint64_t>(cell.y),
+                                    static_cast<std::uint64_t>(cell.z));
+      keys[i] = {key, static_cast<std::uint32_t>(i)};
+    }
+  });
+  sortKeys();
+  for (std::size_t i = 0; i < n; ++i)
+    order[i] = keys[i].second;
+
+  OctreeNode root;
+  root.center = center;
+  root.halfSize = halfSize;
+  root.begin = 0;
+  root.end = static_cast<std::uint32_t>(n);
+  root.firstChild = -1;
+  root.childCount = 0;
+  root.depth = 0;
+  nodes.push_back(root);
+
+  // split the top levels serially until there are enough subtrees to keep
+  // every thread busy
+  std::vector<std::uint32_t> frontier{0};
+  const std::size_t wanted = 8 * getThreadCount();
+  while (frontier.size() < wanted) {
+    std::vector<std::uint32_t> next;
+    bool split = false;
+    for (std::uint32_t index : frontier) {
+      if (nodes[index].bodyCount() <= leafCapacity ||
+          nodes[index].depth >= maxDepth) {
+        next.push_back(index);
+        continue;
+      }
+      splitNode(nodes, index);
+      for (std::uint32_t c = 0; c < nodes[index].childCount; ++c)
+        next.push_back(nodes[index].firstChild + c);
+      split = true;
+    }
+    frontier.swap(next);
+    if (!split)
+      break;
+  }
+  topNodeCount = static_cast<std::uint32_t>(nodes.size());
+
+  std::vector<std::vector<OctreeNode>> locals(frontier.size());
+  parallelFor(0, frontier.size(), 1, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      locals[k].push_back(nodes[frontier[k]]);
+      buildSubtree(locals[k], leafCapacity);
+    }
+  });
+
+  // splice the subtrees behind the top levels; local index i > 0 moves to
+  // offset + i - 1
+  for (std::size_t k = 0; k < frontier.size(); ++k) {
+    std::vector<OctreeNode> &local = locals[k];
+    std::int32_t shift = static_cast<std::int32_t>(nodes.size()) - 1;
+    for (OctreeNode &node : local)
+      if (!node.isLeaf())
+        node.firstChild += shift;
+
+    Subtree subtree;
+    subtree.root = frontier[k];
+    subtree.begin = static_cast<std::uint32_t>(nodes.size());
+    nodes[frontier[k]] = local[0];
+    nodes.insert(nodes.end(), local.begin() + 1, local.end());
+    subtree.end = static_cast<std::uint32_t>(nodes.size());
+    subtrees.push_back(subtree);
+  }
+}
+
+void Octree::visitBottomUp(
+    const std::function<void(std::uint32_t)> &visit) const {
+  parallelFor(0, subtrees.size(), 1, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      for (std::uint32_t i = subtrees[k].end; i-- > subtrees[k].begin;)
+        visit(i);
+      visit(subtrees[k].root);
+    }
+  });
+
+  // remaining top-level cells; their children all sit in the top levels
+  for (std::uint32_t i = topNodeCount; i-- > 0;) {
+    const OctreeNode &node = nodes[i];
+    if (!node.isLeaf() &&
+        static_cast<std::uint32_t>(node.firstChild) < topNodeCount)
+      visit(i);
+  }
+}
+
+void Octree::visitTopDown(
+    const std::function<void(std::uint32_t)> &visit) const {
+  for (std::uint32_t i = 0; i < topNodeCount; ++i) {
+    const OctreeNode &node = nodes[i];
+    if (!node.isLeaf() &&
+        static_cast<std::uint32_t>(node.firstChild) < topNodeCount)
+      visit(i);
+  }
+
+  parallelFor(0, subtrees.size(), 1, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      visit(subtrees[k].root);
+      for (std::uint32_t i = subtrees[k].begin; i < subtrees[k].end; ++i)
+        visit(i);
+    }
+  });
+}
+
+void Octree::sortKeys() {
+  const std::size_t n = keys.size();
+  std::size_t parts =
+      std::min<std::size_t>(getThreadCount(), n / 65536 + 1);
+  if (parts <= 1) {
+    std::sort(keys.begin(), keys.end());
+    return;
+  }
+
+  std::vector<std::size_t> bounds(parts + 1);
+  for (std::size_t i = 0; i <= parts; ++i)
+    bounds[i] = n * i / parts;
+
+  parallelFor(0, parts, 1, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i)
+      std::sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1]);
+  });
+
+  for (std::size_t width = 1; width < parts; width *= 2) {
+    std::size_t groups = (parts + 2 * width - 1) / (2 * width);
+    parallelFor(0, groups, 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t g = begin; g < end; ++g) {
+        std::size_t first = g * 2 * width;
+        std::size_t middle = first + width;
+        if (middle >= parts)
+          continue;
+        std::size_t last = std::min(first + 2 * width, parts);
+        std::inplace_merge(keys.begin() + bounds[first],
+                           keys.begin() + bounds[middle],
+                           keys.begin() + bounds[last]);
+      }
+    });
+  }
+}
+
+void Octree::splitNode(std::vector<OctreeNode> &out,
+                       std::uint32_t index) const {
+  const OctreeNode parent = out[index];
+  const std::uint32_t shift = 3 * (maxDepth - 1 - parent.depth);
+  const float childHalf = parent.halfSize * 0.5f;
+  const std::int32_t first = static_cast<std::int32_t>(out.size());
+  std::uint32_t count = 0;
+
+  std::uint32_t cursor = parent.begin;
+  for (std::uint64_t octant = 0; octant < 8; ++octant) {
+    auto last = std::partition_point(
+        keys.begin() + cursor, keys.begin() + parent.end,
+        [&](const std::pair<std::uint64_t, std::uint32_t> &entry) {
+          return ((entry.first >> shift) & 7) <= octant;
+        });
+    std::uint32_t childEnd = static_cast<std::uint32_t>(last - keys.begin());
+    if (childEnd == cursor)
+      continue;
+
+    OctreeNode child;
+    child.center = parent.center +
+                   glm::vec3(octant & 4 ? childHalf : -childHalf,
+                             octant & 2 ? childHalf : -childHalf,
+                             octant & 1 ? childHalf : -childHalf);
+    child.halfSize = childHalf;
+    child.begin = cursor;
+    child.end = childEnd;
+    child.firstChild = -1;
+    child.childCount = 0;
+    child.depth = parent.depth + 1;
+    out.push_back(child);
+    ++count;
+    cursor = childEnd;
+  }
+
+  out[index].firstChild = first;
+  out[index].childCount = count;
+}
+
+void Octree::buildSubtree(std::vector<OctreeNode> &out,
+                          std::uint32_t leafCapacity) const {
+  std::vector<std::uint32_t> stack{0};
+  while (!stack.empty()) {
+    std::uint32_t index = stack.back();
+    stack.pop_back();
+    if (out[index].bodyCount() <= leafCapacity ||
+        out[index].depth >= maxDepth)
+      continue;
+    splitNode(out, index);
+    for (std::uint32_t c = 0; c < out[index].childCount; ++c)
+      stack.push_back(out[index].firstChild + c);
+  }
+}
@@ -0,0 +1,11 @@
+#include <parallel.h>
+#include <job_system.h>
+
+unsigned int getThreadCount() {
+  return JobSystem::instance().getThreadCount();
+}
+
+void parallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                 const std::function<void(std::size_t, std::size_t)> &body) {
+  JobSystem::instance().parallelFor(begin, end, grain, body);
+}
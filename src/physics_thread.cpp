@@ -0,0 +1,101 @@
+#include <physics_thread.h>
+#include <parallel.h>
+#include <algorithm>
+#include <chrono>
+
+// bodies per parallel chunk when capturing
+static const std::size_t captureChunk = 4096;
+
+void PhysicsSnapshot::capture(const BodyStore &bodies) {
+  const std::size_t padded = bodies.paddedSize();
+  x.resize(padded);
+  y.resize(padded);
+  z.resize(padded);
+  radius.resize(padded);
+  bodyCount = bodies.size();
+  parallelFor(0, padded, captureChunk,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                  x[i] = static_cast<float>(bodies.x[i]);
+                  y[i] = static_cast<float>(bodies.y[i]);
+                  z[i] = static_cast<float>(bodies.z[i]);
+                  radius[i] = static_cast<float>(bodies.radius[i]);
+                }
+              });
+}
+
+void PhysicsThread::start(const PhysicsSettings &newSettings,
+                          StepFunction newStep, CaptureFunction newCapture) {
+  stop();
+  settings = newSettings;
+  settings.rate = std::max(settings.rate, 1e-3);
+  settings.maxCatchUpSteps = std::max(settings.maxCatchUpSteps, 1);
+  step = std::move(newStep);
+  capture = std::move(newCapture);
+  stepCount = 0;
+  droppedCount = 0;
+  stopping = false;
+  startTime = std::chrono::steady_clock::now();
+  publish(0.0, 0);
+  worker = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::stop() {
+  if (!worker.joinable())
+    return;
+  stopping = true;
+  worker.join();
+}
+
+double PhysicsThread::getTime() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       startTime)
+      .count();
+}
+
+void PhysicsThread::publish(double time, std::uint64_t steps) {
+  PhysicsSnapshot &snapshot = snapshots.back();
+  capture(snapshot);
+  snapshot.time = time;
+  snapshot.step = steps;
+  snapshots.publish();
+}
+
+void PhysicsThread::run() {
+  using Clock = std::chrono::steady_clock;
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / settings.rate));
+  const float deltaTime = static_cast<float>(1.0 / settings.rate);
+  std::uint64_t steps = 0;
+  // ticks of the fixed clock used up, stepped or dropped, so snapshot times
+  // stay on the wall clock after the thread fell behind
+  std::uint64_t ticks = 0;
+  auto next = startTime + period;
+
+  while (!stopping.load()) {
+    std::this_thread::sleep_until(next);
+    const auto now = Clock::now();
+    // every tick that passed is owed a step, up to the catch up limit
+    int due = 0;
+    while (next <= now && due < settings.maxCatchUpSteps) {
+      next += period;
+      ++due;
+    }
+    if (due == 0)
+      continue;
+    if (next <= now) {
+      const auto behind = (now - next) / period + 1;
+      droppedCount += static_cast<std::uint64_t>(behind);
+      ticks += static_cast<std::uint64_t>(behind);
+      next += behind * period;
+    }
+    ticks += static_cast<std::uint64_t>(due);
+
+    for (int k = 0; k < due && !stopping.load(); ++k) {
+      step(deltaTime);
+      ++steps;
+    }
+    stepCount = steps;
+    publish(ticks / settings.rate, steps);
+  }
+}
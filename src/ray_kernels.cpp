@@ -0,0 +1,124 @@
+#include <ray_kernels.h>
+#include <body_store.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+
+// rays per parallel chunk
+static const std::size_t rayChunk = 64;
+// bodies per tile, 64 KiB of positions and radii
+static const std::size_t bodyTile = 4096;
+
+void RayPacket::add(const glm::vec3 &origin, const glm::vec3 &direction) {
+  const float length = glm::length(direction);
+  const glm::vec3 unit = length > 0.0f ? direction / length : direction;
+  ox.push_back(origin.x);
+  oy.push_back(origin.y);
+  oz.push_back(origin.z);
+  dx.push_back(unit.x);
+  dy.push_back(unit.y);
+  dz.push_back(unit.z);
+}
+
+void RayPacket::clear() {
+  for (AlignedVector<float> *field : {&ox, &oy, &oz, &dx, &dy, &dz})
+    field->clear();
+}
+
+RayArrays RayPacket::arrays() const {
+  return {ox.data(), oy.data(), oz.data(),
+          dx.data(), dy.data(), dz.data(), ox.size()};
+}
+
+template <typename Policy>
+void raySpheresScalar(const BasicBodyArrays<Policy> &bodies,
+                      std::size_t jBegin, std::size_t jEnd,
+                      const RayArrays &rays, std::size_t begin,
+                      std::size_t end, float *distances,
+                      std::uint32_t *hits) {
+  const auto *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const auto *r = bodies.radius;
+  jEnd = std::min(jEnd, bodies.count);
+
+  for (std::size_t k = begin; k < end; ++k) {
+    const double ux = rays.dx[k], uy = rays.dy[k], uz = rays.dz[k];
+    double best = distances[k];
+    std::uint32_t hit = hits[k];
+    for (std::size_t j = jBegin; j < jEnd; ++j) {
+      const double cx = double(x[j]) - rays.ox[k];
+      const double cy = double(y[j]) - rays.oy[k];
+      const double cz = double(z[j]) - rays.oz[k];
+      const double b = cx * ux + cy * uy + cz * uz;
+      const double px = cx - b * ux, py = cy - b * uy, pz = cz - b * uz;
+      const double discriminant =
+          double(r[j]) * r[j] - (px * px + py * py + pz * pz);
+      if (discriminant < 0.0)
+        continue;
+      const double root = std::sqrt(discriminant);
+      const double t = b - root >= 0.0 ? b - root : b + root;
+      if (t >= 0.0 && t < best) {
+        best = t;
+        hit = static_cast<std::uint32_t>(j);
+      }
+    }
+    distances[k] = static_cast<float>(best);
+    hits[k] = hit;
+  }
+}
+
+template void raySpheresScalar<FloatPrecision>(
+    const BasicBodyArrays<FloatPrecision> &, std::size_t, std::size_t,
+    const RayArrays &, std::size_t, std::size_t, float *, std::uint32_t *);
+template void raySpheresScalar<DoublePrecision>(
+    const BasicBodyArrays<DoublePrecision> &, std::size_t, std::size_t,
+    const RayArrays &, std::size_t, std::size_t, float *, std::uint32_t *);
+template void raySpheresScalar<MixedPrecision>(
+    const BasicBodyArrays<MixedPrecision> &, std::size_t, std::size_t,
+    const RayArrays &, std::size_t, std::size_t, float *, std::uint32_t *);
+
+// resolved at compile time like the gravity kernel table
+template <typename Policy> struct RayKernelTable {
+  static BasicRayKernel<Policy> get(SimdLevel) {
+    return raySpheresScalar<Policy>;
+  }
+};
+
+template <> struct RayKernelTable<FloatPrecision> {
+  static BasicRayKernel<FloatPrecision> get(SimdLevel level) {
+#if defined(SOLAR_SIM_X86)
+    switch (level) {
+    case SimdLevel::Avx512:
+      return raySpheresAvx512;
+    case SimdLevel::Avx2:
+      return raySpheresAvx2;
+    case SimdLevel::Sse2:
+      return raySpheresSse2;
+    default:
+      break;
+    }
+#endif
+    return raySpheresScalar<FloatPrecision>;
+  }
+};
+
+RayKernel getRayKernel(SimdLevel level) {
+  return RayKernelTable<Precision>::get(level);
+}
+
+RayKernel getRayKernel() {
+  static const RayKernel kernel = getRayKernel(detectSimdLevel());
+  return kernel;
+}
+
+void castRays(const BodyStore &bodies, const RayArrays &rays, float *distances,
+              std::uint32_t *hits) {
+  const RayKernel kernel = getRayKernel();
+  const BodyArrays arrays = bodies.arrays();
+  std::fill(hits, hits + rays.count, noBodyHit);
+  parallelFor(0, rays.count, rayChunk,
+              [&](std::size_t begin, std::size_t end) {
+                for (std::size_t j = 0; j < arrays.count; j += bodyTile)
+                  kernel(arrays, j, j + bodyTile, rays, begin, end,
+                         distances, hits);
+              });
+}
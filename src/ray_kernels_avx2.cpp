@@ -0,0 +1,114 @@
+#include <ray_kernels.h>
+#include <algorithm>
+
+#if defined(SOLAR_SIM_X86)
+#include <immintrin.h>
+
+// rays tested against every load of bodies
+static const std::size_t rayGroup = 4;
+
+void raySpheresAvx2(const FloatBodyArrays &bodies, std::size_t jBegin,
+                    std::size_t jEnd, const RayArrays &rays,
+                    std::size_t begin, std::size_t end, float *distances,
+                    std::uint32_t *hits) {
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *r = bodies.radius;
+  jEnd = std::min(jEnd, bodies.count);
+  if (jBegin >= jEnd)
+    return;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  for (std::size_t first = begin; first < end; first += rayGroup) {
+    const std::size_t group = std::min(rayGroup, end - first);
+    // rays past the end look no farther than 0, so they never hit
+    float origin[3][rayGroup] = {}, unit[3][rayGroup] = {};
+    __m256 best[rayGroup];
+    __m256i index[rayGroup];
+    for (std::size_t k = 0; k < rayGroup; ++k) {
+      if (k < group) {
+        const std::size_t ray = first + k;
+        origin[0][k] = rays.ox[ray];
+        origin[1][k] = rays.oy[ray];
+        origin[2][k] = rays.oz[ray];
+        unit[0][k] = rays.dx[ray];
+        unit[1][k] = rays.dy[ray];
+        unit[2][k] = rays.dz[ray];
+      }
+      best[k] = _mm256_set1_ps(k < group ? distances[first + k] : 0.0f);
+      index[k] = _mm256_set1_epi32(-1);
+    }
+
+    for (std::size_t j = jBegin; j < jEnd; j += 8) {
+      const __m256 bx = _mm256_load_ps(x + j);
+      const __m256 by = _mm256_load_ps(y + j);
+      const __m256 bz = _mm256_load_ps(z + j);
+      const __m256 rj = _mm256_load_ps(r + j);
+      const __m256 radiusSquared = _mm256_mul_ps(rj, rj);
+      const __m256i ids =
+          _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(j)), laneIndex);
+      // the padding after the last body holds zero radius spheres at the
+      // origin, which a ray through the origin would hit
+      const __m256 inside = _mm256_castsi256_ps(_mm256_cmpgt_epi32(
+          _mm256_set1_epi32(static_cast<int>(jEnd)), ids));
+
+      for (std::size_t k = 0; k < rayGroup; ++k) {
+        const __m256 ux = _mm256_set1_ps(unit[0][k]);
+        const __m256 uy = _mm256_set1_ps(unit[1][k]);
+        const __m256 uz = _mm256_set1_ps(unit[2][k]);
+        const __m256 cx = _mm256_sub_ps(bx, _mm256_set1_ps(origin[0][k]));
+        const __m256 cy = _mm256_sub_ps(by, _mm256_set1_ps(origin[1][k]));
+        const __m256 cz = _mm256_sub_ps(bz, _mm256_set1_ps(origin[2][k]));
+        const __m256 b = _mm256_fmadd_ps(
+            cx, ux, _mm256_fmadd_ps(cy, uy, _mm256_mul_ps(cz, uz)));
+        // offset off the ray, which keeps its digits far from the origin
+        const __m256 px = _mm256_fnmadd_ps(b, ux, cx);
+        const __m256 py = _mm256_fnmadd_ps(b, uy, cy);
+        const __m256 pz = _mm256_fnmadd_ps(b, uz, cz);
+        const __m256 discriminant = _mm256_sub_ps(
+            radiusSquared,
+            _mm256_fmadd_ps(px, px,
+                            _mm256_fmadd_ps(py, py, _mm256_mul_ps(pz, pz))));
+        const __m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+        const __m256 enter = _mm256_sub_ps(b, root);
+        const __m256 t = _mm256_blendv_ps(
+            enter, _mm256_add_ps(b, root),
+            _mm256_cmp_ps(enter, zero, _CMP_LT_OQ));
+
+        __m256 take = _mm256_and_ps(
+            _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ),
+            _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+        take = _mm256_and_ps(take, _mm256_cmp_ps(t, best[k], _CMP_LT_OQ));
+        take = _mm256_and_ps(take, inside);
+        best[k] = _mm256_blendv_ps(best[k], t, take);
+        index[k] = _mm256_castps_si256(
+            _mm256_blendv_ps(_mm256_castsi256_ps(index[k]),
+                             _mm256_castsi256_ps(ids), take));
+      }
+    }
+
+    for (std::size_t k = 0; k < group; ++k) {
+      alignas(32) float laneBest[8];
+      alignas(32) std::uint32_t laneIndexOut[8];
+      _mm256_store_ps(laneBest, best[k]);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(laneIndexOut), index[k]);
+      float distance = distances[first + k];
+      std::uint32_t hit = noBodyHit;
+      for (int lane = 0; lane < 8; ++lane) {
+        if (laneIndexOut[lane] == noBodyHit)
+          continue;
+        if (hit == noBodyHit || laneBest[lane] < distance ||
+            (laneBest[lane] == distance && laneIndexOut[lane] < hit)) {
+          distance = laneBest[lane];
+          hit = laneIndexOut[lane];
+        }
+      }
+      if (hit != noBodyHit) {
+        distances[first + k] = distance;
+        hits[first + k] = hit;
+      }
+    }
+  }
+}
+
+#endif
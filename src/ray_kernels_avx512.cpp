@@ -0,0 +1,113 @@
+#include <ray_kernels.h>
+#include <algorithm>
+
+#if defined(SOLAR_SIM_X86)
+#include <immintrin.h>
+
+// rays tested against every load of bodies
+static const std::size_t rayGroup = 4;
+
+void raySpheresAvx512(const FloatBodyArrays &bodies, std::size_t jBegin,
+                    std::size_t jEnd, const RayArrays &rays,
+                    std::size_t begin, std::size_t end, float *distances,
+                    std::uint32_t *hits) {
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *r = bodies.radius;
+  jEnd = std::min(jEnd, bodies.count);
+  if (jBegin >= jEnd)
+    return;
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512i laneIndex = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                                              10, 11, 12, 13, 14, 15);
+
+  for (std::size_t first = begin; first < end; first += rayGroup) {
+    const std::size_t group = std::min(rayGroup, end - first);
+    // rays past the end look no farther than 0, so they never hit
+    float origin[3][rayGroup] = {}, unit[3][rayGroup] = {};
+    __m512 best[rayGroup];
+    __m512i index[rayGroup];
+    for (std::size_t k = 0; k < rayGroup; ++k) {
+      if (k < group) {
+        const std::size_t ray = first + k;
+        origin[0][k] = rays.ox[ray];
+        origin[1][k] = rays.oy[ray];
+        origin[2][k] = rays.oz[ray];
+        unit[0][k] = rays.dx[ray];
+        unit[1][k] = rays.dy[ray];
+        unit[2][k] = rays.dz[ray];
+      }
+      best[k] = _mm512_set1_ps(k < group ? distances[first + k] : 0.0f);
+      index[k] = _mm512_set1_epi32(-1);
+    }
+
+    for (std::size_t j = jBegin; j < jEnd; j += 16) {
+      const __m512 bx = _mm512_load_ps(x + j);
+      const __m512 by = _mm512_load_ps(y + j);
+      const __m512 bz = _mm512_load_ps(z + j);
+      const __m512 rj = _mm512_load_ps(r + j);
+      const __m512 radiusSquared = _mm512_mul_ps(rj, rj);
+      const __m512i ids =
+          _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(j)), laneIndex);
+      // the padding after the last body holds zero radius spheres at the
+      // origin, which a ray through the origin would hit
+      const __mmask16 inside =
+          jEnd - j >= 16 ? __mmask16(0xffff)
+                         : __mmask16((1u << (jEnd - j)) - 1);
+
+      for (std::size_t k = 0; k < rayGroup; ++k) {
+        const __m512 ux = _mm512_set1_ps(unit[0][k]);
+        const __m512 uy = _mm512_set1_ps(unit[1][k]);
+        const __m512 uz = _mm512_set1_ps(unit[2][k]);
+        const __m512 cx = _mm512_sub_ps(bx, _mm512_set1_ps(origin[0][k]));
+        const __m512 cy = _mm512_sub_ps(by, _mm512_set1_ps(origin[1][k]));
+        const __m512 cz = _mm512_sub_ps(bz, _mm512_set1_ps(origin[2][k]));
+        const __m512 b = _mm512_fmadd_ps(
+            cx, ux, _mm512_fmadd_ps(cy, uy, _mm512_mul_ps(cz, uz)));
+        // offset off the ray, which keeps its digits far from the origin
+        const __m512 px = _mm512_fnmadd_ps(b, ux, cx);
+        const __m512 py = _mm512_fnmadd_ps(b, uy, cy);
+        const __m512 pz = _mm512_fnmadd_ps(b, uz, cz);
+        const __m512 discriminant = _mm512_sub_ps(
+            radiusSquared,
+            _mm512_fmadd_ps(px, px,
+                            _mm512_fmadd_ps(py, py, _mm512_mul_ps(pz, pz))));
+        const __m512 root = _mm512_sqrt_ps(_mm512_max_ps(discriminant, zero));
+        const __m512 enter = _mm512_sub_ps(b, root);
+        const __m512 t = _mm512_mask_blend_ps(
+            _mm512_cmp_ps_mask(enter, zero, _CMP_LT_OQ), enter,
+            _mm512_add_ps(b, root));
+
+        __mmask16 take =
+            _mm512_mask_cmp_ps_mask(inside, discriminant, zero, _CMP_GE_OQ);
+        take = _mm512_mask_cmp_ps_mask(take, t, zero, _CMP_GE_OQ);
+        take = _mm512_mask_cmp_ps_mask(take, t, best[k], _CMP_LT_OQ);
+        best[k] = _mm512_mask_blend_ps(take, best[k], t);
+        index[k] = _mm512_mask_blend_epi32(take, index[k], ids);
+      }
+    }
+
+    for (std::size_t k = 0; k < group; ++k) {
+      alignas(64) float laneBest[16];
+      alignas(64) std::uint32_t laneIndexOut[16];
+      _mm512_store_ps(laneBest, best[k]);
+      _mm512_store_si512(laneIndexOut, index[k]);
+      float distance = distances[first + k];
+      std::uint32_t hit = noBodyHit;
+      for (int lane = 0; lane < 16; ++lane) {
+        if (laneIndexOut[lane] == noBodyHit)
+          continue;
+        if (hit == noBodyHit || laneBest[lane] < distance ||
+            (laneBest[lane] == distance && laneIndexOut[lane] < hit)) {
+          distance = laneBest[lane];
+          hit = laneIndexOut[lane];
+        }
+      }
+      if (hit != noBodyHit) {
+        distances[first + k] = distance;
+        hits[first + k] = hit;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include <ray_kernels.h>
+#include <algorithm>
+
+#if defined(SOLAR_SIM_X86)
+#include <emmintrin.h>
+
+// rays tested against every load of bodies
+static const std::size_t rayGroup = 4;
+
+void raySpheresSse2(const FloatBodyArrays &bodies, std::size_t jBegin,
+                    std::size_t jEnd, const RayArrays &rays,
+                    std::size_t begin, std::size_t end, float *distances,
+                    std::uint32_t *hits) {
+  const float *x = bodies.x, *y = bodies.y, *z = bodies.z;
+  const float *r = bodies.radius;
+  jEnd = std::min(jEnd, bodies.count);
+  if (jBegin >= jEnd)
+    return;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+
+  for (std::size_t first = begin; first < end; first += rayGroup) {
+    const std::size_t group = std::min(rayGroup, end - first);
+    // rays past the end look no farther than 0, so they never hit
+    float origin[3][rayGroup] = {}, unit[3][rayGroup] = {};
+    __m128 best[rayGroup];
+    __m128i index[rayGroup];
+    for (std::size_t k = 0; k < rayGroup; ++k) {
+      if (k < group) {
+        const std::size_t ray = first + k;
+        origin[0][k] = rays.ox[ray];
+        origin[1][k] = rays.oy[ray];
+        origin[2][k] = rays.oz[ray];
+        unit[0][k] = rays.dx[ray];
+        unit[1][k] = rays.dy[ray];
+        unit[2][k] = rays.dz[ray];
+      }
+      best[k] = _mm_set1_ps(k < group ? distances[first + k] : 0.0f);
+      index[k] = _mm_set1_epi32(-1);
+    }
+
+    for (std::size_t j = jBegin; j < jEnd; j += 4) {
+      const __m128 bx = _mm_load_ps(x + j);
+      const __m128 by = _mm_load_ps(y + j);
+      const __m128 bz = _mm_load_ps(z + j);
+      const __m128 rj = _mm_load_ps(r + j);
+      const __m128 radiusSquared = _mm_mul_ps(rj, rj);
+      const __m128i ids =
+          _mm_add_epi32(_mm_set1_epi32(static_cast<int>(j)), laneIndex);
+      // the padding after the last body holds zero radius spheres at the
+      // origin, which a ray through the origin would hit
+      const __m128 inside = _mm_castsi128_ps(
+          _mm_cmpgt_epi32(_mm_set1_epi32(static_cast<int>(jEnd)), ids));
+
+      for (std::size_t k = 0; k < rayGroup; ++k) {
+        const __m128 ux = _mm_set1_ps(unit[0][k]);
+        const __m128 uy = _mm_set1_ps(unit[1][k]);
+        const __m128 uz = _mm_set1_ps(unit[2][k]);
+        const __m128 cx = _mm_sub_ps(bx, _mm_set1_ps(origin[0][k]));
+        const __m128 cy = _mm_sub_ps(by, _mm_set1_ps(origin[1][k]));
+        const __m128 cz = _mm_sub_ps(bz, _mm_set1_ps(origin[2][k]));
+        const __m128 b = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(cx, ux), _mm_mul_ps(cy, uy)),
+            _mm_mul_ps(cz, uz));
+        // offset off the ray, which keeps its digits far from the origin
+        const __m128 px = _mm_sub_ps(cx, _mm_mul_ps(b, ux));
+        const __m128 py = _mm_sub_ps(cy, _mm_mul_ps(b, uy));
+        const __m128 pz = _mm_sub_ps(cz, _mm_mul_ps(b, uz));
+        const __m128 discriminant = _mm_sub_ps(
+            radiusSquared,
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)),
+                       _mm_mul_ps(pz, pz)));
+        const __m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+        const __m128 enter = _mm_sub_ps(b, root);
+        const __m128 behind = _mm_cmplt_ps(enter, zero);
+        const __m128 t = _mm_or_ps(_mm_andnot_ps(behind, enter),
+                                   _mm_and_ps(behind, _mm_add_ps(b, root)));
+
+        __m128 take = _mm_and_ps(_mm_cmpge_ps(discriminant, zero),
+                                 _mm_cmpge_ps(t, zero));
+        take = _mm_and_ps(take, _mm_cmplt_ps(t, best[k]));
+        take = _mm_and_ps(take, inside);
+        best[k] = _mm_or_ps(_mm_andnot_ps(take, best[k]), _mm_and_ps(take, t));
+        const __m128i takeBits = _mm_castps_si128(take);
+        index[k] = _mm_or_si128(_mm_andnot_si128(takeBits, index[k]),
+                                _mm_and_si128(takeBits, ids));
+      }
+    }
+
+    for (std::size_t k = 0; k < group; ++k) {
+      alignas(16) float laneBest[4];
+      alignas(16) std::uint32_t laneIndexOut[4];
+      _mm_store_ps(laneBest, best[k]);
+      _mm_store_si128(reinterpret_cast<__m128i *>(laneIndexOut), index[k]);
+      float distance = distances[first + k];
+      std::uint32_t hit = noBodyHit;
+      for (int lane = 0; lane < 4; ++lane) {
+        if (laneIndexOut[lane] == noBodyHit)
+          continue;
+        if (hit == noBodyHit || laneBest[lane] < distance ||
+            (laneBest[lane] == distance && laneIndexOut[lane] < hit)) {
+          distance = laneBest[lane];
+          hit = laneIndexOut[lane];
+        }
+      }
+      if (hit != noBodyHit) {
+        distances[first + k] = distance;
+        hits[first + k] = hit;
+      }
+    }
+  }
+}
+
+#endif
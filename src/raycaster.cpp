@@ -0,0 +1,52 @@
+#include <raycaster.h>
+#include <cmath>
+
+RayCaster::RayCaster(Camera *camera) : camera(camera) {}
+
+Ray RayCaster::getRayFromScreenCoordinates(float x, float y,
+                                           const glm::mat4 &projection,
+                                           const glm::mat4 &view) {
+  return Ray(camera->position,
+             getRayDirectionFromScreenCoordinates(x, y, projection, view));
+}
+
+// x and y in normalized device coordinates, -1 to 1 across the viewport
+glm::vec3 RayCaster::getRayDirectionFromScreenCoordinates(
+    float x, float y, const glm::mat4 &projection, const glm::mat4 &view) {
+  glm::vec4 eye = glm::inverse(projection) * glm::vec4(x, y, -1.0f, 1.0f);
+  eye = glm::vec4(eye.x, eye.y, -1.0f, 0.0f);
+  return glm::normalize(glm::vec3(glm::inverse(view) * eye));
+}
+
+bool RayCaster::checkRayIntersection(const Ray &ray,
+                                     const CelestialBody &body) {
+  glm::vec3 direction = glm::normalize(ray.direction);
+  glm::vec3 offset = body.position - ray.origin;
+  float along = glm::dot(offset, direction);
+  float squared = glm::dot(offset, offset) - along * along;
+  float radiusSquared = body.radius * body.radius;
+  if (squared > radiusSquared)
+    return false;
+  // in front of the origin, or the origin inside the body
+  return along + std::sqrt(radiusSquared - squared) >= 0.0f;
+}
+
+bool RayCaster::pickClosest(const Ray &ray, const BodyStore &bodies,
+                            const BodyBvh &bvh, BodyHit &hit,
+                            float maxDistance) const {
+  return bvh.closestHit(bodies, ray.origin, ray.direction, maxDistance, hit);
+}
+
+bool RayCaster::pickAny(const Ray &ray, const BodyStore &bodies,
+                        const BodyBvh &bvh, float maxDistance) const {
+  return bvh.anyHit(bodies, ray.origin, ray.direction, maxDistance);
+}
+
+void RayCaster::castRays(const RayPacket &rays, const BodyStore &bodies,
+                         std::vector<float> &distances,
+                         std::vector<std::uint32_t> &hits,
+                         float maxDistance) const {
+  distances.assign(rays.size(), maxDistance);
+  hits.resize(rays.size());
+  ::castRays(bodies, rays.arrays(), distances.data(), hits.data());
+}
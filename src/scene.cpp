@@ -0,0 +1,131 @@
+#include <scene.h>
+#include <catalog.h>
+#include <fstream>
+#include <sstream>
+
+// name -> enum tables, spelled like the getName() of what they create
+static const std::pair<const char *, GravityMethod> gravityNames[] = {
+    {"direct", GravityMethod::Direct},
+    {"barnes-hut", GravityMethod::BarnesHut},
+    {"fmm", GravityMethod::FastMultipole},
+};
+
+static const std::pair<const char *, IntegratorMethod> integratorNames[] = {
+    {"euler", IntegratorMethod::Euler},
+    {"leapfrog", IntegratorMethod::Leapfrog},
+    {"verlet", IntegratorMethod::VelocityVerlet},
+    {"block", IntegratorMethod::BlockTimestep},
+    {"hermite", IntegratorMethod::Hermite},
+};
+
+template <typename Method, std::size_t N>
+static bool lookup(const std::pair<const char *, Method> (&names)[N],
+                   const std::string &name, Method &method) {
+  for (const auto &entry : names) {
+    if (name == entry.first) {
+      method = entry.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+// relative paths in a scene start from the directory of the scene file
+static std::string resolvePath(const std::string &scenePath,
+                               const std::string &path) {
+  if (path.empty() || path[0] == '/' || path[0] == '\\' ||
+      (path.size() > 1 && path[1] == ':'))
+    return path;
+  std::size_t slash = scenePath.find_last_of("/\\");
+  if (slash == std::string::npos)
+    return path;
+  return scenePath.substr(0, slash + 1) + path;
+}
+
+bool loadScene(const std::string &path, Scene &scene, std::string &error) {
+  std::ifstream file(path);
+  if (!file) {
+    error = path + ": cannot open file";
+    return false;
+  }
+
+  scene = Scene();
+  std::string line;
+  for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+    std::size_t comment = line.find('#');
+    if (comment != std::string::npos)
+      line.erase(comment);
+
+    std::istringstream in(line);
+    std::string directive;
+    if (!(in >> directive))
+      continue;
+
+    std::string word;
+    bool valid;
+    if (directive == "body") {
+      // read at the precision of the store, not through CelestialBody's
+      // floats, so double builds keep every digit of the file
+      BodyStore::Pair radius, mass;
+      BodyStore::Position x, y, z, vx, vy, vz;
+      valid = static_cast<bool>(in >> radius >> mass >> x >> y >> z >> vx >>
+                                vy >> vz);
+      if (valid) {
+        BodyStore &bodies = scene.bodies;
+        const std::size_t i = bodies.size();
+        bodies.resize(i + 1);
+        bodies.radius[i] = radius;
+        bodies.mass[i] = mass;
+        bodies.x[i] = x;
+        bodies.y[i] = y;
+        bodies.z[i] = z;
+        bodies.vx[i] = vx;
+        bodies.vy[i] = vy;
+        bodies.vz[i] = vz;
+      }
+    } else if (directive == "catalog") {
+      valid = static_cast<bool>(in >> word);
+      if (valid && !loadCatalog(resolvePath(path, word), scene.bodies, error))
+        return false;
+    } else if (directive == "gravity") {
+      valid = in >> word && lookup(gravityNames, word, scene.gravity.method);
+    } else if (directive == "opening-angle") {
+      valid = static_cast<bool>(in >> scene.gravity.openingAngle);
+    } else if (directive == "quadrupole") {
+      valid = in >> word && (word == "on" || word == "off");
+      scene.gravity.quadrupole = word == "on";
+    } else if (directive == "expansion-order") {
+      valid = static_cast<bool>(in >> scene.gravity.expansionOrder);
+    } else if (directive == "integrator") {
+      valid = in >> word &&
+              lookup(integratorNames, word, scene.integrator.method);
+    } else if (directive == "levels") {
+      valid = static_cast<bool>(in >> scene.integrator.levelCount);
+    } else if (directive == "accuracy") {
+      valid = static_cast<bool>(in >> scene.integrator.accuracy);
+    } else if (directive == "timestep") {
+      valid = in >> scene.timeStep && scene.timeStep > 0.0f;
+    } else {
+      error = path + ":" + std::to_string(lineNumber) +
+              ": unknown directive '" + directive + "'";
+      return false;
+    }
+
+    if (valid && in >> word)
+      valid = false;
+    if (!valid) {
+      error = path + ":" + std::to_string(lineNumber) + ": bad arguments to '" +
+              directive + "'";
+      return false;
+    }
+  }
+
+  // hermite sums the jerk directly along with the forces, so a tree solver
+  // asked for here would never run
+  if (scene.integrator.method == IntegratorMethod::Hermite &&
+      scene.gravity.method != GravityMethod::Direct) {
+    error = path + ": the hermite integrator only runs with gravity direct";
+    return false;
+  }
+  return true;
+}
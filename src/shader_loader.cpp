@@ -2,6 +2,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
 #include <glm/glm.hpp>
 
 Shader::Shader(const char *vertexPath, const char *fragmentPath) {
@@ -50,58 +51,102 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
 
   glDeleteShader(vertex);
   glDeleteShader(fragment);
+
+  reflectUniforms();
+  GLuint frame = glGetUniformBlockIndex(ID, "Frame");
+  if (frame != GL_INVALID_INDEX)
+    glUniformBlockBinding(ID, frame, frameUniformBinding);
+}
+
+void Shader::reflectUniforms() {
+  uniformLocations.clear();
+  GLint count = 0, longest = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+  std::string name(longest > 0 ? longest : 1, '\0');
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(ID, i, static_cast<GLsizei>(name.size()), &length,
+                       &size, &type, &name[0]);
+    std::string uniform = name.substr(0, length);
+    // block members have no location
+    GLint location = glGetUniformLocation(ID, uniform.c_str());
+    if (location < 0)
+      continue;
+    uniformLocations[uniform] = location;
+    // arrays are listed once as name[0] but set by their plain name or by
+    // any element, whose locations need not follow each other
+    if (uniform.size() > 3 &&
+        uniform.compare(uniform.size() - 3, 3, "[0]") == 0) {
+      const std::string array = uniform.substr(0, uniform.size() - 3);
+      uniformLocations[array] = location;
+      for (GLint k = 1; k < size; ++k) {
+        const std::string element = array + "[" + std::to_string(k) + "]";
+        uniformLocations[element] = glGetUniformLocation(ID, element.c_str());
+      }
+    }
+  }
 }
 
 void Shader::use() { glUseProgram(ID); }
 
-void Shader::setBool(const std::string &name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+GLint Shader::getUniformLocation(std::string_view name) const {
+  auto found = uniformLocations.find(name);
+  if (found != uniformLocations.end())
+    return found->second;
+  std::string key(name);
+  GLint location = glGetUniformLocation(ID, key.c_str());
+  uniformLocations.emplace(std::move(key), location);
+  return location;
+}
+
+void Shader::setBool(std::string_view name, bool value) const {
+  glUniform1i(getUniformLocation(name), (int)value);
 }
 
-void Shader::setInt(const std::string &name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setInt(std::string_view name, int value) const {
+  glUniform1i(getUniformLocation(name), value);
 }
 
-void Shader::setFloat(const std::string &name, float value) const {
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setFloat(std::string_view name, float value) const {
+  glUniform1f(getUniformLocation(name), value);
 }
 
-void Shader::setVec2(const std::string &name, const glm::vec2 &value) const {
-  glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::setVec2(std::string_view name, const glm::vec2 &value) const {
+  glUniform2fv(getUniformLocation(name), 1, &value[0]);
 }
-void Shader::setVec2(const std::string &name, float x, float y) const {
-  glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+void Shader::setVec2(std::string_view name, float x, float y) const {
+  glUniform2f(getUniformLocation(name), x, y);
 }
 
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-  glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::setVec3(std::string_view name, const glm::vec3 &value) const {
+  glUniform3fv(getUniformLocation(name), 1, &value[0]);
 }
 
-void Shader::setVec3(const std::string &name, float x, float y, float z) const {
-  glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+void Shader::setVec3(std::string_view name, float x, float y, float z) const {
+  glUniform3f(getUniformLocation(name), x, y, z);
 }
 
-void Shader::setVec4(const std::string &name, const glm::vec4 &value) const {
-  glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::setVec4(std::string_view name, const glm::vec4 &value) const {
+  glUniform4fv(getUniformLocation(name), 1, &value[0]);
 }
-void Shader::setVec4(const std::string &name, float x, float y, float z,
+void Shader::setVec4(std::string_view name, float x, float y, float z,
                      float w) const {
-  glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+  glUniform4f(getUniformLocation(name), x, y, z, w);
 }
 
-void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const {
-  glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                     &mat[0][0]);
+void Shader::setMat2(std::string_view name, const glm::mat2 &mat) const {
+  glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const {
-  glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                     &mat[0][0]);
+void Shader::setMat3(std::string_view name, const glm::mat3 &mat) const {
+  glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                     &mat[0][0]);
+void Shader::setMat4(std::string_view name, const glm::mat4 &mat) const {
+  glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, const std::string &type) {
@@ -130,3 +175,21 @@ void Shader::checkCompileErrors(unsigned int shader, const std::string &type) {
     }
   }
 }
+
+FrameUniforms::FrameUniforms() {
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, frameUniformBinding, buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+FrameUniforms::~FrameUniforms() { glDeleteBuffers(1, &buffer); }
+
+void FrameUniforms::update(const glm::mat4 &projection,
+                           const glm::mat4 &view) {
+  const Block block{projection, view};
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,68 @@
+#include <snapshot_interpolator.h>
+#include <algorithm>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SNAPSHOT_BLEND_SSE2 1
+#endif
+
+// from + alpha * (to - from) over whole lanes. the pass only streams memory,
+// so the sse2 every x86-64 cpu has keeps up with it and no wider kernels are
+// dispatched; unoptimized builds would not vectorize the plain loop.
+static void blend(const float *from, const float *to, float alpha,
+                  float *out, std::size_t begin, std::size_t end) {
+#if defined(SNAPSHOT_BLEND_SSE2)
+  // arrays are 64-byte aligned and padded to whole lanes
+  const __m128 weight = _mm_set1_ps(alpha);
+  for (std::size_t i = begin; i < end; i += 4) {
+    const __m128 a = _mm_load_ps(from + i);
+    const __m128 b = _mm_load_ps(to + i);
+    _mm_store_ps(out + i,
+                 _mm_add_ps(a, _mm_mul_ps(weight, _mm_sub_ps(b, a))));
+  }
+#else
+  for (std::size_t i = begin; i < end; ++i)
+    out[i] = from[i] + alpha * (to[i] - from[i]);
+#endif
+}
+
+void SnapshotInterpolator::push(const PhysicsSnapshot &snapshot) {
+  std::swap(previous, next);
+  next = snapshot;
+  if (pushed++ == 0)
+    previous = snapshot;
+}
+
+float SnapshotInterpolator::getAlpha(double time) const {
+  const double span = next.time - previous.time;
+  if (!(span > 0.0))
+    return 1.0f;
+  return static_cast<float>(
+      std::min(std::max((time - previous.time) / span, 0.0), 1.0));
+}
+
+const PhysicsSnapshot &SnapshotInterpolator::interpolate(double time) {
+  if (previous.bodyCount != next.bodyCount)
+    return next;
+  const float alpha = getAlpha(time);
+  // padding is blended too, so the pass runs whole lanes. it stays on the
+  // render thread: waiting on the shared pool could pick up chunks of the
+  // physics thread's force pass and hold the frame until it is done.
+  const std::size_t padded = next.x.size();
+  blended.x.resize(padded);
+  blended.y.resize(padded);
+  blended.z.resize(padded);
+  blended.radius.resize(padded);
+  blended.bodyCount = next.bodyCount;
+  blend(previous.x.data(), next.x.data(), alpha, blended.x.data(), 0, padded);
+  blend(previous.y.data(), next.y.data(), alpha, blended.y.data(), 0, padded);
+  blend(previous.z.data(), next.z.data(), alpha, blended.z.data(), 0, padded);
+  blend(previous.radius.data(), next.radius.data(), alpha,
+        blended.radius.data(), 0, padded);
+  blended.cameraPosition =
+      glm::mix(previous.cameraPosition, next.cameraPosition, alpha);
+  blended.time = previous.time + alpha * (next.time - previous.time);
+  blended.step = next.step;
+  return blended;
+}
@@ -74,15 +74,13 @@ void Sphere::generateSphere() {
   glBindVertexArray(0);
 }
 
-void Sphere::render(glm::mat4 projection, glm::mat4 view, glm::vec3 position) {
+void Sphere::render(glm::vec3 position) {
   if (sphereShader) {
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, position);
     model = glm::scale(model, glm::vec3(1.0f));
 
     sphereShader->use();
-    sphereShader->setMat4("projection", projection);
-    sphereShader->setMat4("view", view);
     sphereShader->setMat4("model", model);
 
     glBindVertexArray(sphereVAO);
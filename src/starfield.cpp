@@ -49,11 +49,8 @@ void Starfield::generateStars() {
   glEnableVertexAttribArray(1);
 }
 
-void Starfield::render(Shader &shader, const glm::mat4 &projection,
-                       const glm::mat4 &viewMatrix) {
+void Starfield::render(Shader &shader) {
   shader.use();
-  shader.setMat4("projection", projection);
-  shader.setMat4("view", viewMatrix);
 
   glBindVertexArray(VAO);
   glDrawArrays(GL_POINTS, 0, numPoints);
@@ -0,0 +1,449 @@
+#include <trajectory_codec.h>
+#include <parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+// rANS with 32 bit state, byte wise renormalization and 12 bit frequencies
+static const unsigned probabilityBits = 12;
+static const std::uint32_t probabilityScale = 1u << probabilityBits;
+static const std::uint32_t ransLow = 1u << 23;
+// bit lengths of residuals below 2^32
+static const unsigned maxSymbols = 33;
+
+struct TrajectoryBox {
+  double origin[3];
+  double scale[3];
+};
+
+template <typename T>
+static void append(std::vector<unsigned char> &out, const T &value) {
+  const std::size_t at = out.size();
+  out.resize(at + sizeof(T));
+  std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+template <typename T>
+static bool read(const unsigned char *&data, const unsigned char *end,
+                 T &value) {
+  if (static_cast<std::size_t>(end - data) < sizeof(T))
+    return false;
+  std::memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  return true;
+}
+
+static unsigned bitLength(std::uint32_t value) {
+  unsigned length = 0;
+  while (value) {
+    ++length;
+    value >>= 1;
+  }
+  return length;
+}
+
+static std::uint32_t zigzag(std::int64_t value) {
+  return static_cast<std::uint32_t>(value < 0 ? -2 * value - 1 : 2 * value);
+}
+
+static std::int64_t unzigzag(std::uint32_t value) {
+  return value & 1 ? -static_cast<std::int64_t>(value >> 1) - 1
+                   : static_cast<std::int64_t>(value >> 1);
+}
+
+static std::uint32_t maxQuantized(unsigned bits) {
+  return (std::uint32_t(1) << bits) - 1;
+}
+
+// gives every symbol that occurs a share of probabilityScale, at least one
+static void normalizeFrequencies(const std::uint32_t *counts,
+                                 std::size_t total, unsigned symbolCount,
+                                 std::uint16_t *frequencies) {
+  std::int64_t sum = 0;
+  unsigned largest = 0;
+  for (unsigned s = 0; s < symbolCount; ++s) {
+    std::uint64_t share =
+        std::uint64_t(counts[s]) * probabilityScale / total;
+    frequencies[s] = static_cast<std::uint16_t>(
+        counts[s] ? std::max<std::uint64_t>(share, 1) : 0);
+    sum += frequencies[s];
+    if (counts[s] > counts[largest])
+      largest = s;
+  }
+  // rounding is settled by the most frequent symbol, which can afford it
+  frequencies[largest] = static_cast<std::uint16_t>(
+      frequencies[largest] + (std::int64_t(probabilityScale) - sum));
+}
+
+TrajectoryEncoder::TrajectoryEncoder(const TrajectoryCodecSettings &options)
+    : settings(options) {
+  settings.bits = std::min(std::max(settings.bits, 8u), 24u);
+  settings.keyframeInterval =
+      std::max<std::size_t>(settings.keyframeInterval, 1);
+}
+
+bool TrajectoryEncoder::quantize(const BodyStore::Position *values,
+                                 int axis) {
+  std::vector<std::int32_t> &quantized = history[axis][0];
+  quantized.resize(bodyCount);
+  const double top = maxQuantized(settings.bits);
+  const double inverse = 1.0 / scale[axis];
+  bool inside = true;
+  for (std::size_t i = 0; i < bodyCount; ++i) {
+    double step = (double(values[i]) - origin[axis]) * inverse;
+    if (!(step >= 0.0 && step <= top)) {
+      inside = false;
+      step = step > top ? top : 0.0;
+    }
+    quantized[i] = static_cast<std::int32_t>(step + 0.5);
+  }
+  return inside;
+}
+
+void TrajectoryEncoder::fitBox(std::size_t count,
+                               const BodyStore::Position *const *axes) {
+  double low[3], high[3], extent = 0.0;
+  for (int axis = 0; axis < 3; ++axis) {
+    low[axis] = high[axis] = 0.0;
+    bool any = false;
+    for (std::size_t i = 0; i < count; ++i) {
+      double value = axes[axis][i];
+      if (!std::isfinite(value))
+        continue;
+      low[axis] = any ? std::min(low[axis], value) : value;
+      high[axis] = any ? std::max(high[axis], value) : value;
+      any = true;
+    }
+    extent = std::max(extent, high[axis] - low[axis]);
+  }
+  if (!(extent > 0.0))
+    extent = 1.0;
+
+  // a quarter of the largest extent on every side, flat axes included, so
+  // the bodies move for a while before one leaves the box
+  const double margin = extent / 4;
+  for (int axis = 0; axis < 3; ++axis) {
+    origin[axis] = low[axis] - margin;
+    scale[axis] = (high[axis] - low[axis] + 2 * margin) /
+                  maxQuantized(settings.bits);
+  }
+}
+
+void TrajectoryEncoder::encode(std::uint64_t step, double time,
+                               std::size_t count,
+                               const BodyStore::Position *x,
+                               const BodyStore::Position *y,
+                               const BodyStore::Position *z,
+                               const std::uint32_t *id,
+                               std::vector<unsigned char> &out) {
+  const BodyStore::Position *axes[3] = {x, y, z};
+  bool keyframe = chunkFrames == 0 ||
+                  chunkFrames >= settings.keyframeInterval ||
+                  count != bodyCount || !std::equal(id, id + count, ids.data());
+  for (int axis = 0; axis < 3; ++axis) {
+    std::swap(history[axis][2], history[axis][1]);
+    std::swap(history[axis][1], history[axis][0]);
+  }
+  for (int axis = 0; axis < 3 && !keyframe; ++axis)
+    keyframe = !quantize(axes[axis], axis);
+  if (keyframe) {
+    chunkFrames = 0;
+    bodyCount = count;
+    ids.assign(id, id + count);
+    fitBox(count, axes);
+    for (int axis = 0; axis < 3; ++axis)
+      quantize(axes[axis], axis);
+  }
+
+  const std::size_t start = out.size();
+  out.resize(start + sizeof(TrajectoryFrameHeader));
+  if (keyframe) {
+    TrajectoryBox box;
+    std::memcpy(box.origin, origin, sizeof(origin));
+    std::memcpy(box.scale, scale, sizeof(scale));
+    append(out, box);
+    const auto *bytes = reinterpret_cast<const unsigned char *>(ids.data());
+    out.insert(out.end(), bytes, bytes + count * sizeof(std::uint32_t));
+  }
+  for (int axis = 0; axis < 3; ++axis)
+    encodeColumn(axis, keyframe, out);
+
+  TrajectoryFrameHeader header;
+  header.step = step;
+  header.time = time;
+  header.bodyCount = count;
+  header.size = static_cast<std::uint32_t>(out.size() - start -
+                                           sizeof(TrajectoryFrameHeader));
+  header.flags = keyframe ? keyframeFlag : 0;
+  std::memcpy(out.data() + start, &header, sizeof(header));
+  ++chunkFrames;
+}
+
+void TrajectoryEncoder::encodeColumn(int axis, bool keyframe,
+                                     std::vector<unsigned char> &out) {
+  const std::vector<std::int32_t> &current = history[axis][0];
+  const std::vector<std::int32_t> &previous = history[axis][1];
+  const std::vector<std::int32_t> &before = history[axis][2];
+  const std::size_t n = bodyCount;
+  residuals.resize(n);
+  symbols.resize(n);
+
+  std::uint32_t counts[maxSymbols] = {};
+  for (std::size_t i = 0; i < n; ++i) {
+    std::uint32_t value;
+    if (keyframe)
+      value = static_cast<std::uint32_t>(current[i]);
+    else if (chunkFrames == 1)
+      value = zigzag(std::int64_t(current[i]) - previous[i]);
+    else
+      value = zigzag(std::int64_t(current[i]) - 2 * std::int64_t(previous[i]) +
+                     before[i]);
+    residuals[i] = value;
+    symbols[i] = static_cast<unsigned char>(bitLength(value));
+    ++counts[symbols[i]];
+  }
+
+  unsigned symbolCount = 0;
+  for (unsigned s = 0; s < maxSymbols; ++s)
+    if (counts[s])
+      symbolCount = s + 1;
+  std::uint16_t frequencies[maxSymbols] = {};
+  std::uint32_t cumulative[maxSymbols] = {};
+  if (n > 0)
+    normalizeFrequencies(counts, n, symbolCount, frequencies);
+  for (unsigned s = 1; s < symbolCount; ++s)
+    cumulative[s] = cumulative[s - 1] + frequencies[s - 1];
+
+  append(out, static_cast<std::uint8_t>(symbolCount));
+  for (unsigned s = 0; s < symbolCount; ++s)
+    append(out, frequencies[s]);
+  const std::size_t segments = (n + segmentBodies - 1) / segmentBodies;
+  const std::size_t table = out.size();
+  out.resize(table + segments * 2 * sizeof(std::uint32_t));
+
+  for (std::size_t segment = 0; segment < segments; ++segment) {
+    const std::size_t begin = segment * segmentBodies;
+    const std::size_t end = std::min(n, begin + segmentBodies);
+
+    // rANS runs backwards, so the decoder reads the symbols forwards
+    encoded.clear();
+    std::uint32_t state = ransLow;
+    for (std::size_t i = end; i-- > begin;) {
+      const std::uint32_t frequency = frequencies[symbols[i]];
+      const std::uint32_t limit =
+          ((ransLow >> probabilityBits) << 8) * frequency;
+      while (state >= limit) {
+        encoded.push_back(static_cast<unsigned char>(state & 0xff));
+        state >>= 8;
+      }
+      state = ((state / frequency) << probabilityBits) + state % frequency +
+              cumulative[symbols[i]];
+    }
+    for (int shift = 0; shift < 32; shift += 8)
+      encoded.push_back(static_cast<unsigned char>(state >> shift));
+    std::reverse(encoded.begin(), encoded.end());
+    const std::uint32_t symbolBytes =
+        static_cast<std::uint32_t>(encoded.size());
+    out.insert(out.end(), encoded.begin(), encoded.end());
+
+    // the bits below the leading one, least significant first
+    const std::size_t bitStart = out.size();
+    std::uint64_t pending = 0;
+    unsigned pendingBits = 0;
+    for (std::size_t i = begin; i < end; ++i) {
+      if (symbols[i] < 2)
+        continue;
+      const unsigned length = symbols[i] - 1u;
+      pending |= std::uint64_t(residuals[i] & ((1u << length) - 1))
+                 << pendingBits;
+      pendingBits += length;
+      while (pendingBits >= 8) {
+        out.push_back(static_cast<unsigned char>(pending));
+        pending >>= 8;
+        pendingBits -= 8;
+      }
+    }
+    if (pendingBits > 0)
+      out.push_back(static_cast<unsigned char>(pending));
+    const std::uint32_t extraBytes =
+        static_cast<std::uint32_t>(out.size() - bitStart);
+
+    std::memcpy(out.data() + table + segment * 8, &symbolBytes, 4);
+    std::memcpy(out.data() + table + segment * 8 + 4, &extraBytes, 4);
+  }
+}
+
+// where the parts of one column lie in a frame
+struct TrajectoryColumn {
+  std::uint16_t frequencies[maxSymbols];
+  std::uint32_t cumulative[maxSymbols];
+  unsigned char symbolOf[probabilityScale];
+  std::vector<const unsigned char *> symbolData, extraData;
+  std::vector<std::uint32_t> symbolBytes, extraBytes;
+};
+
+static bool parseColumn(const unsigned char *&data, const unsigned char *end,
+                        std::size_t segments, TrajectoryColumn &column) {
+  std::uint8_t symbolCount;
+  if (!read(data, end, symbolCount) || symbolCount > maxSymbols)
+    return false;
+  std::uint32_t total = 0;
+  for (unsigned s = 0; s < maxSymbols; ++s) {
+    column.frequencies[s] = 0;
+    if (s < symbolCount && !read(data, end, column.frequencies[s]))
+      return false;
+    column.cumulative[s] = total;
+    for (std::uint32_t k = 0; k < column.frequencies[s]; ++k)
+      if (total + k < probabilityScale)
+        column.symbolOf[total + k] = static_cast<unsigned char>(s);
+    total += column.frequencies[s];
+  }
+  if (segments > 0 && total != probabilityScale)
+    return false;
+
+  column.symbolBytes.resize(segments);
+  column.extraBytes.resize(segments);
+  column.symbolData.resize(segments);
+  column.extraData.resize(segments);
+  for (std::size_t segment = 0; segment < segments; ++segment)
+    if (!read(data, end, column.symbolBytes[segment]) ||
+        !read(data, end, column.extraBytes[segment]))
+      return false;
+  for (std::size_t segment = 0; segment < segments; ++segment) {
+    const std::size_t bytes = std::size_t(column.symbolBytes[segment]) +
+                              column.extraBytes[segment];
+    if (column.symbolBytes[segment] < 4 ||
+        static_cast<std::size_t>(end - data) < bytes)
+      return false;
+    column.symbolData[segment] = data;
+    column.extraData[segment] = data + column.symbolBytes[segment];
+    data += bytes;
+  }
+  return true;
+}
+
+// decodes residuals begin to end of a column and rebuilds the quantized
+// values from the frames before
+static bool decodeSegment(const TrajectoryColumn &column, std::size_t segment,
+                          std::size_t begin, std::size_t end,
+                          std::size_t chunkFrame,
+                          std::vector<std::int32_t> *frames) {
+  const unsigned char *symbols = column.symbolData[segment];
+  const unsigned char *symbolsEnd = symbols + column.symbolBytes[segment];
+  const unsigned char *extra = column.extraData[segment];
+  const unsigned char *extraEnd = extra + column.extraBytes[segment];
+  std::uint32_t state = 0;
+  for (int k = 0; k < 4; ++k)
+    state = (state << 8) | *symbols++;
+  std::uint64_t pending = 0;
+  unsigned pendingBits = 0;
+
+  std::int32_t *current = frames[0].data();
+  const std::int32_t *previous = frames[1].data();
+  const std::int32_t *before = frames[2].data();
+  for (std::size_t i = begin; i < end; ++i) {
+    const std::uint32_t slot = state & (probabilityScale - 1);
+    const unsigned symbol = column.symbolOf[slot];
+    state = column.frequencies[symbol] * (state >> probabilityBits) + slot -
+            column.cumulative[symbol];
+    while (state < ransLow) {
+      if (symbols == symbolsEnd)
+        return false;
+      state = (state << 8) | *symbols++;
+    }
+
+    std::uint32_t value = symbol;
+    if (symbol >= 2) {
+      const unsigned length = symbol - 1;
+      while (pendingBits < length) {
+        if (extra == extraEnd)
+          return false;
+        pending |= std::uint64_t(*extra++) << pendingBits;
+        pendingBits += 8;
+      }
+      value = (1u << length) |
+              static_cast<std::uint32_t>(pending & ((1u << length) - 1));
+      pending >>= length;
+      pendingBits -= length;
+    }
+
+    if (chunkFrame == 0)
+      current[i] = static_cast<std::int32_t>(value);
+    else if (chunkFrame == 1)
+      current[i] = static_cast<std::int32_t>(previous[i] + unzigzag(value));
+    else
+      current[i] = static_cast<std::int32_t>(
+          2 * std::int64_t(previous[i]) - before[i] + unzigzag(value));
+  }
+  return true;
+}
+
+bool TrajectoryDecoder::decode(const TrajectoryFrameHeader &header,
+                               const unsigned char *data) {
+  const unsigned char *end = data + header.size;
+  if (header.flags & TrajectoryEncoder::keyframeFlag) {
+    TrajectoryBox box;
+    if (!read(data, end, box))
+      return false;
+    const std::size_t count = static_cast<std::size_t>(header.bodyCount);
+    if (static_cast<std::size_t>(end - data) / sizeof(std::uint32_t) < count)
+      return false;
+    std::memcpy(origin, box.origin, sizeof(origin));
+    std::memcpy(scale, box.scale, sizeof(scale));
+    chunkFrames = 0;
+    bodyCount = count;
+    ids.resize(count);
+    std::memcpy(ids.data(), data, count * sizeof(std::uint32_t));
+    data += count * sizeof(std::uint32_t);
+  } else if (chunkFrames == 0 || header.bodyCount != bodyCount) {
+    return false;
+  }
+
+  const std::size_t segmentBodies = TrajectoryEncoder::segmentBodies;
+  const std::size_t segments = (bodyCount + segmentBodies - 1) / segmentBodies;
+  TrajectoryColumn columns[3];
+  for (int axis = 0; axis < 3; ++axis)
+    if (!parseColumn(data, end, segments, columns[axis]))
+      return false;
+
+  for (int axis = 0; axis < 3; ++axis) {
+    std::swap(history[axis][2], history[axis][1]);
+    std::swap(history[axis][1], history[axis][0]);
+    history[axis][0].resize(bodyCount);
+  }
+  std::vector<char> decoded(3 * segments, 0);
+  parallelFor(0, 3 * segments, 1, [&](std::size_t first, std::size_t last) {
+    for (std::size_t job = first; job < last; ++job) {
+      const int axis = static_cast<int>(job / segments);
+      const std::size_t segment = job % segments;
+      const std::size_t begin = segment * segmentBodies;
+      decoded[job] = decodeSegment(
+          columns[axis], segment, begin,
+          std::min(bodyCount, begin + segmentBodies), chunkFrames,
+          history[axis]);
+    }
+  });
+  if (std::find(decoded.begin(), decoded.end(), 0) != decoded.end()) {
+    chunkFrames = 0;
+    return false;
+  }
+  ++chunkFrames;
+  return true;
+}
+
+void TrajectoryDecoder::positions(BodyStore &bodies) const {
+  bodies.resize(bodyCount);
+  BodyStore::Position *axes[3] = {bodies.x.data(), bodies.y.data(),
+                                  bodies.z.data()};
+  parallelFor(0, bodyCount, TrajectoryEncoder::segmentBodies,
+              [&](std::size_t begin, std::size_t end) {
+                for (int axis = 0; axis < 3; ++axis) {
+                  const std::int32_t *quantized = history[axis][0].data();
+                  for (std::size_t i = begin; i < end; ++i)
+                    axes[axis][i] = static_cast<BodyStore::Position>(
+                        origin[axis] + quantized[i] * scale[axis]);
+                }
+              });
+  std::copy(ids.begin(), ids.end(), bodies.id.begin());
+}
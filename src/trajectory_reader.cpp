@@ -0,0 +1,145 @@
+#include <trajectory_reader.h>
+#include <trajectory_writer.h>
+#include <algorithm>
+#include <cstring>
+
+bool TrajectoryReader::open(const std::string &path, std::string &error) {
+  close();
+
+  // playback mostly moves forwards
+  if (!file.open(path, MappedFileAccess::Sequential, error))
+    return false;
+  data = file.data();
+  size = file.size();
+
+  TrajectoryFileHeader fileHeader;
+  if (size >= sizeof(fileHeader))
+    std::memcpy(&fileHeader, data, sizeof(fileHeader));
+  compressed = size >= sizeof(fileHeader) &&
+               !std::memcmp(fileHeader.magic, "SOLTRAJZ", 8);
+  if (size < sizeof(fileHeader) ||
+      (!compressed && std::memcmp(fileHeader.magic, "SOLTRAJ1", 8))) {
+    error = path + ": not a trajectory";
+  } else if (fileHeader.version != TrajectoryWriter::version) {
+    error = path + ": trajectory version " +
+            std::to_string(fileHeader.version) + ", expected " +
+            std::to_string(TrajectoryWriter::version);
+  } else if (!compressed &&
+             fileHeader.positionSize != sizeof(BodyStore::Position)) {
+    error = path + ": trajectory of " +
+            std::to_string(fileHeader.positionSize) +
+            " byte positions, this build uses " +
+            std::to_string(sizeof(BodyStore::Position));
+  }
+  if (!error.empty()) {
+    close();
+    return false;
+  }
+
+  // one pass over the frame headers; whatever does not fit the file is the
+  // frame the writer was in the middle of
+  std::size_t offset = sizeof(TrajectoryFileHeader);
+  while (size - offset >= sizeof(TrajectoryFrameHeader)) {
+    TrajectoryFrameHeader frame;
+    std::memcpy(&frame, data + offset, sizeof(frame));
+    const std::size_t left = size - offset - sizeof(frame);
+    std::size_t payload;
+    if (compressed) {
+      payload = frame.size;
+    } else {
+      const std::size_t perBody = TrajectoryFrameHeader::rawBodySize;
+      if (frame.bodyCount > left / perBody)
+        break;
+      payload = static_cast<std::size_t>(frame.bodyCount) * perBody;
+    }
+    if (payload > left)
+      break;
+    const bool keyframe =
+        !compressed || (frame.flags & TrajectoryEncoder::keyframeFlag);
+    if (!keyframe && frames.empty())
+      break;
+    frames.push_back(
+        Frame{offset, keyframe ? frames.size() : frames.back().keyframe});
+    offset += sizeof(frame) + payload;
+  }
+  return true;
+}
+
+void TrajectoryReader::close() {
+  file.close();
+  data = nullptr;
+  size = 0;
+  compressed = false;
+  frames.clear();
+  decoder = TrajectoryDecoder();
+  decodedFrame = 0;
+}
+
+TrajectoryFrameHeader TrajectoryReader::header(std::size_t frame) const {
+  TrajectoryFrameHeader result;
+  std::memcpy(&result, data + frames[frame].offset, sizeof(result));
+  return result;
+}
+
+std::uint64_t TrajectoryReader::getStep(std::size_t frame) const {
+  return header(frame).step;
+}
+
+double TrajectoryReader::getTime(std::size_t frame) const {
+  return header(frame).time;
+}
+
+std::size_t TrajectoryReader::getBodyCount(std::size_t frame) const {
+  return static_cast<std::size_t>(header(frame).bodyCount);
+}
+
+std::size_t TrajectoryReader::findFrame(double time) const {
+  std::size_t low = 0, high = frames.size();
+  while (high - low > 1) {
+    const std::size_t middle = low + (high - low) / 2;
+    if (getTime(middle) <= time)
+      low = middle;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+bool TrajectoryReader::readFrame(std::size_t frame, BodyStore &bodies,
+                                 std::string &error) {
+  if (frame >= frames.size()) {
+    error = "trajectory has no frame " + std::to_string(frame);
+    return false;
+  }
+
+  if (!compressed) {
+    const TrajectoryFrameHeader info = header(frame);
+    const std::size_t n = static_cast<std::size_t>(info.bodyCount);
+    const unsigned char *source =
+        data + frames[frame].offset + sizeof(TrajectoryFrameHeader);
+    bodies.resize(n);
+    for (auto *field :
+         {&bodies.x, &bodies.y, &bodies.z, &bodies.vx, &bodies.vy,
+          &bodies.vz}) {
+      std::memcpy(field->data(), source, n * sizeof(BodyStore::Position));
+      source += n * sizeof(BodyStore::Position);
+    }
+    std::memcpy(bodies.id.data(), source, n * sizeof(std::uint32_t));
+    return true;
+  }
+
+  // carry on from the frame decoded last if it is in the same chunk
+  std::size_t next = frames[frame].keyframe;
+  if (decoder.hasFrame() && decodedFrame >= next && decodedFrame <= frame)
+    next = decodedFrame + 1;
+  for (; next <= frame; ++next) {
+    if (!decoder.decode(header(next), data + frames[next].offset +
+                                          sizeof(TrajectoryFrameHeader))) {
+      error = "trajectory frame " + std::to_string(next) + " is damaged";
+      return false;
+    }
+    decodedFrame = next;
+  }
+  decoder.positions(bodies);
+  return true;
+}
@@ -0,0 +1,406 @@
+#include <trajectory_writer.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SOLAR_SIM_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// most pieces one gathered write takes, the usual IOV_MAX
+static const std::size_t maxPieces = 1024;
+// how long the writer sleeps before it looks at an empty ring again, in case
+// a wake up got lost
+static const auto idleWait = std::chrono::milliseconds(2);
+
+#if defined(SOLAR_SIM_IO_URING)
+// the smallest io_uring that does the job: one gathered write in flight,
+// submitted and reaped through the raw system calls, so no liburing is needed
+struct TrajectoryWriter::IoRing {
+  int descriptor = -1;
+  void *submitMap = nullptr, *completeMap = nullptr;
+  std::size_t submitSize = 0, completeSize = 0;
+  io_uring_sqe *entries = nullptr;
+  std::size_t entriesSize = 0;
+  unsigned *submitTail, *submitMask, *submitArray;
+  unsigned *completeHead, *completeTail, *completeMask;
+  io_uring_cqe *completions;
+
+  bool setup() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    descriptor = static_cast<int>(syscall(__NR_io_uring_setup, 4, &params));
+    if (descriptor < 0)
+      return false;
+
+    submitSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completeSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+      submitSize = completeSize = std::max(submitSize, completeSize);
+    submitMap = mmap(nullptr, submitSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+    if (submitMap == MAP_FAILED) {
+      submitMap = nullptr;
+      return false;
+    }
+    completeMap = single ? submitMap
+                         : mmap(nullptr, completeSize, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, descriptor,
+                                IORING_OFF_CQ_RING);
+    if (completeMap == MAP_FAILED) {
+      completeMap = nullptr;
+      return false;
+    }
+    entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void *mapped = mmap(nullptr, entriesSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, descriptor,
+                        IORING_OFF_SQES);
+    if (mapped == MAP_FAILED)
+      return false;
+    entries = static_cast<io_uring_sqe *>(mapped);
+
+    auto *submit = static_cast<unsigned char *>(submitMap);
+    auto *complete = static_cast<unsigned char *>(completeMap);
+    submitTail = reinterpret_cast<unsigned *>(submit + params.sq_off.tail);
+    submitMask =
+        reinterpret_cast<unsigned *>(submit + params.sq_off.ring_mask);
+    submitArray = reinterpret_cast<unsigned *>(submit + params.sq_off.array);
+    completeHead = reinterpret_cast<unsigned *>(complete + params.cq_off.head);
+    completeTail = reinterpret_cast<unsigned *>(complete + params.cq_off.tail);
+    completeMask =
+        reinterpret_cast<unsigned *>(complete + params.cq_off.ring_mask);
+    completions =
+        reinterpret_cast<io_uring_cqe *>(complete + params.cq_off.cqes);
+    return true;
+  }
+
+  ~IoRing() {
+    if (entries)
+      munmap(entries, entriesSize);
+    if (completeMap && completeMap != submitMap)
+      munmap(completeMap, completeSize);
+    if (submitMap)
+      munmap(submitMap, submitSize);
+    if (descriptor >= 0)
+      ::close(descriptor);
+  }
+
+  // the result of the write, bytes or -errno
+  long writev(int file, const iovec *pieces, unsigned count,
+              std::uint64_t offset) {
+    unsigned tail = *submitTail;
+    unsigned index = tail & *submitMask;
+    io_uring_sqe &entry = entries[index];
+    std::memset(&entry, 0, sizeof(entry));
+    entry.opcode = IORING_OP_WRITEV;
+    entry.fd = file;
+    entry.addr = reinterpret_cast<std::uint64_t>(pieces);
+    entry.len = count;
+    entry.off = offset;
+    submitArray[index] = index;
+    __atomic_store_n(submitTail, tail + 1, __ATOMIC_RELEASE);
+
+    unsigned toSubmit = 1;
+    for (;;) {
+      long entered = syscall(__NR_io_uring_enter, descriptor, toSubmit, 1,
+                             IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (entered < 0 && errno != EINTR)
+        return -errno;
+      if (entered > 0)
+        toSubmit = 0;
+      unsigned head = *completeHead;
+      if (head != __atomic_load_n(completeTail, __ATOMIC_ACQUIRE)) {
+        long result = completions[head & *completeMask].res;
+        __atomic_store_n(completeHead, head + 1, __ATOMIC_RELEASE);
+        return result;
+      }
+    }
+  }
+};
+#else
+struct TrajectoryWriter::IoRing {};
+#endif
+
+bool TrajectoryWriter::open(const std::string &path, std::size_t capacity,
+                            const TrajectorySettings &options,
+                            std::string &error) {
+  close();
+  settings = options;
+  settings.slotCount = std::max<std::size_t>(settings.slotCount, 2);
+  bodyCapacity = capacity;
+  slotSize = sizeof(TrajectoryFrameHeader) +
+             bodyCapacity * TrajectoryFrameHeader::rawBodySize;
+  // whole cache lines, so neighbouring slots never share one
+  slotSize = (slotSize + 63) / 64 * 64;
+  slots.assign(slotSize * settings.slotCount, 0);
+
+  TrajectoryFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, settings.compress ? "SOLTRAJZ" : "SOLTRAJ1",
+              sizeof(header.magic));
+  header.version = version;
+  header.positionSize = sizeof(BodyStore::Position);
+  std::strncpy(header.precision, Precision::name,
+               sizeof(header.precision) - 1);
+
+#if defined(_WIN32)
+  file = std::fopen(path.c_str(), "wb");
+  bool opened =
+      file && std::fwrite(&header, sizeof(header), 1, file) == 1;
+#else
+  file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool opened = file >= 0 && ::write(file, &header, sizeof(header)) ==
+                                 static_cast<ssize_t>(sizeof(header));
+#endif
+  if (!opened) {
+    error = "could not create " + path;
+    close();
+    return false;
+  }
+  fileOffset = sizeof(header);
+  encoder = TrajectoryEncoder(settings.codec);
+
+#if defined(SOLAR_SIM_IO_URING)
+  if (settings.useIoUring) {
+    ring = new IoRing;
+    if (!ring->setup()) {
+      // kernels without io_uring, or sandboxes that forbid it
+      delete ring;
+      ring = nullptr;
+    }
+  }
+#endif
+
+  head.store(0);
+  tail.store(0);
+  stopping.store(false);
+  failed.store(false);
+  framesSubmitted = framesDropped = stalls = 0;
+  stallSeconds = 0.0;
+  peakQueued = 0;
+  framesWritten.store(0);
+  bytesWritten.store(0);
+  writes.store(0);
+  writer = std::thread([this] { writerLoop(); });
+  return true;
+}
+
+void TrajectoryWriter::close() {
+  if (writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping.store(true);
+    }
+    wake.notify_one();
+    writer.join();
+  }
+  delete ring;
+  ring = nullptr;
+#if defined(_WIN32)
+  if (file)
+    std::fclose(file);
+  file = nullptr;
+#else
+  if (file >= 0)
+    ::close(file);
+  file = -1;
+#endif
+}
+
+bool TrajectoryWriter::submit(const BodyStore &bodies, double time,
+                              std::uint64_t step) {
+  ++framesSubmitted;
+  const std::size_t n = bodies.size();
+  if (!writer.joinable() || n > bodyCapacity || failed.load()) {
+    ++framesDropped;
+    return false;
+  }
+
+  const std::uint64_t frame = head.load(std::memory_order_relaxed);
+  if (frame - tail.load(std::memory_order_acquire) == settings.slotCount) {
+    ++stalls;
+    if (settings.backpressure == TrajectoryBackpressure::Drop) {
+      ++framesDropped;
+      return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    while (frame - tail.load(std::memory_order_acquire) ==
+               settings.slotCount &&
+           !failed.load())
+      std::this_thread::yield();
+    stallSeconds += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    if (failed.load()) {
+      ++framesDropped;
+      return false;
+    }
+  }
+
+  unsigned char *target = slot(frame);
+  TrajectoryFrameHeader header = {step, time, n, 0, 0};
+  std::memcpy(target, &header, sizeof(header));
+  target += sizeof(header);
+  for (const auto *field : {&bodies.x, &bodies.y, &bodies.z, &bodies.vx,
+                            &bodies.vy, &bodies.vz}) {
+    std::memcpy(target, field->data(), n * sizeof(BodyStore::Position));
+    target += n * sizeof(BodyStore::Position);
+  }
+  std::memcpy(target, bodies.id.data(), n * sizeof(std::uint32_t));
+
+  head.store(frame + 1, std::memory_order_release);
+  peakQueued = std::max<std::size_t>(
+      peakQueued, frame + 1 - tail.load(std::memory_order_relaxed));
+  // a wake up lost to the race with the writer going to sleep only costs
+  // it idleWait
+  wake.notify_one();
+  return true;
+}
+
+void TrajectoryWriter::writerLoop() {
+  for (;;) {
+    const std::uint64_t first = tail.load(std::memory_order_relaxed);
+    const std::uint64_t last = head.load(std::memory_order_acquire);
+    if (first != last) {
+      const std::uint64_t end =
+          std::min<std::uint64_t>(last, first + maxPieces);
+      if (!failed.load() && !writeFrames(first, end))
+        failed.store(true);
+      tail.store(end, std::memory_order_release);
+      continue;
+    }
+    if (stopping.load())
+      return;
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wake.wait_for(lock, idleWait, [&] {
+      return stopping.load() ||
+             head.load(std::memory_order_acquire) != first;
+    });
+  }
+}
+
+bool TrajectoryWriter::writeFrames(std::uint64_t first, std::uint64_t last) {
+  pieces.clear();
+  std::size_t bytes = 0;
+  if (settings.compress) {
+    encoded.clear();
+    for (std::uint64_t frame = first; frame < last; ++frame) {
+      const unsigned char *data = slot(frame);
+      TrajectoryFrameHeader header;
+      std::memcpy(&header, data, sizeof(header));
+      const std::size_t n = static_cast<std::size_t>(header.bodyCount);
+      const auto *x = reinterpret_cast<const BodyStore::Position *>(
+          data + sizeof(header));
+      const auto *id = reinterpret_cast<const std::uint32_t *>(x + 6 * n);
+      encoder.encode(header.step, header.time, n, x, x + n, x + 2 * n, id,
+                     encoded);
+    }
+    pieces.push_back(Piece{encoded.data(), encoded.size()});
+    bytes = encoded.size();
+  }
+  for (std::uint64_t frame = first; frame < last && !settings.compress;
+       ++frame) {
+    const unsigned char *data = slot(frame);
+    TrajectoryFrameHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    std::size_t size =
+        sizeof(header) + static_cast<std::size_t>(header.bodyCount) *
+                             TrajectoryFrameHeader::rawBodySize;
+    // frames that fill their slot run on into the next one
+    if (!pieces.empty() && pieces.back().data + pieces.back().size == data)
+      pieces.back().size += size;
+    else
+      pieces.push_back(Piece{data, size});
+    bytes += size;
+  }
+  if (!writePieces())
+    return false;
+  framesWritten.fetch_add(last - first, std::memory_order_relaxed);
+  bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+  return true;
+}
+
+bool TrajectoryWriter::writePieces() {
+#if defined(_WIN32)
+  for (const Piece &piece : pieces) {
+    if (std::fwrite(piece.data, 1, piece.size, file) != piece.size)
+      return false;
+    fileOffset += piece.size;
+  }
+  writes.fetch_add(1, std::memory_order_relaxed);
+  return true;
+#else
+  std::vector<iovec> vectors(pieces.size());
+  for (std::size_t i = 0; i < pieces.size(); ++i)
+    vectors[i] = iovec{const_cast<unsigned char *>(pieces[i].data),
+                       pieces[i].size};
+
+  // short writes leave the rest for another round
+  std::size_t next = 0;
+  while (next < vectors.size()) {
+    const int count = static_cast<int>(vectors.size() - next);
+    long written;
+#if defined(SOLAR_SIM_IO_URING)
+    if (ring)
+      written = ring->writev(file, vectors.data() + next,
+                             static_cast<unsigned>(count), fileOffset);
+    else
+#endif
+    {
+      written = ::writev(file, vectors.data() + next, count);
+      if (written < 0)
+        written = -errno;
+    }
+    writes.fetch_add(1, std::memory_order_relaxed);
+    if (written == -EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    fileOffset += static_cast<std::uint64_t>(written);
+    std::size_t left = static_cast<std::size_t>(written);
+    while (next < vectors.size() && left >= vectors[next].iov_len)
+      left -= vectors[next++].iov_len;
+    if (left > 0) {
+      vectors[next].iov_base =
+          static_cast<unsigned char *>(vectors[next].iov_base) + left;
+      vectors[next].iov_len -= left;
+    }
+  }
+  return true;
+#endif
+}
+
+TrajectoryStats TrajectoryWriter::getStats() const {
+  TrajectoryStats stats;
+  stats.framesSubmitted = framesSubmitted;
+  stats.framesWritten = framesWritten.load();
+  stats.framesDropped = framesDropped;
+  stats.stalls = stalls;
+  stats.stallSeconds = stallSeconds;
+  stats.bytesWritten = bytesWritten.load();
+  stats.peakQueued = peakQueued;
+  stats.writes = writes.load();
+  return stats;
+}
+
+const char *TrajectoryWriter::getBackendName() const {
+#if defined(_WIN32)
+  return "stdio";
+#else
+  return ring ? "io_uring" : "writev";
+#endif
+}